@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Pipelined copy engine between the MCP24LC01B and the on-board EEPROM
+ * 
+ * Summary:
+ *  - Works on the 24xx part selected with lc01b_SetDevice; bounds and page
+ *    splits come from its descriptor
+ *  - Two MIRROR_CHUNK byte staging buffers replace whole-device copies
+ *    held on the stack
+ *  - LC01B -> NVM: while the NVM queue programs one buffer, the next
+ *    chunk is read over I2C into the other. Erases are planned per 8 word
+ *    block and the words programmed with EE_WRITE_NOE
+ *  - NVM -> LC01B: while the LC01B transaction engine writes and ack
+ *    polls one page, the next page is built in the other buffer
+ *  - Overlap needs the NVM and MI2C1 interrupts enabled (obee_Init and
+ *    init_I2C). Without them the copies still work, one step at a time
+ * *****************************************************************************/
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eemirror.h"
+
+//Copy 24xx contents into the on-board EEPROM
+ee_Errors_t mirror_Lc01bToNvm(uint16_t ee_addr,uint16_t offset,uint16_t len){
+   
+   uint16_t stage[2][MIRROR_CHUNK/WORD_LEN];
+   obee_Op_t op;
+   uint16_t pos, chunk, next;
+   uint8_t buf = 0;
+   ee_Errors_t errCode;
+   
+   if(len == 0)
+      return ERR_NONE;
+   if((uint32_t)ee_addr + len - 1 > lc01b_GetDevice()->maxAddr || (uint32_t)offset + len - 1 > OFFSET_LAST
+      || (offset & 1) || (len & 1))
+      return ERR_MEM_BOUNDS;
+   
+   //Prime the first buffer
+   chunk = (len < MIRROR_CHUNK) ? len : MIRROR_CHUNK;
+   errCode = lc01b_ReadSeq(ee_addr,chunk,(uint8_t *)stage[buf]);
+   if(errCode)
+      return errCode;
+   
+   op.busy = 0;
+   op.failed = 0;
+   for(pos=0; pos<len; pos+=chunk){
+      chunk = (len - pos < MIRROR_CHUNK) ? len - pos : MIRROR_CHUNK;
+      errCode = obee_Wait(&op);                                                 //Frees the other buffer
+      if(errCode == ERR_NONE)
+         errCode = obee_ErasePlan(offset + pos,chunk,stage[buf]);               //Only where bits must rise
+      if(errCode)
+         return errCode;
+      obee_WriteAsync(&op,EE_WRITE_NOE,offset + pos,chunk,stage[buf],0);
+      
+      //Fetch the next chunk while the NVM programs this one
+      next = pos + chunk;
+      if(next < len){
+         errCode = lc01b_ReadSeq(ee_addr + next,(len - next < MIRROR_CHUNK) ? len - next : MIRROR_CHUNK,
+                                 (uint8_t *)stage[buf ^ 1]);
+         if(errCode)
+            break;
+      }
+      buf ^= 1;
+   }
+   if(obee_Wait(&op) && errCode == ERR_NONE)                                    //Buffers must outlive the queue
+      errCode = ERR_NVM_WRITE;
+   return errCode;
+}
+
+//Copy on-board EEPROM contents into the 24xx part
+ee_Errors_t mirror_NvmToLc01b(uint16_t offset,uint16_t ee_addr,uint16_t len){
+   
+   uint8_t stage[2][MIRROR_CHUNK];
+   lc01b_Xfer_t xfer;
+   lc01b_Dev_t *pDev = lc01b_GetDevice();
+   uint16_t pos, chunk, ctr, byteOffset, word;
+   uint8_t buf = 0;
+   ee_Errors_t errCode;
+   
+   if(len == 0)
+      return ERR_NONE;
+   if((uint32_t)ee_addr + len - 1 > pDev->maxAddr || (uint32_t)offset + len - 1 > OFFSET_LAST)
+      return ERR_MEM_BOUNDS;
+   
+   xfer.busy = 0;
+   xfer.errCode = ERR_NONE;
+   for(pos=0; pos<len; pos+=chunk){
+      chunk = pDev->pageSize - ((ee_addr + pos) % pDev->pageSize);              //At most one page write per chunk
+      if(chunk > MIRROR_CHUNK)
+         chunk = MIRROR_CHUNK;
+      if(chunk > len - pos)
+         chunk = len - pos;
+      
+      //Build the page while the previous one is in its write cycle
+      for(ctr=0; ctr<chunk; ctr++){
+         byteOffset = offset + pos + ctr;
+         word = obee_Read(byteOffset & ~1);
+         stage[buf][ctr] = (byteOffset & 1) ? word >> 8 : word;                 //Little endian, as memcpy lays it out
+      }
+      
+      errCode = lc01b_Wait(&xfer);
+      if(errCode)
+         return errCode;
+      lc01b_WriteAsync(&xfer,ee_addr + pos,chunk,stage[buf],0);
+      buf ^= 1;
+   }
+   return lc01b_Wait(&xfer);
+}
@@ -0,0 +1,47 @@
+/* 
+ * File:   eemirror.h
+ *
+ * Pipelined copies between the 24LC01B and the PIC24F on-board EEPROM.
+ * Requires sys.h, lc01b.h and obeeprom.h to be included first
+ */
+
+#ifndef EEMIRROR_H
+#define	EEMIRROR_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define MIRROR_CHUNK LC01B_PAGE                                                 //Bytes per staging buffer
+
+//-------------------------------------------------------
+// Receives: 24xx memory address, on-board EEPROM byte
+//           offset and number of bytes to copy
+// Returns:  Status of bounds check, of the first failed
+//           24xx read, or ERR_NVM_WRITE if an erase or
+//           program cycle failed
+// Summary:  Copies contents of the selected 24xx part
+//           into the on-board EEPROM. The next chunk is
+//           read over I2C while the current one is being
+//           programmed. Offset and length must be even
+//-------------------------------------------------------
+ee_Errors_t mirror_Lc01bToNvm(uint16_t,uint16_t,uint16_t);
+
+//-------------------------------------------------------
+// Receives: On-board EEPROM byte offset, 24xx memory
+//           address and number of bytes to copy
+// Returns:  Status of bounds check or of the first
+//           failed page write
+// Summary:  Copies on-board EEPROM contents into the
+//           selected 24xx part, one page or MIRROR_CHUNK
+//           at a time. The next chunk is built while the
+//           part runs its write cycle
+//-------------------------------------------------------
+ee_Errors_t mirror_NvmToLc01b(uint16_t,uint16_t,uint16_t);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EEMIRROR_H */
+
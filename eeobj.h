@@ -0,0 +1,125 @@
+/*
+ * File:   eeobj.h
+ *
+ * Compile time object layout for the 24xx EEPROM. The application lists
+ * its persistent objects once; the preprocessor assigns each one an
+ * address and the compiler rejects a layout that does not fit. Requires
+ * sys.h and lc01b.h to be included first
+ *
+ * Usage, in one header of the application:
+ *
+ *    #define EEOBJ_TABLE(X) \
+ *       X(pi,float,LC01B_CRC8) \
+ *       X(bigUn,uint64_t,LC01B_CRC16) \
+ *       X(count,uint16_t,0)
+ *    #include "eeobj.h"
+ *
+ * Each entry is a name, a type and a CRC type (0, LC01B_CRC8 or
+ * LC01B_CRC16). Objects are placed in table order, each at the first
+ * address from where the last one ended that keeps it in the fewest
+ * possible pages, so an object no larger than a page never straddles
+ * a page boundary. EEOBJ_name is the address of object name
+ *
+ * Layouts are worked out in enum constants, so they must end below
+ * 0x8000 on XC16
+ */
+
+#ifndef EEOBJ_H
+#define	EEOBJ_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef EEOBJ_TABLE
+#error "Define EEOBJ_TABLE before including eeobj.h"
+#endif
+
+//Device traits. Define these before the include for other 24xx parts
+#ifndef EEOBJ_BASE
+#define EEOBJ_BASE 0x00                                                         //First address the layout may use
+#endif
+#ifndef EEOBJ_PAGE
+#define EEOBJ_PAGE LC01B_PAGE                                                   //Page write size
+#endif
+#ifndef EEOBJ_CAP
+#define EEOBJ_CAP  LC01B_CAP                                                    //Device capacity in bytes
+#endif
+
+//Compile time check; a false condition is a negative array size
+#define EEOBJ_ASSERT(cond,tag) typedef char eeobj_Assert_##tag[(cond) ? 1 : -1]
+
+//Pages an object of len bytes needs at the least
+#define EEOBJ_PAGES(len) (((len) + EEOBJ_PAGE - 1) / EEOBJ_PAGE)
+
+//Address for an object of len bytes with the layout ended at cur. Moves
+//to the next page boundary when staying would cost an extra page
+#define EEOBJ_PLACE(cur,len) \
+   ((((cur) % EEOBJ_PAGE) + (len) > EEOBJ_PAGES(len) * EEOBJ_PAGE) \
+      ? (((cur) + EEOBJ_PAGE - 1) / EEOBJ_PAGE) * EEOBJ_PAGE : (cur))
+
+//Bytes an object takes in the EEPROM, CRC included
+#define EEOBJ_LEN(type,crc) (sizeof(type) + (crc))
+
+//Layout. Each object adds three enum constants: where the layout had
+//ended (one past the last byte of the object before), its address and
+//its last byte. The next object's first constant counts on from there
+#define EEOBJ_PLACE_ENTRY(name,type,crc) \
+   EEOBJ_CUR_##name, \
+   EEOBJ_##name = EEOBJ_PLACE(EEOBJ_CUR_##name,EEOBJ_LEN(type,crc)), \
+   EEOBJ_LAST_##name = EEOBJ_##name + EEOBJ_LEN(type,crc) - 1,
+
+enum{
+   EEOBJ_LAST_BASE = EEOBJ_BASE - 1,
+   EEOBJ_TABLE(EEOBJ_PLACE_ENTRY)
+   EEOBJ_END                                                                    //One past the last object
+};
+
+//Object sizes and CRC types
+#define EEOBJ_INFO_ENTRY(name,type,crc) \
+   EEOBJ_SIZE_##name = sizeof(type), \
+   EEOBJ_CRC_##name = (crc),
+
+enum{
+   EEOBJ_TABLE(EEOBJ_INFO_ENTRY)
+   EEOBJ_INFO_END
+};
+
+//Per object checks
+#define EEOBJ_CHECK_ENTRY(name,type,crc) \
+   EEOBJ_ASSERT((crc) == 0 || (crc) == LC01B_CRC8 || (crc) == LC01B_CRC16,crc_##name);
+
+EEOBJ_TABLE(EEOBJ_CHECK_ENTRY)
+EEOBJ_ASSERT(EEOBJ_BASE + EEOBJ_CAP <= 0x8000,layout_range);
+EEOBJ_ASSERT(EEOBJ_END <= EEOBJ_BASE + EEOBJ_CAP,layout_overflow);
+
+//Size of *pObj, failing to compile unless it matches object name
+#define EEOBJ_SIZEOF(name,pObj) \
+   (sizeof(char[(sizeof(*(pObj)) == EEOBJ_SIZE_##name) ? 1 : -1]) * sizeof(*(pObj)))
+
+//-------------------------------------------------------
+// Receives: Object name and a pointer to its value
+// Returns:  Status of the write
+// Summary:  Writes the object, and its CRC if it has
+//           one, at its assigned address. A pointer to
+//           a value of the wrong size does not compile
+//-------------------------------------------------------
+#define EEOBJ_SAVE(name,pObj) \
+   lc01b_WriteObjectCrc(EEOBJ_##name,EEOBJ_SIZEOF(name,pObj),(pObj),EEOBJ_CRC_##name)
+
+//-------------------------------------------------------
+// Receives: Object name and a pointer for its value
+// Returns:  ERR_CRC if an object with a CRC is corrupt,
+//           otherwise status of the read
+// Summary:  Reads the object from its assigned address
+//           in one sequential read
+//-------------------------------------------------------
+#define EEOBJ_LOAD(name,pObj) \
+   lc01b_ReadObjectCrc(EEOBJ_##name,EEOBJ_SIZEOF(name,pObj),(pObj),EEOBJ_CRC_##name)
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EEOBJ_H */
+
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * Packed sample logging for the 24xx EEPROM
+ *
+ * Summary:
+ *  - Samples are stored as the difference from the previous sample,
+ *    zig-zag mapped so small steps either way are small numbers, then
+ *    written as varints: 7 bits per byte, low bits first, top bit set
+ *    on all but the last byte. A step of -64 to 63 takes one byte
+ *    instead of two
+ *  - Varints are packed into PACK_FRAME byte frames, one page write
+ *    each. Byte 0 holds the sample count and PACK_KEY; no varint is
+ *    split across frames and unused bytes are zero
+ *  - Deltas carry on from frame to frame. Every PACK_KEY_FRAMES frames
+ *    a key frame starts over with an absolute first sample, so decoding
+ *    can start there or pick up again after a bad frame
+ *  - Differences wrap in 16 bits, so any sequence of int16_t samples
+ *    round trips exactly
+ *
+ * With 8 byte frames a slowly moving signal packs 7 samples per page
+ * write, against 4 when stored raw
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "eepack.h"
+
+//Check a log range against the frame size and the device
+static ee_Errors_t pack_CheckRange(uint16_t ee_addr, uint16_t len){
+
+   lc01b_Dev_t *pDev = lc01b_GetDevice();
+
+   if(ee_addr % PACK_FRAME || len % PACK_FRAME || pDev->pageSize % PACK_FRAME)
+      return ERR_PAGE_BOUNDS;                                                   //Frames must not straddle pages
+   else if(len == 0 || (uint32_t)ee_addr + len - 1 > pDev->maxAddr)
+      return ERR_MEM_BOUNDS;
+   return ERR_NONE;
+}
+
+//Zig-zag varint of a 16-bit difference. Returns its length
+static uint8_t pack_Varint(uint8_t *pCode, uint16_t delta){
+
+   uint16_t zz = (delta << 1) ^ ((delta & 0x8000) ? 0xFFFF : 0x0000);
+   uint8_t len = 0;
+
+   while(zz >= 0x80){
+      pCode[len++] = (zz & 0x7F) | 0x80;
+      zz >>= 7;
+   }
+   pCode[len++] = zz;
+   return len;
+}
+
+//Write the current frame. The next sample goes in a new one
+static ee_Errors_t pack_Close(pack_Enc_t *pEnc){
+
+   ee_Errors_t errCode;
+
+   memset(pEnc->frame + pEnc->fill,0,PACK_FRAME - pEnc->fill);
+   errCode = lc01b_WritePage(pEnc->ee_addr,PACK_FRAME,pEnc->frame);
+   if(errCode == ERR_NONE){
+      pEnc->ee_addr += PACK_FRAME;
+      pEnc->fill = 0;
+   }
+   return errCode;
+}
+
+//Start an empty log
+ee_Errors_t pack_EncInit(pack_Enc_t *pEnc, uint16_t ee_addr, uint16_t len){
+
+   ee_Errors_t errCode = pack_CheckRange(ee_addr,len);
+
+   if(errCode)
+      return errCode;
+   pEnc->base = ee_addr;
+   pEnc->end = ee_addr + len;
+   pEnc->ee_addr = ee_addr;
+   pEnc->prev = 0;
+   pEnc->fill = 0;
+   return ERR_NONE;
+}
+
+//Pack one sample, writing the frame out when it is full
+ee_Errors_t pack_Put(pack_Enc_t *pEnc, int16_t sample){
+
+   uint8_t code[PACK_VARINT_MAX], len;
+   ee_Errors_t errCode;
+
+   for(;;){
+      if(pEnc->fill == 0){
+         if(pEnc->ee_addr >= pEnc->end)
+            return ERR_MEM_BOUNDS;                                              //Log full
+         pEnc->frame[0] = (((pEnc->ee_addr - pEnc->base) / PACK_FRAME) % PACK_KEY_FRAMES) ? 0 : PACK_KEY;
+         pEnc->fill = 1;
+      }
+
+      //Key frames start with the sample itself
+      if(pEnc->frame[0] == PACK_KEY)
+         len = pack_Varint(code,(uint16_t)sample);
+      else
+         len = pack_Varint(code,(uint16_t)sample - (uint16_t)pEnc->prev);
+      if(pEnc->fill + len <= PACK_FRAME)
+         break;
+
+      errCode = pack_Close(pEnc);                                               //No room; this frame is done
+      if(errCode)
+         return errCode;
+   }
+
+   memcpy(pEnc->frame + pEnc->fill,code,len);
+   pEnc->fill += len;
+   pEnc->frame[0]++;
+   pEnc->prev = sample;
+   return (pEnc->fill == PACK_FRAME) ? pack_Close(pEnc) : ERR_NONE;
+}
+
+//Write the part filled frame in place
+ee_Errors_t pack_Flush(pack_Enc_t *pEnc){
+
+   if(pEnc->fill == 0)
+      return ERR_NONE;
+   memset(pEnc->frame + pEnc->fill,0,PACK_FRAME - pEnc->fill);
+   return lc01b_WritePage(pEnc->ee_addr,PACK_FRAME,pEnc->frame);
+}
+
+//Start decoding
+void pack_DecInit(pack_Dec_t *pDec){
+
+   pDec->prev = 0;
+   pDec->synced = 0;
+}
+
+//Decode one frame. A frame that does not parse drops sync until the
+//next key frame
+uint8_t pack_DecFrame(pack_Dec_t *pDec, uint8_t *pFrame, int16_t *pOut){
+
+   uint8_t count = pFrame[0] & PACK_COUNT, pos = 1, idx, shift;
+   uint16_t zz, value = pDec->prev;
+
+   if(pFrame[0] == PACK_BLANK)
+      return 0;
+   else if(count == 0 || count > PACK_FRAME - 1 || !(pDec->synced || (pFrame[0] & PACK_KEY))){
+      pDec->synced = 0;
+      return 0;
+   }
+
+   for(idx=0; idx<count; idx++){
+      zz = 0;
+      shift = 0;
+      do{
+         if(pos >= PACK_FRAME || shift > 14){
+            pDec->synced = 0;                                                   //Runs off the frame
+            return 0;
+         }
+         zz |= (uint16_t)(pFrame[pos] & 0x7F) << shift;
+         shift += 7;
+      }while(pFrame[pos++] & 0x80);
+
+      zz = (zz & 1) ? ~(zz >> 1) : (zz >> 1);                                   //Undo the zig-zag
+      value = (idx == 0 && (pFrame[0] & PACK_KEY)) ? zz : value + zz;
+      pOut[idx] = (int16_t)value;
+   }
+   pDec->prev = (int16_t)value;
+   pDec->synced = 1;
+   return count;
+}
+
+//Read and decode a log
+ee_Errors_t pack_Read(uint16_t ee_addr, uint16_t len, int16_t *pOut, uint16_t max, uint16_t *pCount){
+
+   uint8_t frame[PACK_FRAME], count;
+   int16_t samples[PACK_FRAME - 1];
+   uint16_t pos, total = 0;
+   pack_Dec_t dec;
+   ee_Errors_t errCode = pack_CheckRange(ee_addr,len);
+
+   pack_DecInit(&dec);
+   for(pos=0; pos<len && errCode == ERR_NONE; pos+=PACK_FRAME){
+      errCode = lc01b_ReadStream(ee_addr + pos,PACK_FRAME,frame);               //Current address reads after the first
+      if(errCode || frame[0] == PACK_BLANK)
+         break;
+      count = pack_DecFrame(&dec,frame,samples);
+      if(total + count > max)
+         break;
+      memcpy(pOut + total,samples,count * sizeof(int16_t));
+      total += count;
+   }
+   if(pCount)
+      *pCount = total;
+   return errCode;
+}
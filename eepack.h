@@ -0,0 +1,116 @@
+/*
+ * File:   eepack.h
+ *
+ * Delta, zig-zag and varint packing of logged 16-bit samples into page
+ * sized frames on the 24xx EEPROM. Requires sys.h and lc01b.h to be
+ * included first
+ */
+
+#ifndef EEPACK_H
+#define	EEPACK_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+//Frame size; one page write per frame
+#ifndef PACK_FRAME
+#define PACK_FRAME LC01B_PAGE
+#endif
+
+#if PACK_FRAME < 4 || PACK_FRAME > 64
+#error "PACK_FRAME must be 4 to 64 bytes"
+#endif
+
+//Frame header byte: key flag and sample count
+#define PACK_KEY        0x80                                                    //First sample is absolute, not a delta
+#define PACK_COUNT      0x7F
+#define PACK_BLANK      0xFF                                                    //Erased frame; end of the log
+#define PACK_KEY_FRAMES 4                                                       //Every Nth frame is a key frame
+#define PACK_VARINT_MAX 3                                                       //Bytes for one 16-bit zig-zag value
+
+//Encoder state, about PACK_FRAME + 10 bytes
+typedef struct{
+   uint16_t          base;                                                      //First frame of the log
+   uint16_t          end;                                                       //One past the last frame
+   uint16_t          ee_addr;                                                   //Frame being filled
+   int16_t           prev;                                                      //Last sample packed
+   uint8_t           fill;                                                      //Bytes used in frame
+   uint8_t           frame[PACK_FRAME];                                         //Header, then the varints
+}pack_Enc_t;
+
+//Decoder state
+typedef struct{
+   int16_t           prev;                                                      //Last sample decoded
+   uint8_t           synced;                                                    //Non-zero once a key frame was seen
+}pack_Dec_t;
+
+//-------------------------------------------------------
+// Receives: Encoder, frame aligned log address and log
+//           length
+// Returns:  ERR_PAGE_BOUNDS if the address or length is
+//           not a whole number of frames, ERR_MEM_BOUNDS
+//           if the log runs past the device
+// Summary:  Starts an empty log. Nothing is written
+//           until the first frame fills or pack_Flush
+//-------------------------------------------------------
+ee_Errors_t pack_EncInit(pack_Enc_t *,uint16_t,uint16_t);
+
+//-------------------------------------------------------
+// Receives: Encoder and a sample
+// Returns:  ERR_MEM_BOUNDS when the log is full,
+//           otherwise status of the page write, if any
+// Summary:  Packs the sample as the zig-zag varint of its
+//           difference from the last one, one byte for
+//           steps of -64 to 63. A frame that cannot take
+//           the next sample is written with one page
+//           write and a new frame is started
+//-------------------------------------------------------
+ee_Errors_t pack_Put(pack_Enc_t *,int16_t);
+
+//-------------------------------------------------------
+// Receives: Encoder
+// Returns:  Status of the page write
+// Summary:  Writes the part filled frame so the samples
+//           so far survive a reset. The frame keeps
+//           filling and is written again when full
+//-------------------------------------------------------
+ee_Errors_t pack_Flush(pack_Enc_t *);
+
+//-------------------------------------------------------
+// Receives: Decoder
+// Returns:  Nothing
+// Summary:  Starts decoding; the first frame decoded
+//           must be a key frame
+//-------------------------------------------------------
+void pack_DecInit(pack_Dec_t *);
+
+//-------------------------------------------------------
+// Receives: Decoder, one frame of lc01b_ReadSeq output
+//           and room for PACK_FRAME - 1 samples
+// Returns:  Samples decoded. Zero for a blank or corrupt
+//           frame, or a delta frame before any key frame
+// Summary:  Streaming decoder. Frames are fed in log
+//           order; decoding can start at any key frame
+//-------------------------------------------------------
+uint8_t pack_DecFrame(pack_Dec_t *,uint8_t *,int16_t *);
+
+//-------------------------------------------------------
+// Receives: Frame aligned log address, log length,
+//           output buffer, its size in samples and a
+//           pointer for the number of samples read
+// Returns:  ERR_PAGE_BOUNDS or ERR_MEM_BOUNDS as for
+//           pack_EncInit, otherwise status of the reads
+// Summary:  Reads the log frame by frame with streaming
+//           reads and decodes it. Stops at the first
+//           blank frame or the first frame that does not
+//           fit in the output buffer
+//-------------------------------------------------------
+ee_Errors_t pack_Read(uint16_t,uint16_t,int16_t *,uint16_t,uint16_t *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EEPACK_H */
+
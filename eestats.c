@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * Runtime statistics for the EEPROM drivers
+ *
+ * Summary:
+ *  - Only built when EE_STATS is defined; the driver hooks are empty
+ *    macros otherwise
+ *  - Timer2/3 free run as a 32-bit time base. Latencies are measured
+ *    from submit to completion, so they include time spent queued
+ *  - Write cycle time runs from the stop bit of a page write to the ACK
+ *    of the poll that ends it. With lazy polling it is an upper bound.
+ *    Each chip select is timed on its own, so striped write cycles that
+ *    overlap on several devices are all counted
+ *  - Hooks run in the MI2C1 and NVM ISRs and from foreground reads and
+ *    polled waits, so every update holds both interrupts off
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "eestats.h"
+#include "obeeprom.h"
+
+#ifdef EE_STATS
+
+static ee_Stats_t stats_Block;
+static uint32_t stats_WcStart[STATS_DEVS];                                      //Per chip select; striped cycles overlap
+static uint8_t stats_WcTiming = 0;                                              //Bit per chip select, set between stop bit and ACK
+
+//Hold off the MI2C1 and NVM interrupts. Returns their enables
+static uint8_t stats_Hold(void){
+
+   uint8_t enables = (IEC1bits.MI2C1IE << 1) | _NVMIE;
+
+   IEC1bits.MI2C1IE = 0;
+   _NVMIE = 0;
+   return enables;
+}
+
+//Restore the enables stats_Hold saved
+static void stats_Release(uint8_t enables){
+
+   _NVMIE = enables & 1;
+   IEC1bits.MI2C1IE = enables >> 1;
+}
+
+//Clear the counters
+void stats_Reset(void){
+
+   uint8_t enables = stats_Hold();
+
+   memset(&stats_Block,0,sizeof(stats_Block));
+   stats_Block.wcMin = 0xFFFFFFFF;
+   stats_WcTiming = 0;
+   stats_Release(enables);
+}
+
+//Start the time base and clear the counters
+void stats_Init(void){
+
+   T2CON = 0x0000;
+   T2CONbits.T32 = 1;                                                           //Timer3 carries the upper word
+   T2CONbits.TCKPS = STATS_TCKPS;
+   TMR3HLD = 0;
+   TMR2 = 0;                                                                    //Loads TMR3 from TMR3HLD
+   PR3 = 0xFFFF;
+   PR2 = 0xFFFF;                                                                //Free run over the full 32 bits
+   T2CONbits.TON = 1;
+   stats_Reset();
+}
+
+//Copy the counters out in one piece
+void stats_Snapshot(ee_Stats_t *pStats){
+
+   uint8_t enables = stats_Hold();
+
+   memcpy(pStats,&stats_Block,sizeof(stats_Block));
+   stats_Release(enables);
+}
+
+//Current time base count. The TMR2 read latches TMR3 into TMR3HLD, so
+//both reads are made with the hooking ISRs held off
+uint32_t stats_Now(void){
+
+   uint8_t enables = stats_Hold();
+   uint16_t low = TMR2;
+   uint32_t now = ((uint32_t)TMR3HLD << 16) | low;
+
+   stats_Release(enables);
+   return now;
+}
+
+//Count a completed transaction and bucket its latency
+void stats_Xfer(uint8_t api, uint16_t len, uint32_t t0){
+
+   uint32_t ticks = stats_Now() - t0;                                           //Wraps cleanly below 35 minutes
+   uint8_t bucket = 0, enables;
+
+   while(ticks > 1 && bucket < STATS_BUCKETS - 1){
+      ticks >>= 1;
+      bucket++;
+   }
+
+   enables = stats_Hold();
+   stats_Block.calls[api]++;
+   stats_Block.bytes[api] += len;
+   stats_Block.hist[api < STATS_API_OBEE_ERASE ? STATS_HIST_LC01B : STATS_HIST_OBEE][bucket]++;
+   stats_Release(enables);
+}
+
+//Count a NACK'd ack poll attempt
+void stats_Poll(void){
+
+   uint8_t enables = stats_Hold();
+
+   stats_Block.polls++;
+   stats_Release(enables);
+}
+
+//Stop bit of a page write; the write cycle starts on that device
+void stats_WcBegin(uint8_t dev){
+
+   uint8_t enables = stats_Hold();
+
+   stats_WcStart[dev] = stats_Now();
+   stats_WcTiming |= 1 << dev;
+   stats_Release(enables);
+}
+
+//Ack poll answered; the device's write cycle is over
+void stats_WcEnd(uint8_t dev){
+
+   uint32_t ticks;
+   uint8_t enables = stats_Hold();
+
+   if(stats_WcTiming & (1 << dev)){
+      stats_WcTiming &= ~(1 << dev);
+      ticks = stats_Now() - stats_WcStart[dev];
+
+      stats_Block.wcCount++;
+      stats_Block.wcTotal += ticks;
+      if(ticks < stats_Block.wcMin)
+         stats_Block.wcMin = ticks;
+      if(ticks > stats_Block.wcMax)
+         stats_Block.wcMax = ticks;
+   }
+   stats_Release(enables);
+}
+
+//Count a page write cycle. Pages past STATS_PAGES are not tracked
+void stats_Page(uint16_t page){
+
+   uint8_t enables;
+
+   if(page < STATS_PAGES){
+      enables = stats_Hold();
+      stats_Block.pageWrites[page]++;
+      stats_Release(enables);
+   }
+}
+
+//Count an NVM cycle by opcode
+void stats_Nvm(uint16_t nvmOp){
+
+   uint8_t enables = stats_Hold();
+
+   switch(nvmOp){
+      case EE_ERASE_ONE:   stats_Block.nvmOps[STATS_NVM_ERASE_ONE]++;   break;
+      case EE_ERASE_FOUR:  stats_Block.nvmOps[STATS_NVM_ERASE_FOUR]++;  break;
+      case EE_ERASE_EIGHT: stats_Block.nvmOps[STATS_NVM_ERASE_EIGHT]++; break;
+      case EE_ERASE_BULK:  stats_Block.nvmOps[STATS_NVM_ERASE_BULK]++;  break;
+      case EE_WRITE_ER:    stats_Block.nvmOps[STATS_NVM_WRITE_ER]++;    break;
+      case EE_WRITE_NOE:   stats_Block.nvmOps[STATS_NVM_WRITE_NOE]++;   break;
+      default:             break;
+   }
+   stats_Release(enables);
+}
+
+#endif
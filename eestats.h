@@ -0,0 +1,115 @@
+/*
+ * File:   eestats.h
+ *
+ * Opt-in counters and latency histograms for the LC01B and on-board
+ * EEPROM drivers. Define EE_STATS for the whole project to build them
+ * in; without it the STATS_xxx hooks compile to nothing
+ */
+
+#ifndef EESTATS_H
+#define	EESTATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+//API slots. The LC01B slots match LC01B_XFER_xxx
+#define STATS_API_LC01B_WRITE   0
+#define STATS_API_LC01B_READ    1
+#define STATS_API_LC01B_READCUR 2
+#define STATS_API_LC01B_POLL    3
+#define STATS_API_LC01B_PROBE   4
+#define STATS_API_OBEE_ERASE    5
+#define STATS_API_OBEE_WRITE    6
+#define STATS_API_OBEE_READ     7
+#define STATS_APIS              8
+
+//NVM opcode slots
+#define STATS_NVM_ERASE_ONE   0
+#define STATS_NVM_ERASE_FOUR  1
+#define STATS_NVM_ERASE_EIGHT 2
+#define STATS_NVM_ERASE_BULK  3
+#define STATS_NVM_WRITE_ER    4
+#define STATS_NVM_WRITE_NOE   5
+#define STATS_NVM_OPS         6
+
+#define STATS_HIST_LC01B 0                                                      //Submit to completion, LC01B transactions
+#define STATS_HIST_OBEE  1                                                      //Submit to completion, NVM operations and reads
+#define STATS_HISTS      2
+#define STATS_BUCKETS    16                                                     //Bucket n holds 2^n to 2^(n+1)-1 ticks
+#define STATS_PAGES      16                                                     //Pages tracked; the whole 24LC01B
+#define STATS_DEVS       8                                                      //Write cycles timed per chip select
+
+//Timer2/3 free run as one 32-bit timer at FCY/8 as the time base: 0.5us
+//ticks at 16MHz, wrapping after about 35 minutes
+#define STATS_TCKPS      1                                                      //1:8 prescale
+
+typedef struct{
+   uint16_t calls[STATS_APIS];                                                  //Completed transactions
+   uint32_t bytes[STATS_APIS];                                                  //Bytes moved
+   uint16_t hist[STATS_HISTS][STATS_BUCKETS];                                   //Log2 latency buckets
+   uint32_t polls;                                                              //NACK'd ack poll attempts
+   uint16_t wcCount;                                                            //Write cycles timed
+   uint32_t wcMin;                                                              //Shortest write cycle, ticks
+   uint32_t wcMax;                                                              //Longest write cycle, ticks
+   uint32_t wcTotal;                                                            //Sum of timed write cycles, ticks
+   uint16_t nvmOps[STATS_NVM_OPS];                                              //NVM cycles by NVMCON opcode
+   uint16_t pageWrites[STATS_PAGES];                                            //Page write cycles per LC01B page
+}ee_Stats_t;
+
+#ifdef EE_STATS
+#define STATS_NOW()              stats_Now()
+#define STATS_XFER(api,len,t0)   stats_Xfer(api,len,t0)
+#define STATS_POLL()             stats_Poll()
+#define STATS_WC_BEGIN(ctrl)     stats_WcBegin(((ctrl) >> 1) & 0x07)
+#define STATS_WC_END(ctrl)       stats_WcEnd(((ctrl) >> 1) & 0x07)
+#define STATS_PAGE(page)         stats_Page(page)
+#define STATS_NVM(nvmOp)         stats_Nvm(nvmOp)
+#else
+#define STATS_NOW()              0
+#define STATS_XFER(api,len,t0)
+#define STATS_POLL()
+#define STATS_WC_BEGIN(ctrl)
+#define STATS_WC_END(ctrl)
+#define STATS_PAGE(page)
+#define STATS_NVM(nvmOp)
+#endif
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Nothing
+// Summary:  Starts Timer2/3 as the free running 32-bit
+//           time base and clears all counters
+//-------------------------------------------------------
+void stats_Init(void);
+
+//-------------------------------------------------------
+// Receives: Pointer to a stats block
+// Returns:  Nothing
+// Summary:  Copies the counters with the MI2C1 and NVM
+//           interrupts held off, ready to be dumped
+//-------------------------------------------------------
+void stats_Snapshot(ee_Stats_t *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Nothing
+// Summary:  Clears all counters
+//-------------------------------------------------------
+void stats_Reset(void);
+
+//Hooks called by the drivers through the STATS_xxx macros
+uint32_t stats_Now(void);
+void stats_Xfer(uint8_t,uint16_t,uint32_t);
+void stats_Poll(void);
+void stats_WcBegin(uint8_t);
+void stats_WcEnd(uint8_t);
+void stats_Page(uint16_t);
+void stats_Nvm(uint16_t);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EESTATS_H */
+
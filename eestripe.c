@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Page striping across several 24xx devices on I2C1
+ *
+ * Summary:
+ *  - Up to eight identical parts at different chip selects form one
+ *    logical address space. Logical page n lives on device n % count,
+ *    at device page n / count
+ *  - A 24xx part is busy for its whole write cycle (~3-5ms) but takes
+ *    a page in well under 1ms at 400kHz. Writes are queued one page per
+ *    transaction and complete at their stop bit, so while one device
+ *    runs its write cycle the bus is already moving the next page to
+ *    the next device. Only a device's own next page waits on its poll
+ *  - Reads go one page per transaction straight into the caller's
+ *    buffer, so the logical order is rebuilt without copying
+ *  - Up to one transaction per device is in the queue at a time
+ * *****************************************************************************/
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "eestripe.h"
+
+static lc01b_Dev_t *stripe_pDevs;
+static uint8_t stripe_Count = 0;
+
+//Check and keep the device set
+ee_Errors_t stripe_Init(lc01b_Dev_t *pDevs, uint8_t count){
+
+   uint8_t idx;
+
+   if(count == 0 || count > STRIPE_MAX_DEVS)
+      return ERR_MEM_BOUNDS;
+   for(idx=1; idx<count; idx++)
+      if(pDevs[idx].pageSize != pDevs[0].pageSize || pDevs[idx].maxAddr != pDevs[0].maxAddr)
+         return ERR_MEM_BOUNDS;
+
+   stripe_pDevs = pDevs;
+   stripe_Count = count;
+   return ERR_NONE;
+}
+
+//Bytes in the whole stripe set
+uint32_t stripe_Capacity(void){
+
+   return stripe_Count ? ((uint32_t)stripe_pDevs[0].maxAddr + 1) * stripe_Count : 0;
+}
+
+//Split a logical range into pages and queue each one on its device
+static ee_Errors_t stripe_Access(uint32_t addr, uint16_t len, uint8_t *pBuf, uint8_t write){
+
+   lc01b_Xfer_t xfers[STRIPE_MAX_DEVS];
+   uint16_t page, count, devAddr;
+   uint32_t unit;
+   uint8_t idx, slot = 0;
+   ee_Errors_t errCode = ERR_NONE, status;
+
+   if(addr + len > stripe_Capacity())
+      return ERR_MEM_BOUNDS;
+
+   page = stripe_pDevs[0].pageSize;
+   for(idx=0; idx<stripe_Count; idx++){
+      xfers[idx].busy = 0;
+      xfers[idx].errCode = ERR_NONE;
+   }
+
+   while(len && errCode == ERR_NONE){
+      unit = addr / page;
+      devAddr = (unit / stripe_Count) * page + addr % page;
+      count = page - addr % page;                                               //Rest of this page
+      if(count > len)
+         count = len;
+
+      errCode = lc01b_Wait(&xfers[slot]);                                       //Free the oldest handle
+      if(errCode == ERR_NONE){
+         if(write)
+            errCode = lc01b_WriteDevAsync(&xfers[slot],&stripe_pDevs[unit % stripe_Count],devAddr,count,pBuf,0);
+         else
+            errCode = lc01b_ReadDevAsync(&xfers[slot],&stripe_pDevs[unit % stripe_Count],devAddr,count,pBuf,0);
+      }
+      slot = (slot + 1) % stripe_Count;
+      addr += count;
+      pBuf += count;
+      len -= count;
+   }
+
+   //Drain the queue; keep the first error
+   for(idx=0; idx<stripe_Count; idx++){
+      status = lc01b_Wait(&xfers[idx]);
+      if(errCode == ERR_NONE)
+         errCode = status;
+   }
+   return errCode;
+}
+
+//Write across the stripe set
+ee_Errors_t stripe_Write(uint32_t addr, uint16_t len, void *pSrc){
+
+   return stripe_Access(addr,len,pSrc,1);
+}
+
+//Read across the stripe set
+ee_Errors_t stripe_Read(uint32_t addr, uint16_t len, void *pDst){
+
+   return stripe_Access(addr,len,pDst,0);
+}
+
+//Ack poll every device that may still be in a write cycle. A device that
+//never answers does not stop the rest being waited out
+ee_Errors_t stripe_Sync(void){
+
+   lc01b_Dev_t *pSelected = lc01b_GetDevice();
+   uint8_t idx;
+   ee_Errors_t errCode = ERR_NONE, status;
+
+   for(idx=0; idx<stripe_Count; idx++){
+      if(stripe_pDevs[idx].writeCycle){
+         lc01b_SetDevice(&stripe_pDevs[idx]);
+         status = ack_Poll();
+         if(errCode == ERR_NONE)
+            errCode = status;
+      }
+   }
+   lc01b_SetDevice(pSelected);
+   return errCode;
+}
@@ -0,0 +1,73 @@
+/*
+ * File:   eestripe.h
+ *
+ * Page striping across several 24xx devices on I2C1 at different chip
+ * selects. Requires sys.h and lc01b.h to be included first
+ */
+
+#ifndef EESTRIPE_H
+#define	EESTRIPE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define STRIPE_MAX_DEVS 8                                                       //One per chip select
+
+//-------------------------------------------------------
+// Receives: Array of device descriptors and the device
+//           count
+// Returns:  ERR_MEM_BOUNDS if the count is out of range
+//           or the devices differ in page size or
+//           capacity
+// Summary:  Sets up the stripe set. Logical page n lives
+//           on device n % count. Use parts with chip
+//           select pins (24LC64 and up); the 24LC01B and
+//           24LC02B answer at every select
+//-------------------------------------------------------
+ee_Errors_t stripe_Init(lc01b_Dev_t *,uint8_t);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Logical capacity in bytes
+// Summary:  Capacity of the whole stripe set
+//-------------------------------------------------------
+uint32_t stripe_Capacity(void);
+
+//-------------------------------------------------------
+// Receives: Logical address, data length and a pointer
+//           to the data
+// Returns:  Status of bounds check or of the first
+//           failed page write
+// Summary:  Queues one page write per device in turn.
+//           Each completes at its stop bit, so the next
+//           device takes its page while the last one is
+//           in its write cycle. Returns with the final
+//           write cycles still running
+//-------------------------------------------------------
+ee_Errors_t stripe_Write(uint32_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Logical address, read length and output
+//           buffer
+// Returns:  Status of bounds check or of the first
+//           failed read
+// Summary:  Reads each page from its device straight
+//           into place in the output buffer
+//-------------------------------------------------------
+ee_Errors_t stripe_Read(uint32_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  ERR_CNTL_NACK if a device never answered
+// Summary:  Waits out the write cycle on every device,
+//           including those after one that failed
+//-------------------------------------------------------
+ee_Errors_t stripe_Sync(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EESTRIPE_H */
+
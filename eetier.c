@@ -0,0 +1,331 @@
+/*******************************************************************************
+ * Tiered storage manager for the 24LC01B and the on-board EEPROM
+ *
+ * Summary:
+ *  - The application describes named regions; they are laid end to end
+ *    in one virtual address space in table order
+ *  - Every region has a home in the on-board EEPROM (512 bytes, reads
+ *    are table reads, 2 bytes per write cycle)
+ *  - Write-hot regions are promoted to page aligned slots on the
+ *    24LC01B (higher endurance, 8 bytes per write cycle). The home is
+ *    stale while a region is promoted
+ *  - Which regions are promoted is kept in a placement directory, an
+ *    A/B slot pair (eetxn.c) at the start of the bulk window
+ *  - Writes are counted per region and tier_Rebalance moves regions to
+ *    follow them. Promotion needs TIER_HOT_WRITES writes since the last
+ *    rebalance; a promoted region stays until it drops below half that
+ *
+ * The counters live in RAM, so after a reset the placement is kept
+ * until enough writes have been seen again
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eetxn.h"
+#include "eemirror.h"
+#include "eetier.h"
+
+#define TIER_CHUNK 16                                                           //Bounce buffer for partial word access
+
+static tier_Region_t *tier_pRegions;
+static uint8_t tier_Count = 0;
+
+//Placement directory: one slot byte per region
+static uint16_t tier_DirWork[TIER_DIR_LEN/WORD_LEN];
+static txn_t tier_Dir;
+
+//Fast tier page size
+static uint16_t tier_Page(void){
+
+   return lc01b_GetDevice()->pageSize;
+}
+
+//Fast tier pages a region needs
+static uint16_t tier_Pages(tier_Region_t *pRegion){
+
+   return (pRegion->len + tier_Page() - 1) / tier_Page();
+}
+
+//Even copy length; homes and slots both have room for the pad byte
+static uint16_t tier_CopyLen(tier_Region_t *pRegion){
+
+   return (pRegion->len + 1) & ~1;
+}
+
+//Read bytes from the on-board EEPROM at any alignment
+static void tier_ObeeRead(uint16_t offset, uint16_t len, uint8_t *pDst){
+
+   uint16_t bounce[TIER_CHUNK/WORD_LEN];
+   uint16_t first, span, skip;
+
+   while(len){
+      first = offset & ~1;
+      skip = offset - first;
+      span = (skip + len + 1) & ~1;
+      if(span > TIER_CHUNK)
+         span = TIER_CHUNK;
+      obee_ReadSeq(first,span,bounce);
+      if(span - skip > len)
+         span = len + skip;
+      memcpy(pDst,(uint8_t *)bounce + skip,span - skip);
+      pDst += span - skip;
+      offset += span - skip;
+      len -= span - skip;
+   }
+}
+
+//Write bytes to the on-board EEPROM at any alignment. Edge words are
+//read back so the neighbouring byte is kept
+static void tier_ObeeWrite(uint16_t offset, uint16_t len, uint8_t *pSrc){
+
+   uint16_t bounce[TIER_CHUNK/WORD_LEN];
+   uint16_t first, span, skip, count;
+
+   while(len){
+      first = offset & ~1;
+      skip = offset - first;
+      span = (skip + len + 1) & ~1;
+      if(span > TIER_CHUNK)
+         span = TIER_CHUNK;
+      count = (span - skip > len) ? len : span - skip;
+      if(skip || count + skip < span)
+         obee_ReadSeq(first,span,bounce);                                       //Partial edge word
+      memcpy((uint8_t *)bounce + skip,pSrc,count);
+      obee_WriteBulk(first,span,bounce);
+      pSrc += count;
+      offset += count;
+      len -= count;
+   }
+}
+
+//Save the slot of every region to the directory
+static ee_Errors_t tier_SaveDir(void){
+
+   uint8_t idx;
+
+   for(idx=0; idx<tier_Count; idx++)
+      tier_Dir.pWork[idx] = tier_pRegions[idx].slot;
+   return txn_Commit(&tier_Dir);
+}
+
+//First free run of fast tier pages for a region, or TIER_COLD
+static uint8_t tier_Alloc(uint8_t region){
+
+   uint16_t poolPages = TIER_FAST_LEN / tier_Page();
+   uint16_t need = tier_Pages(&tier_pRegions[region]);
+   uint16_t start, other, otherPages;
+   uint8_t idx, clash;
+
+   for(start=0; start + need <= poolPages; start++){
+      clash = 0;
+      for(idx=0; idx<tier_Count && !clash; idx++){
+         other = tier_pRegions[idx].slot;
+         if(idx == region || other == TIER_COLD)
+            continue;
+         otherPages = tier_Pages(&tier_pRegions[idx]);
+         clash = (start < other + otherPages) && (other < start + need);
+      }
+      if(!clash)
+         return start;
+   }
+   return TIER_COLD;
+}
+
+//Work out the hot set and move regions to match. With keepAuto set
+//only the pinned regions move
+static ee_Errors_t tier_Place(uint8_t keepAuto){
+
+   uint8_t order[TIER_MAX_REGIONS], want[TIER_MAX_REGIONS];
+   uint8_t idx, pos, key, slot, moved;
+   uint16_t budget = TIER_FAST_LEN / tier_Page();
+   tier_Region_t *pRegion;
+   ee_Errors_t errCode = ERR_NONE, dirErr;
+
+   //Pinned regions first, then by write count, highest first
+   for(idx=0; idx<tier_Count; idx++){
+      key = idx;
+      for(pos=idx; pos>0; pos--){
+         pRegion = &tier_pRegions[order[pos-1]];
+         if(pRegion->policy == TIER_PIN_FAST)
+            break;
+         if(tier_pRegions[key].policy != TIER_PIN_FAST && pRegion->writes >= tier_pRegions[key].writes)
+            break;
+         order[pos] = order[pos-1];
+      }
+      order[pos] = key;
+   }
+
+   //Take regions into the hot set while the fast tier has room
+   for(idx=0; idx<tier_Count; idx++){
+      pRegion = &tier_pRegions[order[idx]];
+      want[order[idx]] = 0;
+      if(pRegion->policy == TIER_PIN_BULK)
+         continue;
+      else if(pRegion->policy == TIER_AUTO){
+         if(keepAuto ? pRegion->slot == TIER_COLD
+                     : pRegion->writes < ((pRegion->slot == TIER_COLD) ? TIER_HOT_WRITES : TIER_HOT_WRITES/2))
+            continue;
+      }
+      if(tier_Pages(pRegion) <= budget){
+         budget -= tier_Pages(pRegion);
+         want[order[idx]] = 1;
+      }
+   }
+
+   //Demote first and commit, so promotions can reuse the slots
+   for(idx=0, moved=0; idx<tier_Count && errCode == ERR_NONE; idx++){
+      pRegion = &tier_pRegions[idx];
+      if(pRegion->slot != TIER_COLD && !want[idx]){
+         errCode = mirror_Lc01bToNvm(TIER_FAST_BASE + pRegion->slot*tier_Page(),pRegion->home,tier_CopyLen(pRegion));
+         if(errCode == ERR_NONE){                                               //Failed copies stay in the fast tier
+            pRegion->slot = TIER_COLD;
+            moved = 1;
+         }
+      }
+   }
+   if(moved){                                                                   //Record the moves that landed
+      dirErr = tier_SaveDir();
+      if(errCode == ERR_NONE)
+         errCode = dirErr;
+   }
+
+   //Copy in the promoted regions, then commit
+   for(idx=0, moved=0; idx<tier_Count && errCode == ERR_NONE; idx++){
+      pRegion = &tier_pRegions[idx];
+      if(pRegion->slot == TIER_COLD && want[idx]){
+         slot = tier_Alloc(idx);
+         if(slot == TIER_COLD)
+            continue;                                                           //Fragmented; try next time
+         errCode = mirror_NvmToLc01b(pRegion->home,TIER_FAST_BASE + slot*tier_Page(),tier_CopyLen(pRegion));
+         if(errCode == ERR_NONE){
+            pRegion->slot = slot;
+            moved = 1;
+         }
+      }
+   }
+   if(moved){
+      dirErr = tier_SaveDir();
+      if(errCode == ERR_NONE)
+         errCode = dirErr;
+   }
+   return errCode;
+}
+
+//Assign homes, load the directory and apply the pins
+ee_Errors_t tier_Init(tier_Region_t *pRegions, uint8_t count){
+
+   uint8_t idx;
+   uint16_t home = TIER_BULK_BASE + TIER_DIR_LEN;
+   ee_Errors_t errCode;
+
+   if(count > TIER_MAX_REGIONS)
+      return ERR_MEM_BOUNDS;
+
+   tier_pRegions = pRegions;
+   tier_Count = count;
+   for(idx=0; idx<count; idx++){
+      pRegions[idx].home = home;
+      pRegions[idx].writes = 0;
+      home += tier_CopyLen(&pRegions[idx]);
+   }
+   if(home > TIER_BULK_BASE + TIER_BULK_LEN)
+      return ERR_MEM_BOUNDS;
+
+   tier_Dir.media = TXN_OBEE;
+   tier_Dir.base = TIER_BULK_BASE;
+   tier_Dir.len = TIER_MAX_REGIONS;
+   tier_Dir.pWork = (uint8_t *)tier_DirWork;
+   errCode = txn_Open(&tier_Dir);
+   if(errCode != ERR_NONE && errCode != ERR_CRC)
+      return errCode;
+
+   //A blank or damaged directory leaves everything at home
+   for(idx=0; idx<count; idx++){
+      pRegions[idx].slot = (errCode == ERR_CRC) ? TIER_COLD : tier_Dir.pWork[idx];
+      if(pRegions[idx].slot != TIER_COLD
+         && (pRegions[idx].slot + tier_Pages(&pRegions[idx])) * tier_Page() > TIER_FAST_LEN)
+         pRegions[idx].slot = TIER_COLD;
+   }
+   return tier_Place(1);
+}
+
+//Virtual address of a named region
+uint16_t tier_Find(const char *pName){
+
+   uint8_t idx;
+   uint16_t vaddr = 0;
+
+   for(idx=0; idx<tier_Count; idx++){
+      if(strcmp(tier_pRegions[idx].name,pName) == 0)
+         return vaddr;
+      vaddr += tier_pRegions[idx].len;
+   }
+   return TIER_NOT_FOUND;
+}
+
+//Split a virtual range into per region pieces and move each one
+static ee_Errors_t tier_Access(uint16_t vaddr, uint16_t len, uint8_t *pBuf, uint8_t write){
+
+   uint8_t idx;
+   uint16_t start = 0, offset, count;
+   uint32_t total = 0;
+   tier_Region_t *pRegion;
+   ee_Errors_t errCode = ERR_NONE;
+
+   for(idx=0; idx<tier_Count; idx++)
+      total += tier_pRegions[idx].len;
+   if((uint32_t)vaddr + len > total)
+      return ERR_MEM_BOUNDS;
+
+   for(idx=0; idx<tier_Count && len && errCode == ERR_NONE; idx++){
+      pRegion = &tier_pRegions[idx];
+      if(vaddr >= start && vaddr < start + pRegion->len){
+         offset = vaddr - start;
+         count = (len > pRegion->len - offset) ? pRegion->len - offset : len;
+
+         if(pRegion->slot != TIER_COLD){
+            if(write)
+               errCode = lc01b_Write(TIER_FAST_BASE + pRegion->slot*tier_Page() + offset,count,pBuf);
+            else
+               errCode = lc01b_ReadSeq(TIER_FAST_BASE + pRegion->slot*tier_Page() + offset,count,pBuf);
+         }
+         else if(write)
+            tier_ObeeWrite(pRegion->home + offset,count,pBuf);
+         else
+            tier_ObeeRead(pRegion->home + offset,count,pBuf);
+
+         if(write && pRegion->writes < 0xFFFF)
+            pRegion->writes++;
+         vaddr += count;
+         pBuf += count;
+         len -= count;
+      }
+      start += pRegion->len;
+   }
+   return errCode;
+}
+
+//Read from the virtual address space
+ee_Errors_t tier_Read(uint16_t vaddr, uint16_t len, void *pBuf){
+
+   return tier_Access(vaddr,len,pBuf,0);
+}
+
+//Write to the virtual address space
+ee_Errors_t tier_Write(uint16_t vaddr, uint16_t len, void *pBuf){
+
+   return tier_Access(vaddr,len,pBuf,1);
+}
+
+//Follow the observed write rates, then age the counters
+ee_Errors_t tier_Rebalance(void){
+
+   uint8_t idx;
+   ee_Errors_t errCode = tier_Place(0);
+
+   for(idx=0; idx<tier_Count; idx++)
+      tier_pRegions[idx].writes >>= 1;
+   return errCode;
+}
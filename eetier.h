@@ -0,0 +1,106 @@
+/*
+ * File:   eetier.h
+ *
+ * Tiered storage manager. Named regions live in one virtual address
+ * space. Write-hot regions are placed on the 24LC01B; everything else
+ * lives in the on-board EEPROM. Requires sys.h, lc01b.h, obeeprom.h
+ * and eetxn.h to be included first
+ */
+
+#ifndef EETIER_H
+#define	EETIER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define TIER_MAX_REGIONS 8
+
+//Fast tier window on the 24LC01B. Hot regions get page aligned slots
+#define TIER_FAST_BASE   0x00
+#define TIER_FAST_LEN    LC01B_CAP
+
+//Bulk tier window in the on-board EEPROM. The placement directory's
+//A/B slots come first, then every region's home
+#define TIER_BULK_BASE   OFFSET_ZERO
+#define TIER_BULK_LEN    (OFFSET_LAST + 1)
+#define TIER_DIR_LEN     TXN_WORK_LEN(TXN_OBEE_PAGE,TIER_MAX_REGIONS)
+
+//Placement policies
+#define TIER_AUTO        0                                                      //Follows the observed write rate
+#define TIER_PIN_FAST    1                                                      //Always on the 24LC01B
+#define TIER_PIN_BULK    2                                                      //Always in the on-board EEPROM
+
+#define TIER_HOT_WRITES  4                                                      //Writes between rebalances to be promoted
+#define TIER_COLD        0xFF                                                   //Slot value of a region in the bulk tier
+#define TIER_NOT_FOUND   0xFFFF
+
+//Region table entry. The application fills in name, len and policy;
+//the table must keep the same order and sizes across resets
+typedef struct{
+   const char        *name;                                                     //Lookup name
+   uint16_t          len;                                                       //Bytes
+   uint8_t           policy;                                                    //TIER_AUTO or TIER_PIN_xxx
+   uint8_t           slot;                                                      //Fast tier page index or TIER_COLD
+   uint16_t          home;                                                      //Offset of its home in the on-board EEPROM
+   uint16_t          writes;                                                    //Writes since the last rebalance, halved each time
+}tier_Region_t;
+
+//-------------------------------------------------------
+// Receives: Region table and region count
+// Returns:  ERR_MEM_BOUNDS if the homes do not fit in
+//           the bulk window, otherwise status of the
+//           placement
+// Summary:  Assigns each region its home, loads the
+//           placement directory and puts TIER_PIN_FAST
+//           regions on the 24LC01B. A blank directory
+//           starts every region in the bulk tier
+//-------------------------------------------------------
+ee_Errors_t tier_Init(tier_Region_t *,uint8_t);
+
+//-------------------------------------------------------
+// Receives: Region name
+// Returns:  Virtual address of the region or
+//           TIER_NOT_FOUND
+// Summary:  Looks a region up by name
+//-------------------------------------------------------
+uint16_t tier_Find(const char *);
+
+//-------------------------------------------------------
+// Receives: Virtual address, read length and output
+//           buffer
+// Returns:  Status of bounds check or of the read
+// Summary:  Reads from whichever tier holds each region
+//           the range covers
+//-------------------------------------------------------
+ee_Errors_t tier_Read(uint16_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Virtual address, data length and a pointer
+//           to the data
+// Returns:  Status of bounds check or of the write
+// Summary:  Writes to whichever tier holds each region
+//           and counts the write towards promotion
+//-------------------------------------------------------
+ee_Errors_t tier_Write(uint16_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Status of the first failed copy or
+//           directory commit
+// Summary:  Moves regions between tiers. The most
+//           written regions with at least TIER_HOT_WRITES
+//           writes go to the 24LC01B as far as it has
+//           room; the rest go home. Demotions are copied
+//           and committed before any promotion reuses
+//           their slots, so a reset part way through
+//           loses nothing. Call it periodically
+//-------------------------------------------------------
+ee_Errors_t tier_Rebalance(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EETIER_H */
+
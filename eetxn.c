@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * A/B slot transactions for the 24LC01B and the on-board EEPROM
+ *
+ * Summary:
+ *  - A slot pair holds two copies of a payload, slot B directly after
+ *    slot A. Each slot is the payload rounded up to whole pages followed
+ *    by a seal page
+ *  - Objects are staged in a RAM image and committed to the slot that
+ *    does not hold the last commit
+ *  - The payload goes out first; the seal (magic, sequence number and a
+ *    CRC-16 over the sequence number and payload) is the final page write
+ *  - A commit cut short by a brownout leaves a slot whose seal does not
+ *    match its payload, so the other slot is still picked
+ *  - txn_Open reads both slots in one sequential read and stages the
+ *    valid slot with the newest sequence number
+ *
+ * Seal layout: TXN_MAGIC, seq high, seq low, CRC high, CRC low, ~TXN_MAGIC
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eetxn.h"
+
+//Page size of the slot pair's media
+static uint16_t txn_Page(txn_t *pTxn){
+
+   return (pTxn->media == TXN_LC01B) ? lc01b_GetDevice()->pageSize : TXN_OBEE_PAGE;
+}
+
+//Slot pair placement: base on a page boundary of the media and, in the
+//on-board EEPROM, both slots inside it
+static ee_Errors_t txn_Bounds(txn_t *pTxn, uint16_t page, uint16_t slotLen){
+
+   if(pTxn->base % page)
+      return ERR_MEM_BOUNDS;
+   else if(pTxn->media == TXN_OBEE && pTxn->base + 2*slotLen > OFFSET_LAST + 1)
+      return ERR_MEM_BOUNDS;
+   return ERR_NONE;
+}
+
+//CRC-16 over the sequence number and the payload
+static uint16_t txn_Crc(uint16_t seq, uint8_t *pPayload, uint16_t len){
+
+   uint8_t seqBytes[2];
+
+   seqBytes[0] = seq >> 8;
+   seqBytes[1] = seq & 0xFF;
+   return lc01b_Crc(LC01B_CRC16,lc01b_Crc(LC01B_CRC16,LC01B_CRC_INIT(LC01B_CRC16),seqBytes,2),pPayload,len);
+}
+
+//Non-zero if a slot image read back from the media is sealed and intact
+static uint8_t txn_Valid(txn_t *pTxn, uint8_t *pSlot, uint16_t sealPos, uint16_t *pSeq){
+
+   uint8_t *pSeal = pSlot + sealPos;
+   uint16_t seq = ((uint16_t)pSeal[1] << 8) | pSeal[2];
+   uint16_t crc = ((uint16_t)pSeal[3] << 8) | pSeal[4];
+
+   if(pSeal[0] != TXN_MAGIC || pSeal[5] != (uint8_t)~TXN_MAGIC)
+      return 0;
+   else if(txn_Crc(seq,pSlot,pTxn->len) != crc)
+      return 0;
+   *pSeq = seq;
+   return 1;
+}
+
+//Read both slots and stage the newest valid one
+ee_Errors_t txn_Open(txn_t *pTxn){
+
+   uint16_t page = txn_Page(pTxn);
+   uint16_t slotLen = TXN_SLOT_LEN(page,pTxn->len);
+   uint16_t seqA, seqB;
+   uint8_t validA, validB;
+   ee_Errors_t errCode = txn_Bounds(pTxn,page,slotLen);
+
+   if(errCode == ERR_NONE && pTxn->media == TXN_LC01B)
+      errCode = lc01b_ReadSeq(pTxn->base,2*slotLen,pTxn->pWork);                //Both slots, one transaction
+   else if(errCode == ERR_NONE)
+      obee_ReadSeq(pTxn->base,2*slotLen,(uint16_t *)pTxn->pWork);
+
+   pTxn->active = TXN_NONE;
+   pTxn->seq = 0;
+   if(errCode)
+      return errCode;
+
+   validA = txn_Valid(pTxn,pTxn->pWork,slotLen - page,&seqA);
+   validB = txn_Valid(pTxn,pTxn->pWork + slotLen,slotLen - page,&seqB);
+
+   if(validB && (!validA || (int16_t)(seqB - seqA) > 0)){                       //Sequence numbers may wrap
+      memmove(pTxn->pWork,pTxn->pWork + slotLen,pTxn->len);
+      pTxn->active = 1;
+      pTxn->seq = seqB;
+   }
+   else if(validA){
+      pTxn->active = 0;
+      pTxn->seq = seqA;
+   }
+   else{
+      memset(pTxn->pWork,0xFF,pTxn->len);
+      return ERR_CRC;
+   }
+   return ERR_NONE;
+}
+
+//Update the staged image
+ee_Errors_t txn_Stage(txn_t *pTxn, uint16_t offset, uint16_t len, void *pSrc){
+
+   if((uint32_t)offset + len > pTxn->len)
+      return ERR_MEM_BOUNDS;
+   memcpy(pTxn->pWork + offset,pSrc,len);
+   return ERR_NONE;
+}
+
+//Read from the staged image
+ee_Errors_t txn_Get(txn_t *pTxn, uint16_t offset, uint16_t len, void *pDst){
+
+   if((uint32_t)offset + len > pTxn->len)
+      return ERR_MEM_BOUNDS;
+   memcpy(pDst,pTxn->pWork + offset,len);
+   return ERR_NONE;
+}
+
+//Write the staged image to the inactive slot and seal it
+ee_Errors_t txn_Commit(txn_t *pTxn){
+
+   uint16_t page = txn_Page(pTxn);
+   uint16_t slotLen = TXN_SLOT_LEN(page,pTxn->len);
+   uint8_t target = (pTxn->active == 0) ? 1 : 0;
+   uint16_t slotAddr = pTxn->base + target*slotLen;
+   uint16_t seq = pTxn->seq + 1;
+   uint16_t crc = txn_Crc(seq,pTxn->pWork,pTxn->len);
+   uint16_t sealWords[TXN_SEAL_LEN/WORD_LEN];                                   //Word aligned for the on-board EEPROM
+   uint8_t *pSeal = (uint8_t *)sealWords;
+   ee_Errors_t errCode = txn_Bounds(pTxn,page,slotLen);
+
+   pSeal[0] = TXN_MAGIC;
+   pSeal[1] = seq >> 8;
+   pSeal[2] = seq & 0xFF;
+   pSeal[3] = crc >> 8;
+   pSeal[4] = crc & 0xFF;
+   pSeal[5] = (uint8_t)~TXN_MAGIC;
+
+   //Payload first, seal last
+   if(errCode == ERR_NONE && pTxn->media == TXN_LC01B){
+      errCode = lc01b_Write(slotAddr,pTxn->len,pTxn->pWork);
+      if(errCode == ERR_NONE)
+         errCode = lc01b_WritePage(slotAddr + slotLen - page,TXN_SEAL_LEN,pSeal);
+   }
+   else if(errCode == ERR_NONE){
+      obee_WriteBulk(slotAddr,(pTxn->len + 1) & ~1,(uint16_t *)pTxn->pWork);
+      obee_WriteBulk(slotAddr + slotLen - page,TXN_SEAL_LEN,sealWords);
+   }
+
+   if(errCode == ERR_NONE){
+      pTxn->active = target;
+      pTxn->seq = seq;
+   }
+   return errCode;
+}
@@ -0,0 +1,84 @@
+/*
+ * File:   eetxn.h
+ *
+ * Power-fail atomic multi-object commits using two A/B slots on the
+ * 24LC01B or the on-board EEPROM. Requires sys.h, lc01b.h and
+ * obeeprom.h to be included first
+ */
+
+#ifndef EETXN_H
+#define	EETXN_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define TXN_LC01B    0                                                          //Slots on the selected 24xx device
+#define TXN_OBEE     1                                                          //Slots in the on-board EEPROM
+#define TXN_OBEE_PAGE (ERASE_ROW*WORD_LEN)                                      //Slot alignment in the on-board EEPROM
+#define TXN_NONE     0xFF                                                       //No valid slot yet
+
+#define TXN_MAGIC    0xA5
+#define TXN_SEAL_LEN 6                                                          //Magic, sequence, CRC-16, ~magic
+
+//Bytes per slot: the payload rounded up to whole pages plus a seal page
+#define TXN_SLOT_LEN(page,len) ((((len) + (page) - 1) / (page)) * (page) + (page))
+
+//Work area for txn_t.pWork. Open reads both slots into it at once
+#define TXN_WORK_LEN(page,len) (2 * TXN_SLOT_LEN(page,len))
+
+//Slot pair. Fill in media, base, len and pWork before txn_Open
+typedef struct{
+   uint8_t           media;                                                     //TXN_LC01B or TXN_OBEE
+   uint16_t          base;                                                      //Page aligned start of slot A; slot B follows it
+   uint16_t          len;                                                       //Payload bytes
+   uint8_t           *pWork;                                                    //TXN_WORK_LEN bytes, word aligned for TXN_OBEE
+   uint8_t           active;                                                    //Slot holding the last commit, 0 = A, 1 = B
+   uint16_t          seq;                                                       //Sequence number of the last commit
+}txn_t;
+
+//-------------------------------------------------------
+// Receives: Slot pair
+// Returns:  ERR_CRC if neither slot is valid,
+//           ERR_MEM_BOUNDS if base is not page aligned,
+//           otherwise status of the read
+// Summary:  Reads both slots in one sequential read and
+//           stages the newest valid one. With no valid
+//           slot the staged image is cleared to 0xFF
+//-------------------------------------------------------
+ee_Errors_t txn_Open(txn_t *);
+
+//-------------------------------------------------------
+// Receives: Slot pair, payload offset, length and data
+// Returns:  Status of bounds check
+// Summary:  Updates the staged image in RAM. Nothing is
+//           written until txn_Commit
+//-------------------------------------------------------
+ee_Errors_t txn_Stage(txn_t *,uint16_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Slot pair, payload offset, length and output
+//           pointer
+// Returns:  Status of bounds check
+// Summary:  Reads from the staged image
+//-------------------------------------------------------
+ee_Errors_t txn_Get(txn_t *,uint16_t,uint16_t,void *);
+
+//-------------------------------------------------------
+// Receives: Slot pair
+// Returns:  ERR_MEM_BOUNDS if base is not page aligned,
+//           otherwise status of the first failed write
+// Summary:  Writes the staged image to the inactive
+//           slot, then seals it with the next sequence
+//           number and a CRC-16 in a final page write.
+//           A commit cut short leaves the other slot as
+//           the newest valid one
+//-------------------------------------------------------
+ee_Errors_t txn_Commit(txn_t *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* EETXN_H */
+
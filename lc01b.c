@@ -3,6 +3,7 @@
  * 
  * Resources used:
  * I2C1
+ * MI2C1 interrupt
  * 
  * Summary:
  * The 24LC01B:
@@ -14,214 +15,1353 @@
  *  
  * Use 4K7 pullups for a 100kHz bus and 2K2 pullups on a 400kHz bus
  * Acknowledge polling is used on all writes
+ * Multi-byte writes are split on page boundaries so each write cycle
+ * commits up to a full page
+ *
+ * Transfers are run by a queued state machine that advances once per
+ * MI2C1 event (start, transmit, receive, ack or stop complete). The
+ * async functions queue a transaction and return immediately; the
+ * blocking functions queue one and wait on it. If the MI2C1 interrupt
+ * is disabled the waiting caller runs the state machine itself
+ *
+ * The driver works from a device descriptor (lc01b_Dev_t) giving page
+ * size, capacity, address width, block bits and chip select, so larger
+ * 24xx parts with 16-128 byte pages and two address bytes are driven
+ * the same way. The 24LC01B is the default device
+ *
+ * With lazy polling enabled a write completes at its final stop bit
+ * and the device is flagged busy. The next transaction of any kind
+ * starts with the ack poll, so the write cycle overlaps whatever the
+ * application does in between
  * *****************************************************************************
  * 02/2023 Adam Hout           -Original source
  * ****************************************************************************/
 //#include <p24F16KA102.h>
 #include <xc.h>
+#include <string.h>
 #include "sys.h"
+#include <libpic30.h>
 #include "lc01b.h"
+#include "eestats.h"
+
+//Transaction engine states. Each one names the bus event that
+//raised the MI2C1 interrupt
+enum{
+   ST_IDLE = 0,                                                                 //Nothing queued
+   ST_START,                                                                    //Start bit sent
+   ST_CTRL_W,                                                                   //Control byte (write) sent
+   ST_ADDR_HI,                                                                  //High memory address byte sent
+   ST_ADDR,                                                                     //Memory address byte sent
+   ST_TX_DATA,                                                                  //Data byte sent
+   ST_STOP_W,                                                                   //Stop after a page write
+   ST_POLL_START,                                                               //Start bit of an ack poll
+   ST_POLL_CTRL,                                                                //Control byte of an ack poll
+   ST_POLL_STOP,                                                                //Stop after a NACK'd poll
+   ST_RSTART,                                                                   //Repeated start sent
+   ST_CTRL_R,                                                                   //Control byte (read) sent
+   ST_RECV,                                                                     //Data byte received
+   ST_ACK,                                                                      //ACK sent, more to read
+   ST_NACK,                                                                     //NACK sent after last byte
+   ST_STOP_DONE                                                                 //Final stop bit sent
+};
 
 //EEPROM error enum from sys.h
 ee_Errors_t ee_Error;
 
+//Device used by the lc01b_xxx calls. Starts out as the 24LC01B
+static lc01b_Dev_t lc01b_Default = LC01B_DEV_24LC01B;
+static lc01b_Dev_t *lc01b_pDev = &lc01b_Default;
+
+//Transaction queue and engine state. Only touched by the ISR once a
+//transaction is queued
+static lc01b_Xfer_t * volatile lc01b_pHead = 0;
+static lc01b_Xfer_t *lc01b_pTail = 0;
+static volatile uint8_t lc01b_State = ST_IDLE;
+static uint16_t lc01b_Pos;                                                      //Bytes moved in the current transaction
+static uint16_t lc01b_BurstEnd;                                                 //Position that ends the current page burst
+
+//Lazy acknowledge polling. Each device tracks its own write cycle
+static uint8_t lc01b_Lazy = 0;                                                  //Non-zero to defer the ack poll
+
+//Time budgets, set from the BRG by init_I2C
+static uint16_t lc01b_EventBudget = 0xFFFF;                                     //Wait loop spins allowed per bus event
+static uint16_t lc01b_PollLimit = 0xFFFF;                                       //Ack poll attempts before giving up
+static uint16_t lc01b_Polls;                                                    //Attempts in the current ack poll
+static volatile uint8_t lc01b_Events;                                           //Bumped on every bus event
+
+//Bus recovery. lc01b_Fail may run in the ISR, so it only flags the
+//recovery; the main line runs it from lc01b_Wait or the next submit
+static volatile uint8_t lc01b_RecoverPending = 0;                               //Queue held until the bus is recovered
+static uint16_t lc01b_Brg;                                                      //BRG given to init_I2C
+
+//Address pointer shadows are only trusted when learned since the last
+//init_I2C, so a re-init forgets them on every descriptor at once
+static uint16_t lc01b_Epoch = 1;                                                //Never 0, bumped by init_I2C
+
+//---------------------------------------------------------------
+//Control byte (write mode) for an address. Parts with block bits
+//carry the upper address bits in the control byte
+//---------------------------------------------------------------
+static uint8_t lc01b_Ctrl(lc01b_Dev_t *pDev,uint16_t ee_addr){
+
+   uint8_t block = (pDev->addrBytes == 2) ? 0 : (ee_addr >> 8) & ((1 << pDev->blockBits) - 1);
+
+   return pDev->ctrl | (block << 1);
+}
+
+//Nibble tables for the object CRCs; 48 bytes of flash
+static const uint8_t lc01b_Crc8Table[16] = {
+   0x00,0x07,0x0E,0x09,0x1C,0x1B,0x12,0x15,0x38,0x3F,0x36,0x31,0x24,0x23,0x2A,0x2D
+};
+static const uint16_t lc01b_Crc16Table[16] = {
+   0x0000,0x1021,0x2042,0x3063,0x4084,0x50A5,0x60C6,0x70E7,
+   0x8108,0x9129,0xA14A,0xB16B,0xC18C,0xD1AD,0xE1CE,0xF1EF
+};
+
+//---------------------------------------------------------------
+//Fold one byte into a running CRC-8 or CRC-16
+//---------------------------------------------------------------
+static uint16_t lc01b_CrcStep(uint8_t crcType,uint16_t crc,uint8_t dataByte){
+
+   if(crcType == LC01B_CRC8){
+      crc ^= dataByte;
+      crc = ((crc << 4) ^ lc01b_Crc8Table[(crc >> 4) & 0x0F]) & 0xFF;
+      crc = ((crc << 4) ^ lc01b_Crc8Table[(crc >> 4) & 0x0F]) & 0xFF;
+   }
+   else if(crcType == LC01B_CRC16){
+      crc ^= (uint16_t)dataByte << 8;
+      crc = (crc << 4) ^ lc01b_Crc16Table[crc >> 12];
+      crc = (crc << 4) ^ lc01b_Crc16Table[crc >> 12];
+   }
+   return crc;
+}
+
+//---------------------------------------------------------------
+//Fold one byte into a transaction's running CRC
+//---------------------------------------------------------------
+static void lc01b_CrcByte(lc01b_Xfer_t *pXfer,uint8_t dataByte){
+
+   pXfer->crc = lc01b_CrcStep(pXfer->crcLen,pXfer->crc,dataByte);
+}
+
+//---------------------------------------------------------------
+//CRC of a RAM buffer, continuing from crc. Start from
+//LC01B_CRC_INIT for a fresh CRC
+//---------------------------------------------------------------
+uint16_t lc01b_Crc(uint8_t crcType,uint16_t crc,void *pData,uint16_t len){
+
+   uint8_t *pByte = pData;
+
+   while(len--)
+      crc = lc01b_CrcStep(crcType,crc,*pByte++);
+   return crc;
+}
+
+//---------------------------------------------------------------
+//Next byte of a write. The CRC bytes follow the client data
+//---------------------------------------------------------------
+static uint8_t lc01b_TxNext(lc01b_Xfer_t *pXfer){
+
+   uint16_t pos = lc01b_Pos++;
+   uint16_t dataLen = pXfer->len - pXfer->crcLen;
+   uint8_t dataByte;
+
+   if(pXfer->patLen)
+      dataByte = pXfer->pData[pos % pXfer->patLen];                             //Pattern repeats over the range
+   else if(pos < dataLen){
+      dataByte = pXfer->pData[pos];
+      if(pXfer->crcLen)
+         lc01b_CrcByte(pXfer,dataByte);
+   }
+   else if(pos + 1 < pXfer->len)
+      dataByte = pXfer->crc >> 8;                                               //High CRC byte
+   else
+      dataByte = pXfer->crc & 0xFF;
+   return dataByte;
+}
+
+//---------------------------------------------------------------
+//Store a received byte. CRC bytes are only folded into the CRC,
+//which comes out zero when everything arrived intact. Pattern
+//reads compare instead of storing
+//---------------------------------------------------------------
+static void lc01b_RxNext(lc01b_Xfer_t *pXfer,uint8_t dataByte){
+
+   uint16_t pos = lc01b_Pos++;
+
+   if(pXfer->patLen){
+      if(pXfer->mismatch == LC01B_NO_MISMATCH && dataByte != pXfer->pData[pos % pXfer->patLen])
+         pXfer->mismatch = pos;
+   }
+   else if(pos < pXfer->len - pXfer->crcLen)
+      pXfer->pData[pos] = dataByte;
+   if(pXfer->crcLen)
+      lc01b_CrcByte(pXfer,dataByte);
+}
+
+//---------------------------------------------------------------
+//Non-zero if a range runs past the end of the device
+//---------------------------------------------------------------
+static uint8_t lc01b_OutOfBounds(lc01b_Dev_t *pDev,uint16_t ee_addr,uint16_t len){
+
+   return len != 0 && ((uint32_t)ee_addr + len - 1) > pDev->maxAddr;
+}
+
+//---------------------------------------------------------------
+//Send one byte and check the ACK, within the event budget
+//---------------------------------------------------------------
+static ee_Errors_t lc01b_TxByte(uint8_t dataByte,ee_Errors_t nackErr){
+
+   uint16_t spins = lc01b_EventBudget;
+
+   I2C1TRN = dataByte;
+   while(I2C1STATbits.TRSTAT)                                                   //Wait for transmit to complete
+      if(--spins == 0)
+         return ERR_BUS_TIMEOUT;
+   return I2C1STATbits.ACKSTAT ? nackErr : ERR_NONE;
+}
+
 //---------------------------------------------------------------
 //Send the Start bit, Control byte and Memory byte to the LC01B. 
 //---------------------------------------------------------------
-void lc01b_SCM(uint8_t ee_addr){
+ee_Errors_t lc01b_SCM(uint16_t ee_addr){
    
+   uint16_t spins = lc01b_EventBudget;
+   ee_Errors_t errCode;
+
    //Send the start bit
    I2C1CONbits.SEN = 1;                                                         //Start enable
-   while(I2C1CONbits.SEN);                                                      //Wait for completion
+   while(I2C1CONbits.SEN)                                                       //Wait for completion
+      if(--spins == 0)
+         return ERR_BUS_TIMEOUT;
    
    //Send the control byte                                                    
-   I2C1TRN = LC01B_WRITE;                                                       //Control byte; Write mode
-   while(I2C1STATbits.TRSTAT);                                                  //Wait for transmit to complete
-   while(I2C1STATbits.ACKSTAT);                                                  
+   errCode = lc01b_TxByte(lc01b_Ctrl(lc01b_pDev,ee_addr),ERR_CNTL_NACK);        //Control byte; Write mode
+   
+   //Send the high memory address byte on two byte parts
+   if(errCode == ERR_NONE && lc01b_pDev->addrBytes == 2)
+      errCode = lc01b_TxByte(ee_addr >> 8,ERR_MEM_NACK);
       
    //Send the memory address byte
-   I2C1TRN = ee_addr;                                                           
-   while(I2C1STATbits.TRSTAT);   
-   while(I2C1STATbits.ACKSTAT);
+   if(errCode == ERR_NONE)
+      errCode = lc01b_TxByte(ee_addr & 0xFF,ERR_MEM_NACK);
+
+   if(errCode != ERR_NONE)
+      I2C1CONbits.PEN = 1;                                                      //Release the bus
+   return errCode;
+}
+
+//---------------------------------------------------------------
+//Work out where the next page burst of a write ends
+//---------------------------------------------------------------
+static void lc01b_NextBurst(lc01b_Xfer_t *pXfer){
+
+   uint8_t page = pXfer->pDev->pageSize;
+   uint16_t burst = page - ((pXfer->ee_addr + lc01b_Pos) % page);               //Bytes left in the current page
+
+   if(burst > pXfer->len - lc01b_Pos)
+      burst = pXfer->len - lc01b_Pos;
+   lc01b_BurstEnd = lc01b_Pos + burst;
+}
+
+//---------------------------------------------------------------
+//Send the memory address of the current position. Two byte parts
+//get the high byte first
+//---------------------------------------------------------------
+static void lc01b_SendAddr(lc01b_Xfer_t *pXfer){
+
+   uint16_t ee_addr = pXfer->ee_addr + lc01b_Pos;
+
+   if(pXfer->pDev->addrBytes == 2){
+      I2C1TRN = ee_addr >> 8;
+      lc01b_State = ST_ADDR_HI;
+   }
+   else{
+      I2C1TRN = ee_addr & 0xFF;
+      lc01b_State = ST_ADDR;
+   }
+}
+
+//---------------------------------------------------------------
+//Begin the transaction at the head of the queue
+//---------------------------------------------------------------
+static void lc01b_Begin(void){
+
+   lc01b_Pos = 0;
+   lc01b_Polls = 0;
+   if(lc01b_pHead->type == LC01B_XFER_WRITE)
+      lc01b_NextBurst(lc01b_pHead);
+   if(lc01b_pHead->pDev->writeCycle || lc01b_pHead->type == LC01B_XFER_POLL || lc01b_pHead->type == LC01B_XFER_PROBE)
+      lc01b_State = ST_POLL_START;                                              //Wait out the write cycle first
+   else
+      lc01b_State = ST_START;
+   I2C1CONbits.SEN = 1;                                                         //Start enable
+}
+
+//---------------------------------------------------------------
+//Non-zero if the device's address pointer shadow can be trusted
+//---------------------------------------------------------------
+static uint8_t lc01b_PtrKnown(const lc01b_Dev_t *pDev){
+
+   return pDev->ptrEpoch == lc01b_Epoch;
+}
+
+//---------------------------------------------------------------
+//Retire the head transaction and start the next one, if any
+//---------------------------------------------------------------
+static void lc01b_Finish(void){
+
+   lc01b_Xfer_t *pXfer = lc01b_pHead;
+   lc01b_Dev_t *pDev = pXfer->pDev;
+
+   //Keep the address pointer shadow in step with the device
+   if(pXfer->errCode)
+      pDev->ptrEpoch = 0;
+   else if(pXfer->type == LC01B_XFER_READ){
+      pDev->addrPtr = (pXfer->ee_addr + pXfer->len) & pDev->maxAddr;            //Device pointer follows the read
+      pDev->ptrEpoch = lc01b_Epoch;
+   }
+   else if(pXfer->type == LC01B_XFER_READCUR)
+      pDev->addrPtr = (pDev->addrPtr + pXfer->len) & pDev->maxAddr;
+   else if(pXfer->type == LC01B_XFER_WRITE)
+      pDev->ptrEpoch = 0;                                                       //Pointer rolls over within the page
+   STATS_XFER(pXfer->type,pXfer->errCode ? 0 : pXfer->len,pXfer->t0);
+
+   //Dequeue and start the next transaction before the callback so
+   //the callback may queue a follow-up. A bus awaiting recovery
+   //holds the queue
+   lc01b_pHead = pXfer->pNext;
+   if(lc01b_pHead){
+      if(!lc01b_RecoverPending)
+         lc01b_Begin();
+   }
+   else{
+      lc01b_pTail = 0;
+      lc01b_State = ST_IDLE;
+   }
+   pXfer->busy = 0;
+   if(pXfer->pDone)
+      pXfer->pDone(pXfer);
+}
+
+//---------------------------------------------------------------
+//Abort the head transaction with an error and release the bus
+//---------------------------------------------------------------
+static void lc01b_Abort(ee_Errors_t errCode){
+
+   lc01b_pHead->errCode = errCode;
+   I2C1CONbits.PEN = 1;                                                         //Stop enable
+   lc01b_State = ST_STOP_DONE;
+}
+
+//---------------------------------------------------------------
+//Fail the head transaction after the bus itself went wrong. The
+//bus is recovered from the main line before the next transaction
+//starts; the recovery's delays have no place in the ISR
+//---------------------------------------------------------------
+static void lc01b_Fail(ee_Errors_t errCode){
+
+   lc01b_pHead->errCode = errCode;
+   lc01b_pHead->pDev->writeCycle = 1;                                           //A write may have been cut short; poll first
+   lc01b_RecoverPending = 1;
+   lc01b_Finish();
+}
+
+//---------------------------------------------------------------
+//Run a recovery lc01b_Fail flagged and restart the queue. Called
+//from the main line with the MI2C1 interrupt held off
+//---------------------------------------------------------------
+static void lc01b_Restart(void){
+
+   lc01b_RecoverPending = 0;
+   lc01b_Recover();
+   if(lc01b_pHead)
+      lc01b_Begin();
+}
+
+//---------------------------------------------------------------
+//Advance the transaction engine by one bus event
+//---------------------------------------------------------------
+void lc01b_Service(void){
+
+   lc01b_Xfer_t *pXfer = lc01b_pHead;
+   lc01b_Dev_t *pDev;
+
+   if(pXfer == 0 || lc01b_RecoverPending)
+      return;
+   pDev = pXfer->pDev;
+   lc01b_Events++;
+
+   if(I2C1STATbits.BCL || I2C1STATbits.IWCOL){                                 //Lost arbitration or wrote at the wrong time
+      I2C1STATbits.BCL = 0;
+      I2C1STATbits.IWCOL = 0;
+      lc01b_Fail(ERR_BUS_COLLISION);
+      return;
+   }
+
+   switch(lc01b_State){
+      case ST_START:
+         if(pXfer->type == LC01B_XFER_READCUR){
+            I2C1TRN = lc01b_Ctrl(pDev,pDev->addrPtr) | 1;                       //Control byte; Read mode
+            lc01b_State = ST_CTRL_R;
+         }
+         else{
+            I2C1TRN = lc01b_Ctrl(pDev,pXfer->ee_addr);                          //Control byte; Write mode
+            lc01b_State = ST_CTRL_W;
+         }
+         break;
+
+      case ST_CTRL_W:
+         if(I2C1STATbits.ACKSTAT)
+            lc01b_Abort(ERR_CNTL_NACK);
+         else
+            lc01b_SendAddr(pXfer);                                              //Memory address byte(s)
+         break;
+
+      case ST_ADDR_HI:
+         if(I2C1STATbits.ACKSTAT)
+            lc01b_Abort(ERR_MEM_NACK);
+         else{
+            I2C1TRN = (pXfer->ee_addr + lc01b_Pos) & 0xFF;                      //Low memory address byte
+            lc01b_State = ST_ADDR;
+         }
+         break;
+
+      case ST_ADDR:
+         if(I2C1STATbits.ACKSTAT)
+            lc01b_Abort(ERR_MEM_NACK);
+         else if(pXfer->type == LC01B_XFER_READ){
+            I2C1CONbits.RSEN = 1;                                               //Repeated start
+            lc01b_State = ST_RSTART;
+         }
+         else{
+            I2C1TRN = lc01b_TxNext(pXfer);                                      //First byte of the burst
+            lc01b_State = ST_TX_DATA;
+         }
+         break;
+
+      case ST_TX_DATA:
+         if(I2C1STATbits.ACKSTAT)
+            lc01b_Abort(ERR_PAGE_NACK);
+         else if(lc01b_Pos < lc01b_BurstEnd)
+            I2C1TRN = lc01b_TxNext(pXfer);                                      //Next data byte
+         else{
+            I2C1CONbits.PEN = 1;                                                //Stop bit starts the write cycle
+            lc01b_State = ST_STOP_W;
+         }
+         break;
+
+      case ST_STOP_W:
+         pDev->writeCycle = 1;                                                  //Write cycle has begun
+         STATS_WC_BEGIN(pDev->ctrl);
+         STATS_PAGE((pXfer->ee_addr + lc01b_Pos - 1) / pDev->pageSize);
+         if(pXfer->lazy && lc01b_Pos == pXfer->len){
+            lc01b_Finish();                                                     //Leave the poll to the next access
+            break;
+         }
+         lc01b_Polls = 0;
+         I2C1CONbits.SEN = 1;                                                   //Start of the first ack poll
+         lc01b_State = ST_POLL_START;
+         break;
+
+      case ST_POLL_STOP:
+         if(pXfer->type == LC01B_XFER_PROBE){
+            lc01b_Finish();                                                     //Single probe; still busy
+            break;
+         }
+         I2C1CONbits.SEN = 1;                                                   //Start of the next ack poll
+         lc01b_State = ST_POLL_START;
+         break;
+
+      case ST_POLL_START:
+         I2C1TRN = lc01b_Ctrl(pDev,pXfer->ee_addr + lc01b_Pos);                 //Control byte; Write mode
+         lc01b_State = ST_POLL_CTRL;
+         break;
+
+      case ST_POLL_CTRL:
+         if(I2C1STATbits.ACKSTAT){                                              //Still in its write cycle
+            STATS_POLL();
+            if(++lc01b_Polls >= lc01b_PollLimit && pXfer->type != LC01B_XFER_PROBE){
+               lc01b_Abort(ERR_CNTL_NACK);                                      //Missing device or stuck write cycle
+               break;
+            }
+            I2C1CONbits.PEN = 1;
+            lc01b_State = ST_POLL_STOP;
+         }
+         else{
+            pDev->writeCycle = 0;                                               //Write cycle complete
+            STATS_WC_END(pDev->ctrl);
+            if(pXfer->type == LC01B_XFER_POLL || pXfer->type == LC01B_XFER_PROBE
+               || (pXfer->type == LC01B_XFER_WRITE && lc01b_Pos == pXfer->len)){
+               I2C1CONbits.PEN = 1;
+               lc01b_State = ST_STOP_DONE;
+            }
+            else if(pXfer->type == LC01B_XFER_READCUR){
+               I2C1CONbits.RSEN = 1;                                            //Turn the bus around for the read
+               lc01b_State = ST_RSTART;
+            }
+            else{
+               //Device is ready and already addressed; go straight to the memory address
+               if(pXfer->type == LC01B_XFER_WRITE)
+                  lc01b_NextBurst(pXfer);
+               lc01b_SendAddr(pXfer);
+            }
+         }
+         break;
+
+      case ST_RSTART:
+         if(pXfer->type == LC01B_XFER_READCUR)
+            I2C1TRN = lc01b_Ctrl(pDev,pDev->addrPtr) | 1;                       //Control byte; Read mode
+         else
+            I2C1TRN = lc01b_Ctrl(pDev,pXfer->ee_addr) | 1;
+         lc01b_State = ST_CTRL_R;
+         break;
+
+      case ST_CTRL_R:
+         if(I2C1STATbits.ACKSTAT)
+            lc01b_Abort(ERR_CNTL_NACK);
+         else{
+            I2C1CONbits.RCEN = 1;                                               //Receive enable
+            lc01b_State = ST_RECV;
+         }
+         break;
+
+      case ST_RECV:
+         lc01b_RxNext(pXfer,I2C1RCV);                                           //Copy from the receive buffer
+         if(lc01b_Pos < pXfer->len){
+            I2C1CONbits.ACKDT = 0;                                              //ACK to get the next byte
+            lc01b_State = ST_ACK;
+         }
+         else{
+            I2C1CONbits.ACKDT = 1;                                              //NACK the last byte
+            lc01b_State = ST_NACK;
+         }
+         I2C1CONbits.ACKEN = 1;                                                 //Acknowledge enable
+         break;
+
+      case ST_ACK:
+         I2C1CONbits.RCEN = 1;
+         lc01b_State = ST_RECV;
+         break;
+
+      case ST_NACK:
+         I2C1CONbits.PEN = 1;                                                   //Stop enable
+         lc01b_State = ST_STOP_DONE;
+         break;
+
+      case ST_STOP_DONE:
+         if(pXfer->crcLen && pXfer->type == LC01B_XFER_READ && pXfer->errCode == ERR_NONE && pXfer->crc)
+            pXfer->errCode = ERR_CRC;                                           //Residue must be zero
+         if(pXfer->patLen && pXfer->type == LC01B_XFER_READ && pXfer->errCode == ERR_NONE && pXfer->mismatch != LC01B_NO_MISMATCH)
+            pXfer->errCode = ERR_VERIFY;
+         lc01b_Finish();
+         break;
+
+      default:
+         break;
+   }
+}
+
+//---------------------------------------------------------------
+//Fill in a transaction handle: plain transfer, no CRC or pattern,
+//polling as set by lc01b_LazyPoll
+//---------------------------------------------------------------
+static void lc01b_Prep(lc01b_Xfer_t *pXfer,lc01b_Dev_t *pDev,uint8_t type,uint16_t ee_addr,uint16_t len,uint8_t *pData,lc01b_Done_t pDone){
+
+   pXfer->lazy = lc01b_Lazy;
+   pXfer->crcLen = 0;
+   pXfer->crc = 0;
+   pXfer->patLen = 0;
+   pXfer->mismatch = LC01B_NO_MISMATCH;
+   pXfer->pDev = pDev;
+   pXfer->type = type;
+   pXfer->ee_addr = ee_addr;
+   pXfer->len = len;
+   pXfer->pData = pData;
+   pXfer->pDone = pDone;
+   pXfer->errCode = ERR_NONE;
+   pXfer->pNext = 0;
+#ifdef EE_STATS
+   pXfer->t0 = STATS_NOW();
+#endif
+}
+
+//---------------------------------------------------------------
+//Queue a prepared transaction. Starts the bus if the engine is
+//idle
+//---------------------------------------------------------------
+static ee_Errors_t lc01b_Queue(lc01b_Xfer_t *pXfer){
+
+   uint8_t intEnable;
+
+   //Nothing to move; complete on the spot
+   if(pXfer->len == 0 && pXfer->type != LC01B_XFER_POLL && pXfer->type != LC01B_XFER_PROBE){
+      pXfer->busy = 0;
+      if(pXfer->pDone)
+         pXfer->pDone(pXfer);
+      return ERR_NONE;
+   }
+   pXfer->busy = 1;
+
+   //Hold off the ISR while the queue is linked
+   intEnable = IEC1bits.MI2C1IE;
+   IEC1bits.MI2C1IE = 0;
+   if(lc01b_RecoverPending)
+      lc01b_Restart();
+   if(lc01b_pHead == 0){
+      lc01b_pHead = lc01b_pTail = pXfer;
+      lc01b_Begin();
+   }
+   else{
+      lc01b_pTail->pNext = pXfer;
+      lc01b_pTail = pXfer;
+   }
+   IEC1bits.MI2C1IE = intEnable;
+   return ERR_NONE;
+}
+
+//---------------------------------------------------------------
+//Queue a transaction. With crcLen set, len includes the CRC bytes
+//after the client data. With lazy set a write completes at its
+//final stop bit
+//---------------------------------------------------------------
+static ee_Errors_t lc01b_SubmitCrc(lc01b_Xfer_t *pXfer,lc01b_Dev_t *pDev,uint8_t type,uint16_t ee_addr,uint16_t len,uint8_t *pData,lc01b_Done_t pDone,uint8_t crcLen,uint8_t lazy){
+
+   lc01b_Prep(pXfer,pDev,type,ee_addr,len,pData,pDone);
+   pXfer->lazy = lazy;
+   pXfer->crcLen = crcLen;
+   pXfer->crc = LC01B_CRC_INIT(crcLen);
+   return lc01b_Queue(pXfer);
+}
+
+//---------------------------------------------------------------
+//Queue a plain transaction
+//---------------------------------------------------------------
+static ee_Errors_t lc01b_Submit(lc01b_Xfer_t *pXfer,lc01b_Dev_t *pDev,uint8_t type,uint16_t ee_addr,uint16_t len,uint8_t *pData,lc01b_Done_t pDone){
+
+   return lc01b_SubmitCrc(pXfer,pDev,type,ee_addr,len,pData,pDone,0,lc01b_Lazy);
+}
+
+//---------------------------------------------------------------
+//Queue a write of any length. Split into page bursts by the engine
+//---------------------------------------------------------------
+ee_Errors_t lc01b_WriteAsync(lc01b_Xfer_t *pXfer,uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf,lc01b_Done_t pDone){
+
+   if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
+       return ERR_MEM_BOUNDS;
+   return lc01b_Submit(pXfer,lc01b_pDev,LC01B_XFER_WRITE,ee_addr,dataLen,pDataBuf,pDone);
+}
+
+//---------------------------------------------------------------
+//Queue a sequential read
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadAsync(lc01b_Xfer_t *pXfer,uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf,lc01b_Done_t pDone){
+
+   if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,readLen))
+       return ERR_MEM_BOUNDS;
+   return lc01b_Submit(pXfer,lc01b_pDev,LC01B_XFER_READ,ee_addr,readLen,pDataBuf,pDone);
+}
+
+//---------------------------------------------------------------
+//Queue a write to a given device. It completes at its final stop
+//bit; the device's next transaction polls for the write cycle
+//---------------------------------------------------------------
+ee_Errors_t lc01b_WriteDevAsync(lc01b_Xfer_t *pXfer,lc01b_Dev_t *pDev,uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf,lc01b_Done_t pDone){
+
+   if(lc01b_OutOfBounds(pDev,ee_addr,dataLen))
+       return ERR_MEM_BOUNDS;
+   return lc01b_SubmitCrc(pXfer,pDev,LC01B_XFER_WRITE,ee_addr,dataLen,pDataBuf,pDone,0,1);
+}
+
+//---------------------------------------------------------------
+//Queue a sequential read from a given device
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadDevAsync(lc01b_Xfer_t *pXfer,lc01b_Dev_t *pDev,uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf,lc01b_Done_t pDone){
+
+   if(lc01b_OutOfBounds(pDev,ee_addr,readLen))
+       return ERR_MEM_BOUNDS;
+   return lc01b_Submit(pXfer,pDev,LC01B_XFER_READ,ee_addr,readLen,pDataBuf,pDone);
+}
+
+//---------------------------------------------------------------
+//Queue a current address read
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadCurAsync(lc01b_Xfer_t *pXfer,uint16_t readLen,uint8_t *pDataBuf,lc01b_Done_t pDone){
+
+   if(lc01b_PtrKnown(lc01b_pDev) && lc01b_OutOfBounds(lc01b_pDev,lc01b_pDev->addrPtr,readLen))
+       return ERR_MEM_BOUNDS;
+   return lc01b_Submit(pXfer,lc01b_pDev,LC01B_XFER_READCUR,0,readLen,pDataBuf,pDone);
+}
+
+//---------------------------------------------------------------
+//Run a flagged bus recovery with the MI2C1 interrupt held off
+//---------------------------------------------------------------
+static void lc01b_Resume(void){
+
+   uint8_t intEnable = IEC1bits.MI2C1IE;
+
+   IEC1bits.MI2C1IE = 0;
+   if(lc01b_RecoverPending)
+      lc01b_Restart();
+   IEC1bits.MI2C1IE = intEnable;
+}
+
+//---------------------------------------------------------------
+//Block until a queued transaction completes
+//---------------------------------------------------------------
+ee_Errors_t lc01b_Wait(lc01b_Xfer_t *pXfer){
+
+   uint8_t events = lc01b_Events, intEnable;
+   uint16_t spins = 0;
+
+   while(pXfer->busy){
+      if(!IEC1bits.MI2C1IE && IFS1bits.MI2C1IF){                                //No ISR; run the engine here
+         IFS1bits.MI2C1IF = 0;
+         lc01b_Service();
+      }
+
+      //Each bus event has to arrive within its budget
+      if(events != lc01b_Events){
+         events = lc01b_Events;
+         spins = 0;
+      }
+      else if(++spins > lc01b_EventBudget){
+         intEnable = IEC1bits.MI2C1IE;
+         IEC1bits.MI2C1IE = 0;
+         if(lc01b_pHead && events == lc01b_Events)
+            lc01b_Fail(ERR_BUS_TIMEOUT);
+         IEC1bits.MI2C1IE = intEnable;
+         spins = 0;
+      }
+
+      //A transaction ahead of this one failed the bus
+      if(lc01b_RecoverPending){
+         lc01b_Resume();
+         spins = 0;
+      }
+   }
+   if(lc01b_RecoverPending)
+      lc01b_Resume();                                                           //This one did; leave the bus usable
+   return pXfer->errCode;
+}
+
+//---------------------------------------------------------------
+//Non-zero while any transaction is queued or on the bus
+//---------------------------------------------------------------
+uint8_t lc01b_Busy(void){
+
+   return lc01b_pHead != 0;
+}
+
+//---------------------------------------------------------------
+//Select the device used by the lc01b_xxx calls
+//---------------------------------------------------------------
+void lc01b_SetDevice(lc01b_Dev_t *pDev){
+
+   lc01b_pDev = pDev ? pDev : &lc01b_Default;
+}
+
+//---------------------------------------------------------------
+//Device currently in use
+//---------------------------------------------------------------
+lc01b_Dev_t *lc01b_GetDevice(void){
+
+   return lc01b_pDev;
+}
+
+//---------------------------------------------------------------
+//Enable or disable deferred acknowledge polling
+//---------------------------------------------------------------
+void lc01b_LazyPoll(uint8_t enable){
+
+   lc01b_Lazy = enable;
+}
+
+//---------------------------------------------------------------
+//Report whether the LC01B is idle. If a deferred write cycle may
+//still be running, one control byte is sent to find out
+//---------------------------------------------------------------
+uint8_t lc01b_Idle(void){
+
+   lc01b_Xfer_t xfer;
+
+   if(lc01b_Busy())
+      return 0;
+   if(lc01b_pDev->writeCycle){
+      lc01b_Submit(&xfer,lc01b_pDev,LC01B_XFER_PROBE,0,0,0,0);
+      lc01b_Wait(&xfer);
+   }
+   return !lc01b_pDev->writeCycle;
 }
 
 //---------------------------------------------------------------
 //Write a byte to the LC01B at the desired address
 //---------------------------------------------------------------
-ee_Errors_t lc01b_WriteByte(uint8_t ee_addr,uint8_t dataByte){
-   
-    //Do a bounds check
-    if(ee_addr > LC01B_MAX_ADR)
-        return ERR_MEM_BOUNDS;
-    else{
-      //Address the EEPROM
-      lc01b_SCM(ee_addr);
-                                                                         
-      //Send the data byte
-      I2C1TRN = dataByte;                                                          
-      while(I2C1STATbits.TRSTAT);                                               //Wait for transmission to complete 
-      while(I2C1STATbits.ACKSTAT);
+ee_Errors_t lc01b_WriteByte(uint16_t ee_addr,uint8_t dataByte){
    
-      //Send the stop bit
-      I2C1CONbits.PEN = 1;                                                      //Stop bit
-      while(I2C1CONbits.PEN);                                                   //Wait for stop to complete
-      ack_Poll();
-    }
-    return ERR_NONE;
+   return lc01b_WritePage(ee_addr,1,&dataByte);
 }
 
 //---------------------------------------------------------------
-// Page writes - Up to 8 bytes in length
+// Page writes - Up to one page (8 bytes on the LC01B) in length
 //---------------------------------------------------------------
-ee_Errors_t lc01b_WritePage(uint8_t ee_addr,uint8_t dataLen,uint8_t *pDataBuf){
+ee_Errors_t lc01b_WritePage(uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf){
    
-  if((ee_addr + dataLen -1) > LC01B_MAX_ADR)
+  lc01b_Xfer_t xfer;
+
+  if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
       return ERR_MEM_BOUNDS;
-  else{
-      //Address the EEPROM
-      lc01b_SCM(ee_addr);                                                       //Send START, Control byte and memory address
+  else if((ee_addr % lc01b_pDev->pageSize) + dataLen > lc01b_pDev->pageSize)    //Would wrap within the page latch
+      return ERR_PAGE_BOUNDS;
    
-      //Write page array to the EEPROM
-      for(uint8_t ctr=0;ctr<dataLen;ctr++){
-         I2C1TRN = *pDataBuf++;                                                 //Next data byte
-         while(I2C1STATbits.TRSTAT);
-         while(I2C1STATbits.ACKSTAT);                                           //Wait for the ACK
-      }   
-      //Send the stop bit
-      I2C1CONbits.PEN = 1;                                                      //Stop bit
-      while(I2C1CONbits.PEN);                                                   //Wait for stop to complete
-      //Acknowledge poll
-      ack_Poll();
-   }
-  return ERR_NONE;
+  lc01b_Submit(&xfer,lc01b_pDev,LC01B_XFER_WRITE,ee_addr,dataLen,pDataBuf,0);
+  return lc01b_Wait(&xfer);
 }
 
 //---------------------------------------------------------------
-//Write multi-byte length variables to the EEPROM
+//Write any length of data, split into page aligned bursts
 //---------------------------------------------------------------
-ee_Errors_t lc01b_WriteObject(uint8_t ee_addr,uint8_t objLen,void *pObj){
+ee_Errors_t lc01b_Write(uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf){
    
-   uint8_t *pByte = pObj;
+   lc01b_Xfer_t xfer;
+   ee_Errors_t errCode;
    
-   if((ee_addr + objLen - 1) > LC01B_MAX_ADR)
-       return ERR_MEM_BOUNDS;
-   else{
-      while(objLen--){
-         lc01b_WriteByte(ee_addr++,*pByte++);
+   errCode = lc01b_WriteAsync(&xfer,ee_addr,dataLen,pDataBuf,0);
+   if(errCode)
+      return errCode;
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Differential write. Reads each page back LC01B_DIFF_BUF bytes at
+//a time and only rewrites the pages whose contents changed
+//---------------------------------------------------------------
+ee_Errors_t lc01b_WriteDiff(uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf,uint16_t *pSkipped){
+
+   uint8_t current[LC01B_DIFF_BUF];
+   uint16_t pos, burst, idx, piece, ctr, skipped = 0;
+   uint16_t pageSize = lc01b_pDev->pageSize;
+   uint8_t same;
+   ee_Errors_t errCode = ERR_NONE;
+
+   if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
+      return ERR_MEM_BOUNDS;
+
+   for(pos=0; pos<dataLen && errCode == ERR_NONE; pos+=burst){
+      burst = pageSize - ((ee_addr + pos) % pageSize);                          //Rest of this page
+      if(burst > dataLen - pos)
+         burst = dataLen - pos;
+
+      //Compare a piece at a time; the first difference ends the read
+      same = 1;
+      for(idx=0; idx<burst && same && errCode == ERR_NONE; idx+=piece){
+         piece = (burst - idx < LC01B_DIFF_BUF) ? burst - idx : LC01B_DIFF_BUF;
+         errCode = lc01b_ReadStream(ee_addr + pos + idx,piece,current);         //Current address reads follow on
+         for(ctr=0; ctr<piece && current[ctr] == pDataBuf[pos+idx+ctr]; ctr++);
+         same = (ctr == piece);
       }
+      if(errCode)
+         break;
+      else if(same)
+         skipped++;                                                             //Page already holds the data
+      else
+         errCode = lc01b_WritePage(ee_addr + pos,burst,&pDataBuf[pos]);
    }
-   return ERR_NONE;
+   if(pSkipped)
+      *pSkipped = skipped;
+   return errCode;
 }
 
 //---------------------------------------------------------------
-//Read a single byte from the EEPROM
+//Write multi-byte length variables to the EEPROM
 //---------------------------------------------------------------
-ee_Errors_t lc01b_ReadByte(uint8_t ee_addr, uint8_t *pData){
+ee_Errors_t lc01b_WriteObject(uint16_t ee_addr,uint16_t objLen,void *pObj){
    
-  if(ee_addr > LC01B_MAX_ADR)
+   return lc01b_Write(ee_addr,objLen,pObj);
+}
+
+//---------------------------------------------------------------
+//Write an object followed by its CRC in the same page writes
+//---------------------------------------------------------------
+ee_Errors_t lc01b_WriteObjectCrc(uint16_t ee_addr,uint16_t objLen,void *pObj,uint8_t crcType){
+
+   lc01b_Xfer_t xfer;
+
+   if(!LC01B_CRC_VALID(crcType))
+      return ERR_ARG;
+   else if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,objLen + crcType))
       return ERR_MEM_BOUNDS;
-  else{
-      //Address the EEPROM
-      lc01b_SCM(ee_addr);
-   
-      //Repeated start
-      I2C1CONbits.RSEN = 1;
-      while(I2C1CONbits.RSEN);
-      I2C1TRN = LC01B_READ;                                                     //Control byte; Read mode
-      while(I2C1STATbits.TRSTAT);                                               //Wait for transmit to complete
-      while(I2C1STATbits.ACKSTAT);
+   lc01b_SubmitCrc(&xfer,lc01b_pDev,LC01B_XFER_WRITE,ee_addr,objLen + crcType,pObj,0,crcType,lc01b_Lazy);
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Fill a range with a repeating pattern, straight from the pattern
+//---------------------------------------------------------------
+ee_Errors_t lc01b_Fill(uint16_t ee_addr,uint16_t dataLen,uint8_t *pPattern,uint8_t patLen){
+
+   lc01b_Xfer_t xfer;
+
+   if(patLen == 0)
+      return ERR_ARG;
+   else if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
+      return ERR_MEM_BOUNDS;
+   lc01b_Prep(&xfer,lc01b_pDev,LC01B_XFER_WRITE,ee_addr,dataLen,pPattern,0);
+   xfer.patLen = patLen;
+   lc01b_Queue(&xfer);
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Compare a range against a repeating pattern in one sequential read
+//---------------------------------------------------------------
+ee_Errors_t lc01b_Verify(uint16_t ee_addr,uint16_t dataLen,uint8_t *pPattern,uint8_t patLen,uint16_t *pMismatch){
+
+   lc01b_Xfer_t xfer;
+   ee_Errors_t errCode;
+
+   if(patLen == 0)
+      return ERR_ARG;
+   else if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
+      return ERR_MEM_BOUNDS;
+   lc01b_Prep(&xfer,lc01b_pDev,LC01B_XFER_READ,ee_addr,dataLen,pPattern,0);
+   xfer.patLen = patLen;
+   lc01b_Queue(&xfer);
+   errCode = lc01b_Wait(&xfer);
+   if(pMismatch)
+      *pMismatch = (errCode == ERR_VERIFY) ? ee_addr + xfer.mismatch : LC01B_NO_MISMATCH;
+   return errCode;
+}
+
+//---------------------------------------------------------------
+//Read a single byte from the EEPROM
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadByte(uint16_t ee_addr, uint8_t *pData){
    
-      //Read the EEPOM byte
-      I2C1CONbits.RCEN = 1;                                                     //Receive enable 
-      while(I2C1CONbits.RCEN);                                                  //Wait for the byte to shift in
-      while(!I2C1STATbits.RBF);                                                 //Wait for the receive buffer flag
-      *pData = I2C1RCV;                                                         //Copy from the receive buffer
-      
-      //Terminate the read operation
-      I2C1CONbits.ACKDT = 1;                                                    //Send a NACK during acknowledge
-      I2C1CONbits.ACKEN = 1;                                                    //Acknowledge enable
-      while(I2C1CONbits.ACKEN);                                                 //Wait for NACK to complete
-      I2C1CONbits.PEN = 1;                                                      //Stop enable
-      while(I2C1CONbits.PEN);                                                   //Wait for stop to complete
-   }
-   return ERR_NONE;
+   return lc01b_ReadSeq(ee_addr,1,pData);
 }
 
 //---------------------------------------------------------------
 //Read a specified number of sequential bytes beginning from
 //the supplied address
 //---------------------------------------------------------------
-ee_Errors_t lc01b_ReadSeq(uint8_t ee_addr,uint8_t readLen,uint8_t *pDataBuf){
+ee_Errors_t lc01b_ReadSeq(uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf){
    
-   if((ee_addr + readLen - 1) > LC01B_MAX_ADR)
-       return ERR_MEM_BOUNDS;
-   else{
-      //Address the EEPROM
-      lc01b_SCM(ee_addr);
+   lc01b_Xfer_t xfer;
+   ee_Errors_t errCode;
       
-      //Repeated start
-      I2C1CONbits.RSEN = 1;
-      while(I2C1CONbits.RSEN);
-      I2C1TRN = LC01B_READ;                                                     //Control byte; Read mode
-      while(I2C1STATbits.TRSTAT);                                               //Wait for transmit to complete
-      while(I2C1STATbits.ACKSTAT);
+   errCode = lc01b_ReadAsync(&xfer,ee_addr,readLen,pDataBuf,0);
+   if(errCode)
+      return errCode;
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Current address read. Continues from the LC01B's internal 
+//address pointer without re-sending the memory address
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadCur(uint16_t readLen,uint8_t *pDataBuf){
    
-      //Read the EEPOM for the desired length
-      for (uint8_t ctr=0;ctr<readLen;ctr++){
-         I2C1CONbits.RCEN = 1;                                                        //Receive enable 
-         while(I2C1CONbits.RCEN);                                                     //Wait for the byte to shift in
-         while(!I2C1STATbits.RBF);                                                    //Wait for the receive buffer flag
-         *pDataBuf++ = I2C1RCV;                                                          //Copy from the receive buffer
-         if (ctr < readLen-1){                                                     //Don't ACK the last read
-            I2C1CONbits.ACKDT = 0;                                                    //Send an ACK to get next byte
-            I2C1CONbits.ACKEN = 1;                                                    //Acknowledge enable
-            while(I2C1CONbits.ACKEN);                                                 //Wait for ACK to complete
-         }
-      }
-      //Terminate read operation
-      I2C1CONbits.ACKDT = 1;                                                       //Send a NACK during acknowledge
-      I2C1CONbits.ACKEN = 1;                                                       //Acknowledge enable
-      while(I2C1CONbits.ACKEN);                                                    //Wait for NACK to complete
-      I2C1CONbits.PEN = 1;                                                         //Stop enable
-      while(I2C1CONbits.PEN);                                                      //Wait for stop to complete  
-   }
-   return ERR_NONE;
+   lc01b_Xfer_t xfer;
+   ee_Errors_t errCode;
+      
+   errCode = lc01b_ReadCurAsync(&xfer,readLen,pDataBuf,0);
+   if(errCode)
+      return errCode;
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Streaming read. Skips the address phase whenever the request
+//picks up where the previous read left off
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadStream(uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf){
+   
+   if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,readLen))
+       return ERR_MEM_BOUNDS;
+   else if(!lc01b_Busy() && lc01b_PtrKnown(lc01b_pDev) && lc01b_pDev->addrPtr == ee_addr) //Device is already there
+       return lc01b_ReadCur(readLen,pDataBuf);
+   else
+       return lc01b_ReadSeq(ee_addr,readLen,pDataBuf);
 }
 
 //---------------------------------------------------------
 //Read multi-byte length variables from the EEPROM
 //---------------------------------------------------------
-ee_Errors_t lc01b_ReadObject(uint8_t ee_addr,uint8_t objLen, void *pObj){
-   
-   uint8_t *pByte = pObj;
+ee_Errors_t lc01b_ReadObject(uint16_t ee_addr,uint16_t objLen, void *pObj){
    
-   if((ee_addr + objLen - 1) > LC01B_MAX_ADR)
-       return ERR_MEM_BOUNDS;
-   else{
-      while(objLen--){
-         lc01b_ReadByte(ee_addr++,pByte++);
+   return lc01b_ReadSeq(ee_addr,objLen,pObj);                                   //One sequential transaction
+}
+
+//---------------------------------------------------------------
+//Read an object and check its CRC in one sequential transaction
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadObjectCrc(uint16_t ee_addr,uint16_t objLen,void *pObj,uint8_t crcType){
+
+   lc01b_Xfer_t xfer;
+
+   if(!LC01B_CRC_VALID(crcType))
+      return ERR_ARG;
+   else if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,objLen + crcType))
+      return ERR_MEM_BOUNDS;
+   lc01b_SubmitCrc(&xfer,lc01b_pDev,LC01B_XFER_READ,ee_addr,objLen + crcType,pObj,0,crcType,lc01b_Lazy);
+   return lc01b_Wait(&xfer);
+}
+
+//---------------------------------------------------------------
+//Copy the part of a read chunk that falls in each segment of a run
+//---------------------------------------------------------------
+static void lc01b_Scatter(lc01b_Seg_t *pSegs,uint8_t *pOrder,uint8_t count,uint16_t chunkAddr,uint16_t chunkLen,uint8_t *pChunk){
+
+   uint8_t idx;
+   uint32_t first, last;                                                        //Ends may reach 0x10000 on a 24LC512
+   lc01b_Seg_t *pSeg;
+
+   for(idx=0; idx<count; idx++){
+      pSeg = &pSegs[pOrder[idx]];
+      first = (pSeg->ee_addr > chunkAddr) ? pSeg->ee_addr : chunkAddr;
+      last = ((uint32_t)pSeg->ee_addr + pSeg->len < (uint32_t)chunkAddr + chunkLen) ? (uint32_t)pSeg->ee_addr + pSeg->len : (uint32_t)chunkAddr + chunkLen;
+      if(first < last)
+         memcpy((uint8_t *)pSeg->pDst + (first - pSeg->ee_addr),pChunk + (first - chunkAddr),last - first);
+   }
+}
+
+//---------------------------------------------------------------
+//Scatter-gather read with nearby ranges merged into one read
+//---------------------------------------------------------------
+ee_Errors_t lc01b_ReadBatch(lc01b_Seg_t *pSegs,uint8_t count){
+
+   uint8_t order[LC01B_SEG_MAX];
+   uint8_t bounce[LC01B_BATCH_BUF];
+   uint8_t idx, pos, runFirst, key;
+   uint16_t gapMax = LC01B_READ_OVERHEAD + lc01b_pDev->addrBytes;
+   uint16_t chunk;
+   uint32_t runAddr, runEnd, addr;                                              //Run ends may reach 0x10000
+   ee_Errors_t errCode = ERR_NONE;
+
+   if(count > LC01B_SEG_MAX)
+      return ERR_MEM_BOUNDS;
+
+   //Insertion sort of segment indexes by address
+   for(idx=0; idx<count; idx++){
+      if(lc01b_OutOfBounds(lc01b_pDev,pSegs[idx].ee_addr,pSegs[idx].len))
+         return ERR_MEM_BOUNDS;
+      key = idx;
+      for(pos=idx; pos>0 && pSegs[order[pos-1]].ee_addr > pSegs[key].ee_addr; pos--)
+         order[pos] = order[pos-1];
+      order[pos] = key;
+   }
+
+   for(idx=0; idx<count && errCode == ERR_NONE; ){
+      if(pSegs[order[idx]].len == 0){
+         idx++;
+         continue;
+      }
+
+      //Grow the run while the next segment is cheaper to read through to
+      runFirst = idx;
+      runAddr = pSegs[order[idx]].ee_addr;
+      runEnd = runAddr + pSegs[order[idx]].len;
+      for(idx++; idx<count && pSegs[order[idx]].ee_addr <= runEnd + gapMax; idx++){
+         if((uint32_t)pSegs[order[idx]].ee_addr + pSegs[order[idx]].len > runEnd)
+            runEnd = (uint32_t)pSegs[order[idx]].ee_addr + pSegs[order[idx]].len;
+      }
+
+      //One addressed read; later chunks continue from the device pointer
+      for(addr=runAddr; addr<runEnd && errCode == ERR_NONE; addr+=chunk){
+         chunk = (runEnd - addr > LC01B_BATCH_BUF) ? LC01B_BATCH_BUF : runEnd - addr;
+         errCode = lc01b_ReadStream(addr,chunk,bounce);
+         if(errCode == ERR_NONE)
+            lc01b_Scatter(pSegs,&order[runFirst],idx - runFirst,addr,chunk,bounce);
       }
    }
+   return errCode;
+}
+
+//---------------------------------------------------------------
+//Start an empty write batch
+//---------------------------------------------------------------
+void lc01b_BatchInit(lc01b_Batch_t *pBatch,lc01b_Seg_t *pSegs,uint8_t max){
+
+   pBatch->pSegs = pSegs;
+   pBatch->count = 0;
+   pBatch->max = max;
+}
+
+//---------------------------------------------------------------
+//Collect an update for the next commit
+//---------------------------------------------------------------
+ee_Errors_t lc01b_BatchAdd(lc01b_Batch_t *pBatch,uint16_t ee_addr,uint16_t dataLen,void *pSrc){
+
+   lc01b_Seg_t *pSeg;
+
+   if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,dataLen))
+      return ERR_MEM_BOUNDS;
+   else if(pBatch->count >= pBatch->max)
+      return ERR_BATCH_FULL;
+   pSeg = &pBatch->pSegs[pBatch->count++];
+   pSeg->ee_addr = ee_addr;
+   pSeg->len = dataLen;
+   pSeg->pDst = pSrc;
    return ERR_NONE;
 }
 
+//---------------------------------------------------------------
+//One page write per touched page
+//---------------------------------------------------------------
+ee_Errors_t lc01b_BatchCommit(lc01b_Batch_t *pBatch){
+
+   uint8_t page[LC01B_MAX_PAGE];
+   uint8_t covered[LC01B_MAX_PAGE/8];                                           //One bit per page byte
+   uint8_t idx, holes;
+   uint16_t pageSize = lc01b_pDev->pageSize;
+   uint16_t off, first, last;
+   uint32_t cursor = 0, next, pageAddr, segEnd, lo, hi;
+   lc01b_Seg_t *pSeg;
+   ee_Errors_t errCode = ERR_NONE;
+
+   if(pageSize > LC01B_MAX_PAGE)
+      return ERR_PAGE_BOUNDS;
+
+   while(errCode == ERR_NONE){
+      //Lowest address still to be written
+      next = 0x10000UL;
+      for(idx=0; idx<pBatch->count; idx++){
+         pSeg = &pBatch->pSegs[idx];
+         segEnd = (uint32_t)pSeg->ee_addr + pSeg->len;
+         if(segEnd > cursor && pSeg->len){
+            lo = (pSeg->ee_addr > cursor) ? pSeg->ee_addr : cursor;
+            if(lo < next)
+               next = lo;
+         }
+      }
+      if(next == 0x10000UL)
+         break;
+      pageAddr = next - (next % pageSize);
+
+      //Which bytes of this page the batch covers
+      memset(covered,0,sizeof(covered));
+      first = pageSize;
+      last = 0;
+      for(idx=0; idx<pBatch->count; idx++){
+         pSeg = &pBatch->pSegs[idx];
+         lo = (pSeg->ee_addr > pageAddr) ? pSeg->ee_addr : pageAddr;
+         hi = (uint32_t)pSeg->ee_addr + pSeg->len;
+         if(hi > pageAddr + pageSize)
+            hi = pageAddr + pageSize;
+         for(; lo<hi; lo++){
+            off = lo - pageAddr;
+            covered[off >> 3] |= 1 << (off & 7);
+            if(off < first)
+               first = off;
+            if(off > last)
+               last = off;
+         }
+      }
+
+      //Read-fill only if the written span has holes in it
+      for(holes=0, off=first; off<=last && !holes; off++)
+         holes = !(covered[off >> 3] & (1 << (off & 7)));
+      if(holes)
+         errCode = lc01b_ReadSeq(pageAddr + first,last - first + 1,&page[first]);
+
+      //Overlay the updates in the order they were added
+      for(idx=0; idx<pBatch->count && errCode == ERR_NONE; idx++){
+         pSeg = &pBatch->pSegs[idx];
+         lo = (pSeg->ee_addr > pageAddr) ? pSeg->ee_addr : pageAddr;
+         hi = (uint32_t)pSeg->ee_addr + pSeg->len;
+         if(hi > pageAddr + pageSize)
+            hi = pageAddr + pageSize;
+         if(lo < hi)
+            memcpy(&page[lo - pageAddr],(uint8_t *)pSeg->pDst + (lo - pSeg->ee_addr),hi - lo);
+      }
+
+      if(errCode == ERR_NONE)
+         errCode = lc01b_WritePage(pageAddr + first,last - first + 1,&page[first]);
+      cursor = pageAddr + pageSize;
+   }
+
+   if(errCode == ERR_NONE)
+      pBatch->count = 0;
+   return errCode;
+}
+
 //-----------------------------------------------------------
 //Acknowledge poll the EEPROM until the write cycle completes
 //-----------------------------------------------------------
-void ack_Poll(){
-   do{
-      I2C1CONbits.SEN = 1;                                                      //Start enable
-      while(I2C1CONbits.SEN);                                                   //Wait for completion
-      I2C1TRN = LC01B_WRITE;                                                    //Control byte; Write mode
-      while(I2C1STATbits.TRSTAT);                                               //Wait for transmit to complete
-   }while(I2C1STATbits.ACKSTAT);                                                //Repeat until ACK'd
+ee_Errors_t ack_Poll(){
+
+   lc01b_Xfer_t xfer;
+
+   lc01b_Submit(&xfer,lc01b_pDev,LC01B_XFER_POLL,0,0,0,0);
+   return lc01b_Wait(&xfer);
 }  
 
 //------------------------------------------------------------
-//Set the baud rate and enable I2C1
+//Reset I2C1 and bring it up at lc01b_Brg with the MI2C1
+//interrupt flag clear. The enable is left to the caller
 //------------------------------------------------------------
-void init_I2C(uint8_t BRG){
+static void lc01b_Setup(void){
+
    I2C1CON = 0x0000;
-   I2C1BRG = BRG;
+   I2C1BRG = lc01b_Brg;
    I2C1CON = 0x8000;
-}
\ No newline at end of file
+   IFS1bits.MI2C1IF = 0;
+   IPC4bits.MI2C1IP = LC01B_INT_PRI;
+}
+
+//------------------------------------------------------------
+//Set the baud rate and enable I2C1
+//------------------------------------------------------------
+void init_I2C(uint16_t BRG){
+
+   lc01b_Xfer_t *pXfer, *pNext;
+
+   //One SCL period is about BRG + 2 instruction cycles
+   lc01b_EventBudget = LC01B_EVENT_BITS * (BRG + 2);
+   lc01b_PollLimit = LC01B_POLL_MARGIN * ((LC01B_TWC_US * (FCY / 1000000UL)) / (LC01B_POLL_BITS * (BRG + 2UL))) + 1;
+
+   //Detach whatever is still queued before the reset. A head cut off
+   //mid write may have started a write cycle on its device
+   IEC1bits.MI2C1IE = 0;
+   pXfer = lc01b_pHead;
+   lc01b_pDev->writeCycle = 0;
+   if(pXfer)
+      pXfer->pDev->writeCycle = 1;
+   if(++lc01b_Epoch == 0)
+      lc01b_Epoch = 1;
+   lc01b_pHead = lc01b_pTail = 0;
+   lc01b_State = ST_IDLE;
+   lc01b_RecoverPending = 0;
+   lc01b_Brg = BRG;
+   lc01b_Setup();
+
+   //Fail the dropped transactions so nobody waits on a busy flag
+   //that would never clear. Callbacks may queue new work
+   while(pXfer){
+      pNext = pXfer->pNext;
+      pXfer->errCode = ERR_ABORTED;
+      pXfer->busy = 0;
+      if(pXfer->pDone)
+         pXfer->pDone(pXfer);
+      pXfer = pNext;
+   }
+
+   //Master events drive the transaction engine
+   IEC1bits.MI2C1IE = 1;
+}
+
+//------------------------------------------------------------
+//Clock a stuck slave off the bus and send a stop
+//------------------------------------------------------------
+void lc01b_Recover(void){
+
+   uint8_t idx;
+
+   I2C1CONbits.I2CEN = 0;                                                       //Hand the pins back to the port
+   LC01B_SCL_LAT = 0;
+   LC01B_SDA_LAT = 0;
+   LC01B_SDA_TRIS = 1;                                                          //Release SDA
+
+   //Nine clocks let a slave finish the byte it is driving
+   for(idx=0; idx<9; idx++){
+      LC01B_SCL_TRIS = 0;                                                       //SCL low
+      __delay_us(LC01B_RECOVER_US);
+      LC01B_SCL_TRIS = 1;                                                       //SCL released high
+      __delay_us(LC01B_RECOVER_US);
+   }
+
+   //Stop: SDA rises while SCL is high
+   LC01B_SCL_TRIS = 0;
+   LC01B_SDA_TRIS = 0;
+   __delay_us(LC01B_RECOVER_US);
+   LC01B_SCL_TRIS = 1;
+   __delay_us(LC01B_RECOVER_US);
+   LC01B_SDA_TRIS = 1;
+   __delay_us(LC01B_RECOVER_US);
+
+   //Back to the I2C1 module, reset and set up as init_I2C left it
+   I2C1STATbits.BCL = 0;
+   I2C1STATbits.IWCOL = 0;
+   lc01b_Setup();
+}
+
+//---------------------------------------------------------------
+//Write the pattern and read it back LC01B_CAL_PASSES times at
+//the running speed
+//---------------------------------------------------------------
+static ee_Errors_t lc01b_CalPass(uint16_t ee_addr){
+
+   uint8_t pattern[LC01B_CAL_LEN], check[LC01B_CAL_LEN];
+   uint8_t pass, idx;
+   ee_Errors_t errCode;
+
+   for(pass=0; pass<LC01B_CAL_PASSES; pass++){
+      for(idx=0; idx<LC01B_CAL_LEN; idx++)                                     //Alternating bits, shifted each pass
+         pattern[idx] = ((idx + pass) & 1 ? 0xAA : 0x55) ^ (idx << pass);
+
+      errCode = lc01b_WritePage(ee_addr,LC01B_CAL_LEN,pattern);
+      if(errCode == ERR_NONE)
+         errCode = lc01b_ReadSeq(ee_addr,LC01B_CAL_LEN,check);
+      if(errCode == ERR_NONE && memcmp(pattern,check,LC01B_CAL_LEN))
+         errCode = ERR_VERIFY;                                                  //Read back did not match
+      if(errCode)
+         return errCode;
+   }
+   return ERR_NONE;
+}
+
+//---------------------------------------------------------------
+//Pick the fastest bus speed that passes the write/verify test
+//---------------------------------------------------------------
+ee_Errors_t lc01b_Calibrate(uint16_t ee_addr,uint16_t *pBRG){
+
+   static const uint16_t speeds[] = {I2C_BRG_100,I2C_BRG_400,I2C_BRG_1000};
+   uint8_t saved[LC01B_CAL_LEN];
+   uint8_t idx, best = 0, haveSaved;
+   ee_Errors_t errCode, restoreErr;
+
+   if(ee_addr % LC01B_CAL_LEN)
+      return ERR_PAGE_BOUNDS;
+   else if(lc01b_OutOfBounds(lc01b_pDev,ee_addr,LC01B_CAL_LEN))
+      return ERR_MEM_BOUNDS;
+
+   //Start from the slowest speed and keep the scratch contents
+   init_I2C(speeds[0]);
+   ack_Poll();
+   errCode = lc01b_ReadSeq(ee_addr,LC01B_CAL_LEN,saved);
+   haveSaved = (errCode == ERR_NONE);
+   if(errCode == ERR_NONE)
+      errCode = lc01b_CalPass(ee_addr);
+
+   for(idx=1; errCode == ERR_NONE && idx<sizeof(speeds)/sizeof(speeds[0]); idx++){
+      init_I2C(speeds[idx]);
+      ack_Poll();
+      if(lc01b_CalPass(ee_addr) != ERR_NONE)
+         break;                                                                 //Too fast for this bus
+      best = idx;
+   }
+
+   //Lock in the best speed and put the scratch bytes back
+   init_I2C(speeds[best]);
+   ack_Poll();                                                                  //Finish any cycle a failed pass left running
+   if(haveSaved){                                                               //Even after a failed 100kHz pass
+      restoreErr = lc01b_WritePage(ee_addr,LC01B_CAL_LEN,saved);
+      if(errCode == ERR_NONE)
+         errCode = restoreErr;
+   }
+   if(pBRG)
+      *pBRG = speeds[best];
+   return errCode;
+}
+
+#ifdef __XC16__
+//------------------------------------------------------------
+//I2C1 master event interrupt. Host builds call lc01b_Service()
+//from their own I2C1 model instead
+//------------------------------------------------------------
+void __attribute__((interrupt,no_auto_psv)) _MI2C1Interrupt(void){
+   IFS1bits.MI2C1IF = 0;
+   lc01b_Service();
+}
+#endif
@@ -9,9 +9,65 @@
 extern "C" {
 #endif
 
-//I2C baud rate selection values
-#define I2C_BRG_100 157                                                         //100kHz bus: FCY = 16MHz
-#define I2C_BRG_400 37                                                          //400kHz bus: FCY = 16MHz
+//I2C baud rate selection values. BRG = FCY/FSCL - FCY*PGD - 1 with the
+//100ns pulse gobbler delay, worked in tenths so it rounds like the
+//datasheet table (157 and 37 at FCY = 16MHz)
+#define I2C_BRG(fscl) ((((FCY) * 10 / (fscl)) - ((FCY) / 1000000) - 10) / 10)
+#define I2C_BRG_100  I2C_BRG(100000UL)                                          //100kHz bus
+#define I2C_BRG_400  I2C_BRG(400000UL)                                          //400kHz bus
+#define I2C_BRG_1000 I2C_BRG(1000000UL)                                         //1MHz bus, 24FCxx parts only
+
+#if I2C_BRG_100 > 511 || I2C_BRG_1000 < 2
+#error "I2C1BRG out of range for this FCY"
+#endif
+
+//Protected objects. The value is the number of CRC bytes stored after
+//the object, high byte first
+#define LC01B_CRC8  1                                                           //CRC-8, poly 0x07, init 0xFF
+#define LC01B_CRC16 2                                                           //CRC-16/CCITT, poly 0x1021, init 0xFFFF
+#define LC01B_CRC_INIT(crcType) ((crcType) == LC01B_CRC8 ? 0xFF : 0xFFFF)
+#define LC01B_CRC_VALID(crcType) ((crcType) == LC01B_CRC8 || (crcType) == LC01B_CRC16)
+
+//Pattern fill and verify
+#define LC01B_NO_MISMATCH 0xFFFF
+
+//Scatter-gather reads
+#define LC01B_SEG_MAX       16                                                  //Segments per lc01b_ReadBatch call
+#define LC01B_BATCH_BUF     32                                                  //Bounce buffer; longer runs stream through it
+#define LC01B_READ_OVERHEAD 3                                                   //Byte times to re-address, plus the address bytes
+
+//One piece of a scatter-gather read
+typedef struct{
+   uint16_t          ee_addr;                                                   //Memory address
+   uint16_t          len;                                                       //Bytes to read
+   void              *pDst;                                                     //Where the bytes go
+}lc01b_Seg_t;
+
+//Write batch. Updates are collected in a caller owned segment array,
+//pSrc buffers must stay valid until lc01b_BatchCommit
+typedef struct{
+   lc01b_Seg_t       *pSegs;                                                    //pDst holds each update's source
+   uint8_t           count;                                                     //Updates collected
+   uint8_t           max;                                                       //Size of pSegs
+}lc01b_Batch_t;
+
+//Bus time budgets. A bus event gets LC01B_EVENT_BITS bit times and the
+//ack poll gives up after LC01B_POLL_MARGIN times the worst write cycle
+#define LC01B_EVENT_BITS  9                                                     //Longest single event; one byte plus ack
+#define LC01B_POLL_BITS   11                                                    //Start, control byte, ack and stop
+#define LC01B_TWC_US      5000UL                                                //Max write cycle time
+#define LC01B_POLL_MARGIN 2
+
+//I2C1 pins, driven as port pins during bus recovery
+#define LC01B_SCL_TRIS TRISBbits.TRISB8
+#define LC01B_SCL_LAT  LATBbits.LATB8
+#define LC01B_SDA_TRIS TRISBbits.TRISB9
+#define LC01B_SDA_LAT  LATBbits.LATB9
+#define LC01B_RECOVER_US 5                                                      //Half an SCL period at 100kHz
+
+//Bus speed calibration
+#define LC01B_CAL_LEN    8                                                      //Test pattern bytes, fits any 24xx page
+#define LC01B_CAL_PASSES 4                                                      //Clean passes needed to accept a speed
     
 //LC01B characteristics
 #define LC01B_WRITE   0xA0                                                      //Control byte, write mode
@@ -19,30 +75,242 @@ extern "C" {
 #define LC01B_PAGE    8                                                         //Eight byte page size
 #define LC01B_CAP     128                                                       //Memory capacity of 128 bytes
 #define LC01B_MAX_ADR 0x7F                                                      //Max memory address
+
+//24xx device descriptors
+//Largest page lc01b_BatchCommit can stage on the stack. Defaults to the
+//24LC01B page; builds that run bigger parts set it with -DLC01B_MAX_PAGE
+#ifndef LC01B_MAX_PAGE
+#define LC01B_MAX_PAGE LC01B_PAGE
+#endif
+#define LC01B_DIFF_BUF 8                                                        //WriteDiff reads a page back this many bytes at a time
+
+//Page size, max address, address bytes, block bits in the control byte
+//and chip select (A2..A0 pins)
+#define LC01B_DEV(page,maxAdr,adrBytes,blkBits,cs) \
+   {(page),(maxAdr),(adrBytes),(blkBits),LC01B_WRITE | (((cs) & 0x07) << 1),0,0,0}
+
+#define LC01B_DEV_24LC01B    LC01B_DEV(8,0x007F,1,0,0)                          //128 bytes
+#define LC01B_DEV_24LC02B    LC01B_DEV(8,0x00FF,1,0,0)                          //256 bytes
+#define LC01B_DEV_24LC16B    LC01B_DEV(16,0x07FF,1,3,0)                         //2K bytes, eight 256 byte blocks
+#define LC01B_DEV_24LC64(cs) LC01B_DEV(32,0x1FFF,2,0,cs)                        //8K bytes
+#define LC01B_DEV_24LC256(cs) LC01B_DEV(64,0x7FFF,2,0,cs)                       //32K bytes
+#define LC01B_DEV_24LC512(cs) LC01B_DEV(128,0xFFFF,2,0,cs)                      //64K bytes
+
+typedef struct{
+   uint8_t           pageSize;                                                  //Page write latch size
+   uint16_t          maxAddr;                                                   //Highest memory address
+   uint8_t           addrBytes;                                                 //1 or 2 memory address bytes
+   uint8_t           blockBits;                                                 //Upper address bits in the control byte
+   uint8_t           ctrl;                                                      //Control byte, write mode, chip select applied
+   volatile uint8_t  writeCycle;                                                //Write cycle may still be running
+   uint16_t          ptrEpoch;                                                  //init_I2C epoch addrPtr was learned in, 0 if never
+   uint16_t          addrPtr;                                                   //Shadow of the internal address pointer
+}lc01b_Dev_t;
+
+//Transaction engine
+#define LC01B_INT_PRI      4                                                    //MI2C1 interrupt priority
+#define LC01B_XFER_WRITE   0                                                    //Page split write + ack poll
+#define LC01B_XFER_READ    1                                                    //Random address sequential read
+#define LC01B_XFER_READCUR 2                                                    //Current address sequential read
+#define LC01B_XFER_POLL    3                                                    //Ack poll only
+#define LC01B_XFER_PROBE   4                                                    //Single ack poll attempt
+
+//Transaction handle. Owned by the caller and must stay in scope
+//until busy clears
+typedef struct lc01b_Xfer lc01b_Xfer_t;
+typedef void (*lc01b_Done_t)(lc01b_Xfer_t *);                                   //Completion callback; runs in the ISR
+
+struct lc01b_Xfer{
+   uint8_t           type;                                                      //LC01B_XFER_xxx
+   lc01b_Dev_t       *pDev;                                                     //Target device, set on submit
+   uint16_t          ee_addr;                                                   //Starting memory address
+   uint16_t          len;                                                       //Bytes to move
+   uint8_t           *pData;                                                    //Client buffer
+   lc01b_Done_t      pDone;                                                     //Optional; NULL to poll instead
+   volatile uint8_t  busy;                                                      //Non-zero until complete
+   volatile ee_Errors_t errCode;                                                //Result once busy clears
+   lc01b_Xfer_t      *pNext;                                                    //Queue link
+   uint8_t           crcLen;                                                    //CRC bytes at the end of len; 0 for none
+   uint16_t          crc;                                                       //Running CRC
+   uint8_t           lazy;                                                      //Write completes at its final stop bit
+   uint8_t           patLen;                                                    //Non-zero: pData is a pattern repeated over len
+   uint16_t          mismatch;                                                  //First pattern read byte that differed
+#ifdef EE_STATS
+   uint32_t          t0;                                                        //Submit time, stats time base
+#endif
+};
                                                      
 //-------------------------------------------------------
 // Receives: Nothing
 // Returns:  Nothing
-// Summary:  Sets the baud rate generator and activates
-//           the I2C1 module
+// Summary:  Sets the baud rate generator, activates
+//           the I2C1 module and enables the MI2C1
+//           interrupt. On a re-init, transactions
+//           still queued complete with ERR_ABORTED
+//           and every device's address pointer
+//           shadow is forgotten
 //-------------------------------------------------------
-void init_I2C(uint8_t);
+void init_I2C(uint16_t);
 
 //-------------------------------------------------------
 // Receives: Nothing
 // Returns:  Nothing
+// Summary:  Frees a stuck bus. Clocks nine SCL pulses
+//           with SDA released, sends a stop and resets
+//           I2C1 back to the set up init_I2C gave it.
+//           Uses delays; main line only
+//-------------------------------------------------------
+void lc01b_Recover(void);
+
+//-------------------------------------------------------
+// Receives: Eight byte aligned scratch address and a
+//           pointer for the selected BRG value
+// Returns:  Status of the 100kHz pass, ERR_VERIFY if a
+//           read back did not match, or of the restore
+// Summary:  Steps the bus through 100kHz, 400kHz and
+//           1MHz, writing and verifying a test pattern
+//           LC01B_CAL_PASSES times at each. The fastest
+//           speed with no failures is left running and
+//           the scratch bytes are restored whenever they
+//           could be read
+//-------------------------------------------------------
+ee_Errors_t lc01b_Calibrate(uint16_t,uint16_t *);
+
+//-------------------------------------------------------
+// Receives: Device descriptor, NULL for the 24LC01B
+// Returns:  Nothing
+// Summary:  Selects the 24xx part used by the lc01b_xxx
+//           calls. Queued transactions keep the device
+//           they were submitted with
+//-------------------------------------------------------
+void lc01b_SetDevice(lc01b_Dev_t *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Device descriptor in use
+// Summary:  Returns the selected 24xx part
+//-------------------------------------------------------
+lc01b_Dev_t *lc01b_GetDevice(void);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  ERR_CNTL_NACK if the device never answered
 // Summary:  Performs acknowledge polling for page writes
 //-------------------------------------------------------
-void ack_Poll(void);
+ee_Errors_t ack_Poll(void);
 
 //-------------------------------------------------------
-// Receives: EEPROM memory address 
+// Receives: Nothing
+// Returns:  Nothing
+// Summary:  Advances the transaction engine by one I2C1
+//           master event. Called from the MI2C1 ISR
+//-------------------------------------------------------
+void lc01b_Service(void);
+
+//-------------------------------------------------------
+// Receives: Transaction handle
+// Returns:  Result of the transaction
+// Summary:  Blocks until the transaction completes. Not
+//           for use inside an ISR at or above
+//           LC01B_INT_PRI. A bus event that overruns its
+//           budget fails the transaction with
+//           ERR_BUS_TIMEOUT. Runs any bus recovery a
+//           failed transaction left pending, as does the
+//           next submit
+//-------------------------------------------------------
+ee_Errors_t lc01b_Wait(lc01b_Xfer_t *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Non-zero while transactions are queued
+// Summary:  Reports whether the engine is busy
+//-------------------------------------------------------
+uint8_t lc01b_Busy(void);
+
+//-------------------------------------------------------
+// Receives: Non-zero to enable, zero to disable
 // Returns:  Nothing
+// Summary:  Selects deferred (lazy) acknowledge polling.
+//           When enabled, writes complete as soon as the
+//           stop bit is sent and the next access polls
+//           for the end of the write cycle. Applies to
+//           writes queued after the call
+//-------------------------------------------------------
+void lc01b_LazyPoll(uint8_t);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Non-zero if the LC01B is idle
+// Summary:  Reports whether the LC01B can be accessed
+//           without waiting. Sends a single control
+//           byte if a deferred write cycle may still be
+//           running
+//-------------------------------------------------------
+uint8_t lc01b_Idle(void);
+
+//--------------------------------------------------------
+// Receives: Transaction handle, memory address, data
+//           length, pointer to the data to be written and
+//           an optional completion callback
+// Returns:  Status of bounds check
+// Summary:  Queues a write of any length and returns at
+//           once. The engine splits it into page bursts
+//           and ack polls between them
+//--------------------------------------------------------
+ee_Errors_t lc01b_WriteAsync(lc01b_Xfer_t *,uint16_t,uint16_t,uint8_t *,lc01b_Done_t);
+
+//--------------------------------------------------------
+// Receives: Transaction handle, memory address, read
+//           length, output buffer and an optional
+//           completion callback
+// Returns:  Status of bounds check
+// Summary:  Queues a sequential read and returns at once
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadAsync(lc01b_Xfer_t *,uint16_t,uint16_t,uint8_t *,lc01b_Done_t);
+
+//--------------------------------------------------------
+// Receives: Transaction handle, device descriptor,
+//           memory address, data length, pointer to the
+//           data to be written and an optional
+//           completion callback
+// Returns:  Status of bounds check
+// Summary:  Queues a write to the given device whatever
+//           device is selected. It completes at its
+//           final stop bit, so the bus can serve other
+//           devices during the write cycle; the device's
+//           next transaction polls first. Writes longer
+//           than a page still poll between pages
+//--------------------------------------------------------
+ee_Errors_t lc01b_WriteDevAsync(lc01b_Xfer_t *,lc01b_Dev_t *,uint16_t,uint16_t,uint8_t *,lc01b_Done_t);
+
+//--------------------------------------------------------
+// Receives: Transaction handle, device descriptor,
+//           memory address, read length, output buffer
+//           and an optional completion callback
+// Returns:  Status of bounds check
+// Summary:  Queues a sequential read from the given
+//           device whatever device is selected
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadDevAsync(lc01b_Xfer_t *,lc01b_Dev_t *,uint16_t,uint16_t,uint8_t *,lc01b_Done_t);
+
+//--------------------------------------------------------
+// Receives: Transaction handle, read length, output
+//           buffer and an optional completion callback
+// Returns:  Status of bounds check
+// Summary:  Queues a current address read and returns at
+//           once
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadCurAsync(lc01b_Xfer_t *,uint16_t,uint8_t *,lc01b_Done_t);
+
+//-------------------------------------------------------
+// Receives: EEPROM memory address 
+// Returns:  ERR_CNTL_NACK, ERR_MEM_NACK or ERR_BUS_TIMEOUT
+//           on failure, with a stop already sent
 // Summary:  Sends the start bit, control byte and memory 
 //           address byte to the EEPROM. These are common
 //           tasks for all writes and reads
 //--------------------------------------------------------
-void lc01b_SCM(uint8_t);                                  
+ee_Errors_t lc01b_SCM(uint16_t);                                  
 
 //--------------------------------------------------------
 // Receives: Memory address and data byte to be written
@@ -50,31 +318,98 @@ void lc01b_SCM(uint8_t);
 // Summary:  Writes a single byte to the EEPROM at the 
 //           desired location
 //--------------------------------------------------------
-ee_Errors_t lc01b_WriteByte(uint8_t,uint8_t);
+ee_Errors_t lc01b_WriteByte(uint16_t,uint8_t);
 
 //--------------------------------------------------------
 // Receives: Memory address, page length and a pointer to 
 //           the data to be written
 // Returns:  Status of bounds check
 // Summary:  Writes a page to the EEPROM. A page on the
-//           LC01B can be to to eight bytes in length
+//           LC01B can be to to eight bytes in length;
+//           other parts use their descriptor page size.
+//           Writes that would wrap past the end of the
+//           page are rejected with ERR_PAGE_BOUNDS
 //---------------------------------------------------------
-ee_Errors_t lc01b_WritePage(uint8_t,uint8_t,uint8_t *);
+ee_Errors_t lc01b_WritePage(uint16_t,uint16_t,uint8_t *);
+
+//--------------------------------------------------------
+// Receives: Memory address, data length and a pointer to
+//           the data to be written
+// Returns:  Status of bounds check
+// Summary:  Writes any number of bytes to the EEPROM. The
+//           data is split into page aligned bursts so the
+//           fewest possible write cycles are used
+//--------------------------------------------------------
+ee_Errors_t lc01b_Write(uint16_t,uint16_t,uint8_t *);
+
+//--------------------------------------------------------
+// Receives: Memory address, data length, a pointer to the
+//           data to be written and an optional pointer
+//           for the number of pages skipped
+// Returns:  Status of bounds check or of the first failed
+//           page write
+// Summary:  Differential write. Reads each page of the
+//           range back LC01B_DIFF_BUF bytes at a time,
+//           stopping at the first difference, and issues
+//           page writes only for pages whose contents
+//           changed
+//--------------------------------------------------------
+ee_Errors_t lc01b_WriteDiff(uint16_t,uint16_t,uint8_t *,uint16_t *);
 
 //--------------------------------------------------------
 // Receives: Memory address, object length and data object
 // Returns:  Status of bounds check
 // Summary:  Used to write larger data types such as int, 
-//           float, double etc.. to the EEPROM byte by byte
+//           float, double etc.. to the EEPROM using page
+//           writes
+//--------------------------------------------------------
+ee_Errors_t lc01b_WriteObject(uint16_t,uint16_t,void *);
+
+//--------------------------------------------------------
+// Receives: Memory address, object length, data object
+//           and LC01B_CRC8 or LC01B_CRC16
+// Returns:  ERR_ARG for any other CRC type, otherwise
+//           status of bounds check
+// Summary:  Writes the object followed by its CRC. The
+//           CRC is worked out byte by byte as the page
+//           writes go out, so it adds only the CRC bytes
+//           to the bus traffic
+//--------------------------------------------------------
+ee_Errors_t lc01b_WriteObjectCrc(uint16_t,uint16_t,void *,uint8_t);
+
+//--------------------------------------------------------
+// Receives: Memory address, length, pattern and pattern
+//           length (1 to 255 bytes)
+// Returns:  ERR_ARG for an empty pattern, otherwise
+//           status of bounds check or of the writes
+// Summary:  Fills the range with the pattern repeated
+//           from its first byte at the memory address.
+//           The engine sends it page by page straight
+//           from the pattern, so no staging buffer is
+//           needed. A one byte 0x00 pattern zeroizes
+//--------------------------------------------------------
+ee_Errors_t lc01b_Fill(uint16_t,uint16_t,uint8_t *,uint8_t);
+
+//--------------------------------------------------------
+// Receives: Memory address, length, pattern, pattern
+//           length and an optional pointer for the
+//           address of the first mismatch
+// Returns:  ERR_ARG for an empty pattern, ERR_VERIFY on
+//           a mismatch, otherwise status of bounds check
+//           or of the read
+// Summary:  Compares the range against the pattern as
+//           lc01b_Fill lays it out, in one sequential
+//           read. The mismatch address is
+//           LC01B_NO_MISMATCH unless ERR_VERIFY
 //--------------------------------------------------------
-ee_Errors_t lc01b_WriteObject(uint8_t,uint8_t,void *);
+ee_Errors_t lc01b_Verify(uint16_t,uint16_t,uint8_t *,uint8_t,uint16_t *);
 
 //--------------------------------------------------------
 // Receives: Memory address and address for data byte
 // Returns:  Status of bounds check
 // Summary:  Random access read of a single byte
 //--------------------------------------------------------
-ee_Errors_t lc01b_ReadByte(uint8_t,uint8_t *);
+ee_Errors_t lc01b_ReadByte(uint16_t,uint8_t *);
 
 //--------------------------------------------------------
 // Receives: Memory address, read length and pointer to a 
@@ -85,17 +420,102 @@ ee_Errors_t lc01b_ReadByte(uint8_t,uint8_t *);
 //           specified address. Output is stored in the
 //           buffer provided by the client
 //--------------------------------------------------------
-ee_Errors_t lc01b_ReadSeq(uint8_t,uint8_t,uint8_t *);
+ee_Errors_t lc01b_ReadSeq(uint16_t,uint16_t,uint8_t *);
+
+//--------------------------------------------------------
+// Receives: Read length and pointer to an output buffer
+// Returns:  Status of bounds check
+// Summary:  Current address read. Reads sequentially from
+//           the LC01B's internal address pointer, skipping
+//           the memory address phase and dummy write
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadCur(uint16_t,uint8_t *);
+
+//--------------------------------------------------------
+// Receives: Memory address, read length and pointer to a
+//           buffer to write the output into
+// Returns:  Status of bounds check
+// Summary:  Streaming read for consecutive records. Uses a
+//           current address read when the address matches
+//           where the last read stopped, otherwise falls
+//           back to lc01b_ReadSeq
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadStream(uint16_t,uint16_t,uint8_t *);
 
 //--------------------------------------------------------
 // Receives: Memory address, data length and a pointer to
 //           a data object to write the output into
 // Returns:  Status of bounds check
 // Summary:  Reads the specified number of bytes from the 
-//           EEPROM and writes the output to the data
-//           object provided by the client
+//           EEPROM in one sequential transaction and writes
+//           the output to the data object provided by the
+//           client
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadObject(uint16_t,uint16_t,void *);
+
+//--------------------------------------------------------
+// Receives: Memory address, object length, data object
+//           and LC01B_CRC8 or LC01B_CRC16
+// Returns:  ERR_ARG for a CRC type other than those,
+//           ERR_CRC if the object or its CRC is corrupt,
+//           otherwise status of the read
+// Summary:  Reads an object written by
+//           lc01b_WriteObjectCrc in one sequential read,
+//           checking the CRC as the bytes arrive
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadObjectCrc(uint16_t,uint16_t,void *,uint8_t);
+
+//--------------------------------------------------------
+// Receives: LC01B_CRC8 or LC01B_CRC16, running CRC, data
+//           pointer and length
+// Returns:  Updated CRC, or crc unchanged for any other
+//           CRC type
+// Summary:  Same CRC the protected object calls use, for
+//           data already in RAM
+//--------------------------------------------------------
+uint16_t lc01b_Crc(uint8_t,uint16_t,void *,uint16_t);
+
+//--------------------------------------------------------
+// Receives: Array of segments and the segment count
+// Returns:  Status of bounds check or of the first
+//           failed read
+// Summary:  Scatter-gather read. Sorts the segments by
+//           address and merges those that overlap or sit
+//           closer than the cost of re-addressing, reading
+//           straight through the gap. Each merged run is
+//           one sequential read and the bytes are copied
+//           out to the segment buffers
+//--------------------------------------------------------
+ee_Errors_t lc01b_ReadBatch(lc01b_Seg_t *,uint8_t);
+
+//--------------------------------------------------------
+// Receives: Batch, segment array and its size
+// Returns:  Nothing
+// Summary:  Starts an empty write batch
+//--------------------------------------------------------
+void lc01b_BatchInit(lc01b_Batch_t *,lc01b_Seg_t *,uint8_t);
+
+//--------------------------------------------------------
+// Receives: Batch, memory address, data length and a
+//           pointer to the data
+// Returns:  ERR_MEM_BOUNDS or ERR_BATCH_FULL
+// Summary:  Adds an update to the batch. Nothing is
+//           written yet; later updates win where they
+//           overlap earlier ones
+//--------------------------------------------------------
+ee_Errors_t lc01b_BatchAdd(lc01b_Batch_t *,uint16_t,uint16_t,void *);
+
+//--------------------------------------------------------
+// Receives: Batch
+// Returns:  Status of the first failed read or write
+// Summary:  Writes the batch with one page write per
+//           touched page. Bytes between updates in the
+//           same page are read back first, and only
+//           when there are such gaps. The batch is
+//           emptied on success. ERR_PAGE_BOUNDS if the
+//           device page is over LC01B_MAX_PAGE
 //--------------------------------------------------------
-ee_Errors_t lc01b_ReadObject(uint8_t,uint8_t,void *);
+ee_Errors_t lc01b_BatchCommit(lc01b_Batch_t *);
 
 #ifdef	__cplusplus
 }
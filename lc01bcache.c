@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Write-back RAM cache for the MCP24LC01B
+ * 
+ * Summary:
+ *  - The whole 128 byte array is mirrored in RAM by one sequential read
+ *  - Reads are served from the mirror
+ *  - Writes update the mirror and set a bit in a 16-bit dirty page map
+ *  - A flush commits each dirty page with a single page write, so any
+ *    number of scattered updates costs at most 16 write cycles
+ *  - Flushes run on demand or once a set number of pages are dirty
+ * 
+ * Anything written to the LC01B directly through lc01b.c bypasses the
+ * mirror; call lcache_Load() again afterwards
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "lc01bcache.h"
+
+static uint8_t  lcache_Mirror[LC01B_CAP];
+static uint16_t lcache_DirtyMap = 0;
+static uint8_t  lcache_Loaded = 0;
+static uint8_t  lcache_Threshold = LCACHE_AUTO_OFF;
+
+//Fill the mirror from the LC01B
+ee_Errors_t lcache_Load(void){
+   
+   ee_Errors_t errCode;
+   
+   errCode = lc01b_ReadSeq(0x00,LC01B_CAP,lcache_Mirror);                       //One transaction for the whole array
+   if(errCode == ERR_NONE){
+      lcache_DirtyMap = 0;
+      lcache_Loaded = 1;
+   }
+   return errCode;
+}
+
+//Read from the mirror, loading it first if needed
+ee_Errors_t lcache_Read(uint8_t ee_addr,uint8_t len,void *pData){
+   
+   ee_Errors_t errCode;
+   
+   if((ee_addr + len - 1) > LC01B_MAX_ADR)
+      return ERR_MEM_BOUNDS;
+   if(!lcache_Loaded){
+      errCode = lcache_Load();
+      if(errCode)
+         return errCode;
+   }
+   memcpy(pData,&lcache_Mirror[ee_addr],len);
+   return ERR_NONE;
+}
+
+//Update the mirror and mark the touched pages dirty
+ee_Errors_t lcache_Write(uint8_t ee_addr,uint8_t len,void *pData){
+   
+   ee_Errors_t errCode;
+   uint8_t page, dirtyPages;
+   uint16_t map;
+   
+   if((ee_addr + len - 1) > LC01B_MAX_ADR)
+      return ERR_MEM_BOUNDS;
+   if(len == 0)
+      return ERR_NONE;
+   if(!lcache_Loaded){                                                          //Partial pages need the current contents
+      errCode = lcache_Load();
+      if(errCode)
+         return errCode;
+   }
+   
+   memcpy(&lcache_Mirror[ee_addr],pData,len);
+   for(page = ee_addr/LC01B_PAGE; page <= (ee_addr + len - 1)/LC01B_PAGE; page++)
+      lcache_DirtyMap |= (1u << page);
+   
+   //Flush once enough pages have piled up
+   if(lcache_Threshold != LCACHE_AUTO_OFF){
+      dirtyPages = 0;
+      for(map = lcache_DirtyMap; map; map >>= 1)
+         dirtyPages += map & 1;
+      if(dirtyPages >= lcache_Threshold)
+         return lcache_Flush();
+   }
+   return ERR_NONE;
+}
+
+//Write each dirty page back with one page write
+ee_Errors_t lcache_Flush(void){
+   
+   ee_Errors_t errCode;
+   uint8_t page;
+   
+   for(page = 0; page < LCACHE_PAGES; page++){
+      if(lcache_DirtyMap & (1u << page)){
+         errCode = lc01b_WritePage(page*LC01B_PAGE,LC01B_PAGE,&lcache_Mirror[page*LC01B_PAGE]);
+         if(errCode)
+            return errCode;                                                     //Page stays dirty for a retry
+         lcache_DirtyMap &= ~(1u << page);
+      }
+   }
+   return ERR_NONE;
+}
+
+//Set the number of dirty pages that triggers a flush
+void lcache_SetThreshold(uint8_t pages){
+   
+   lcache_Threshold = pages;
+}
+
+//Report the dirty page map
+uint16_t lcache_Dirty(void){
+   
+   return lcache_DirtyMap;
+}
@@ -0,0 +1,75 @@
+/* 
+ * File:   lc01bcache.h
+ *
+ * Optional write-back RAM cache of the entire 24LC01B. Requires
+ * sys.h and lc01b.h to be included first
+ */
+
+#ifndef LC01BCACHE_H
+#define	LC01BCACHE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define LCACHE_PAGES (LC01B_CAP/LC01B_PAGE)                                     //16 pages; one dirty bit each
+#define LCACHE_AUTO_OFF 0                                                       //Threshold value; flush on demand only
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Status of the sequential read
+// Summary:  Fills the RAM mirror with the contents of
+//           the LC01B in one sequential read and clears
+//           all dirty bits
+//-------------------------------------------------------
+ee_Errors_t lcache_Load(void);
+
+//-------------------------------------------------------
+// Receives: Memory address, read length and pointer to
+//           an output buffer
+// Returns:  Status of bounds check
+// Summary:  Reads from the RAM mirror. No bus traffic
+//           once the mirror has been loaded
+//-------------------------------------------------------
+ee_Errors_t lcache_Read(uint8_t,uint8_t,void *);
+
+//-------------------------------------------------------
+// Receives: Memory address, data length and pointer to
+//           the data to be written
+// Returns:  Status of bounds check or of an automatic
+//           flush
+// Summary:  Updates the RAM mirror and marks the touched
+//           pages dirty. Flushes when the number of dirty
+//           pages reaches the threshold
+//-------------------------------------------------------
+ee_Errors_t lcache_Write(uint8_t,uint8_t,void *);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Status of the first failing page write
+// Summary:  Writes every dirty page back to the LC01B
+//           with a single page write each
+//-------------------------------------------------------
+ee_Errors_t lcache_Flush(void);
+
+//-------------------------------------------------------
+// Receives: Number of dirty pages that triggers a flush
+// Returns:  Nothing
+// Summary:  Sets the automatic flush threshold.
+//           LCACHE_AUTO_OFF disables automatic flushes
+//-------------------------------------------------------
+void lcache_SetThreshold(uint8_t);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Dirty page bitmap. Bit n = page n
+// Summary:  Reports which pages are waiting to be flushed
+//-------------------------------------------------------
+uint16_t lcache_Dirty(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* LC01BCACHE_H */
+
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * Log-structured key/value record store on the MCP24LC01B
+ * 
+ * Summary:
+ *  - Each record fills one 8 byte page: key, sequence number, length,
+ *    up to four value bytes and a check byte
+ *  - Updates append a new record at the head of a circular log with a
+ *    single page write; no read-modify-write
+ *  - A RAM index maps each key to the page holding its newest record and
+ *    is rebuilt at boot by streaming the whole device through a one page
+ *    buffer
+ *  - When the log wraps, pages holding live records are skipped and stale
+ *    ones reused. Compaction moves a live record forward once it has sat
+ *    for KVS_AGE_MAX appends, so static settings rejoin the rotation and
+ *    wear spreads over every page. This also keeps all live sequence
+ *    numbers within half of the 8-bit range so they compare correctly
+ * *****************************************************************************/
+#include <xc.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "lc01bkvs.h"
+
+//RAM index; one entry per live key
+static uint8_t kvs_Key[KVS_MAX_KEYS];
+static uint8_t kvs_Page[KVS_MAX_KEYS];
+static uint8_t kvs_Seq[KVS_MAX_KEYS];
+static uint8_t kvs_Count = 0;
+
+static uint8_t kvs_Head = 0;                                                    //Next page to try for an append
+static uint8_t kvs_NextSeq = 0;                                                 //Sequence number of the next append
+
+//Compute the check byte of a record
+static uint8_t kvs_Check(uint8_t *pRec){
+   
+   uint8_t sum = 0;
+   
+   for(uint8_t ctr=0;ctr<KVS_CHECK;ctr++)
+      sum += pRec[ctr];
+   return ~sum;
+}
+
+//Non-zero if the page holds a well formed record
+static uint8_t kvs_Valid(uint8_t *pRec){
+   
+   return pRec[KVS_KEY] != 0x00 && pRec[KVS_KEY] != 0xFF
+          && pRec[KVS_LEN] <= KVS_MAX_LEN && pRec[KVS_CHECK] == kvs_Check(pRec);
+}
+
+//Index slot of a key, or KVS_MAX_KEYS if not present
+static uint8_t kvs_Find(uint8_t key){
+   
+   uint8_t idx;
+   
+   for(idx=0;idx<kvs_Count;idx++){
+      if(kvs_Key[idx] == key)
+         break;
+   }
+   return (idx < kvs_Count) ? idx : KVS_MAX_KEYS;
+}
+
+//Non-zero if a page holds the newest record of some key
+static uint8_t kvs_Live(uint8_t page){
+   
+   for(uint8_t idx=0;idx<kvs_Count;idx++){
+      if(kvs_Page[idx] == page)
+         return 1;
+   }
+   return 0;
+}
+
+//Write a record at the next page that holds no live record
+static ee_Errors_t kvs_Append(uint8_t idx,uint8_t *pRec){
+   
+   ee_Errors_t errCode;
+   uint8_t page = kvs_Head;
+   
+   while(kvs_Live(page))                                                        //At most KVS_MAX_KEYS pages are live
+      page = (page + 1) % KVS_PAGES;
+   
+   pRec[KVS_SEQ] = kvs_NextSeq;
+   pRec[KVS_CHECK] = kvs_Check(pRec);
+   errCode = lc01b_WritePage(page*LC01B_PAGE,LC01B_PAGE,pRec);
+   if(errCode)
+      return errCode;
+   
+   kvs_Page[idx] = page;
+   kvs_Seq[idx] = kvs_NextSeq++;
+   kvs_Head = (page + 1) % KVS_PAGES;
+   return ERR_NONE;
+}
+
+//Move forward any live record that has sat too long
+static ee_Errors_t kvs_Compact(void){
+   
+   ee_Errors_t errCode;
+   uint8_t rec[LC01B_PAGE];
+   
+   for(uint8_t idx=0;idx<kvs_Count;idx++){
+      if((uint8_t)(kvs_NextSeq - kvs_Seq[idx]) > KVS_AGE_MAX){
+         errCode = lc01b_ReadSeq(kvs_Page[idx]*LC01B_PAGE,LC01B_PAGE,rec);
+         if(errCode == ERR_NONE)
+            errCode = kvs_Append(idx,rec);                                      //Copy lands before the old page goes stale
+         if(errCode)
+            return errCode;
+      }
+   }
+   return ERR_NONE;
+}
+
+//Rebuild the RAM index from one streamed read, a page at a time
+ee_Errors_t kvs_Mount(void){
+   
+   ee_Errors_t errCode;
+   uint8_t rec[LC01B_PAGE];
+   uint8_t page, idx, newest = 0, newestSeq = 0, found = 0;
+   
+   kvs_Count = 0;
+   for(page=0;page<KVS_PAGES;page++){
+      errCode = lc01b_ReadStream(page*LC01B_PAGE,LC01B_PAGE,rec);               //Continues from the device pointer
+      if(errCode){
+         kvs_Count = 0;
+         return errCode;
+      }
+      if(!kvs_Valid(rec))
+         continue;
+      
+      //Keep the newest record of each key
+      idx = kvs_Find(rec[KVS_KEY]);
+      if(idx == KVS_MAX_KEYS && kvs_Count < KVS_MAX_KEYS){
+         idx = kvs_Count++;
+         kvs_Key[idx] = rec[KVS_KEY];
+         kvs_Page[idx] = page;
+         kvs_Seq[idx] = rec[KVS_SEQ];
+      }
+      else if(idx != KVS_MAX_KEYS && (int8_t)(rec[KVS_SEQ] - kvs_Seq[idx]) > 0){
+         kvs_Page[idx] = page;
+         kvs_Seq[idx] = rec[KVS_SEQ];
+      }
+      
+      //The log head follows the newest record overall
+      if(!found || (int8_t)(rec[KVS_SEQ] - newestSeq) > 0){
+         newest = page;
+         newestSeq = rec[KVS_SEQ];
+      }
+      found = 1;
+   }
+   
+   kvs_Head = found ? (newest + 1) % KVS_PAGES : 0;
+   kvs_NextSeq = found ? newestSeq + 1 : 0;
+   return ERR_NONE;
+}
+
+//Append a new value for a key
+ee_Errors_t kvs_Put(uint8_t key,uint8_t len,void *pData){
+   
+   ee_Errors_t errCode;
+   uint8_t rec[LC01B_PAGE];
+   uint8_t idx;
+   
+   if(len > KVS_MAX_LEN || key == 0x00 || key == 0xFF)
+      return ERR_MEM_BOUNDS;
+   
+   idx = kvs_Find(key);
+   if(idx == KVS_MAX_KEYS){
+      if(kvs_Count == KVS_MAX_KEYS)
+         return ERR_KEYS_FULL;
+      idx = kvs_Count;                                                          //Claimed once the append lands
+   }
+   
+   memset(rec,0,LC01B_PAGE);
+   rec[KVS_KEY] = key;
+   rec[KVS_LEN] = len;
+   memcpy(&rec[KVS_DATA],pData,len);
+   errCode = kvs_Append(idx,rec);
+   if(errCode)
+      return errCode;
+   if(idx == kvs_Count){
+      kvs_Key[idx] = key;
+      kvs_Count++;
+   }
+   return kvs_Compact();
+}
+
+//Read the newest value for a key
+ee_Errors_t kvs_Get(uint8_t key,uint8_t bufLen,void *pData){
+   
+   ee_Errors_t errCode;
+   uint8_t rec[LC01B_PAGE];
+   uint8_t idx = kvs_Find(key);
+   
+   if(idx == KVS_MAX_KEYS)
+      return ERR_NO_KEY;
+   
+   errCode = lc01b_ReadSeq(kvs_Page[idx]*LC01B_PAGE,LC01B_PAGE,rec);
+   if(errCode)
+      return errCode;
+   if(!kvs_Valid(rec) || rec[KVS_KEY] != key)
+      return ERR_NO_KEY;
+   memcpy(pData,&rec[KVS_DATA],(rec[KVS_LEN] < bufLen) ? rec[KVS_LEN] : bufLen);
+   return ERR_NONE;
+}
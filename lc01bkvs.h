@@ -0,0 +1,60 @@
+/* 
+ * File:   lc01bkvs.h
+ *
+ * Log-structured, wear-leveled key/value record store on the 24LC01B.
+ * Requires sys.h and lc01b.h to be included first
+ */
+
+#ifndef LC01BKVS_H
+#define	LC01BKVS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define KVS_PAGES    (LC01B_CAP/LC01B_PAGE)                                     //One record per page
+#define KVS_MAX_KEYS 8                                                          //Live keys held in the RAM index
+#define KVS_MAX_LEN  4                                                          //Value bytes per record
+#define KVS_AGE_MAX  96                                                         //Appends before a live record is moved forward
+
+//Record layout within an 8 byte page
+#define KVS_KEY   0                                                             //Key; 0x00 and 0xFF are reserved
+#define KVS_SEQ   1                                                             //Append sequence number
+#define KVS_LEN   2                                                             //Value length
+#define KVS_DATA  3                                                             //Value; up to KVS_MAX_LEN bytes
+#define KVS_CHECK 7                                                             //Inverted sum of bytes 0-6
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Status of the first failed read
+// Summary:  Streams the whole LC01B a page at a time
+//           and rebuilds the RAM index of the newest
+//           record for each key. Call once at boot
+//-------------------------------------------------------
+ee_Errors_t kvs_Mount(void);
+
+//-------------------------------------------------------
+// Receives: Key, value length and pointer to the value
+// Returns:  Status of the page write, ERR_MEM_BOUNDS if
+//           the value is too long or ERR_KEYS_FULL if a
+//           new key does not fit in the index
+// Summary:  Appends a new record for the key with a
+//           single page write
+//-------------------------------------------------------
+ee_Errors_t kvs_Put(uint8_t,uint8_t,void *);
+
+//-------------------------------------------------------
+// Receives: Key, size of the output buffer and pointer
+//           to the output buffer
+// Returns:  Status of the read or ERR_NO_KEY
+// Summary:  Reads the newest value stored for the key.
+//           At most the buffer size is copied
+//-------------------------------------------------------
+ee_Errors_t kvs_Get(uint8_t,uint8_t,void *);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* LC01BKVS_H */
+
@@ -72,8 +72,15 @@
 #include "sys.h"
 #include "lc01b.h"                                                              //MCP24LC01B EEPROM library
 #include "obeeprom.h"                                                           //PIC24F on board EEPROM library
+#include "eemirror.h"                                                           //LC01B <-> on board EEPROM copies
+#include "eestats.h"                                                            //Optional driver statistics
 #include <libpic30.h>
-#include <string.h>
+
+//Persistent objects in the 24LC01B. Addresses are assigned at compile time
+#define EEOBJ_TABLE(X) \
+   X(pi,float,LC01B_CRC8) \
+   X(bigUn,uint64_t,LC01B_CRC16)
+#include "eeobj.h"                                                              //Compile time object layout
 
 //Status LED pin defines
 #define LED_T TRISBbits.TRISB15
@@ -93,11 +100,8 @@ int main(void) {
    uint8_t  memByte = 0x00;
    uint8_t  byteOut = 0x45;
    uint8_t  byteIn;
-   uint8_t  dataOut[LC01B_CAP];
-   uint8_t  dataIn[LC01B_CAP];
-   uint8_t  *pPage = dataOut;
-   uint16_t wordIn; 
-   uint16_t dataWords[NUM_WORDS];    
+   uint8_t  dataOut[LC01B_PAGE];                                                //One page at a time
+   uint16_t dataWords[MIRROR_CHUNK/WORD_LEN];                                   //One mirror chunk at a time
    uint64_t bigUn;
    
    //Enumerated error list
@@ -111,6 +115,14 @@ int main(void) {
    //Enable I2C with a 100kHz clock
    init_I2C(I2C_BRG_100);
    
+   //Run on-board EEPROM erases/writes from the NVM interrupt
+   obee_Init();
+   
+#ifdef EE_STATS
+   //Time base and counters for the driver statistics
+   stats_Init();
+#endif
+   
    //--------------------------------------------------
    //Begin MCP24LC01B demo logic
    //--------------------------------------------------
@@ -125,41 +137,35 @@ int main(void) {
    float pi = 3.14;
    float x;
    
-   errCode = lc01b_WriteObject(0x00,sizeof(pi),&pi);                            //Write the float
+   errCode = EEOBJ_SAVE(pi,&pi);                                                //Write the float and its CRC-8
    if(errCode)
        errHandler();
-   else
-      lc01b_ReadObject(0x00,sizeof(x),&x);                                      //Read the float back
+   else if(EEOBJ_LOAD(pi,&x))                                                   //Read the float back
+      errHandler();
    
    //Write/read a 64-bit unsigned integer
    bigUn = 1844674407370955161;
    
-   errCode = lc01b_WriteObject(0x10,sizeof(bigUn),&bigUn);
+   errCode = EEOBJ_SAVE(bigUn,&bigUn);
    if(errCode)
        errHandler();
    else{
       bigUn = 0;
-      lc01b_ReadObject(0x10,sizeof(bigUn),&bigUn);
+      if(EEOBJ_LOAD(bigUn,&bigUn))
+         errHandler();
    }
    
    //Fill the EEPROM with the ASCII table via page writes
-   for (ctr=0;ctr<LC01B_CAP;ctr++){                                             //Fill the output buffer
-      dataOut[ctr] = ctr;                                                       //0x00 - 0x7F
-   }
-   
    for(ctr=0;ctr<NBR_PAGES;ctr++){                                              //Page writes to the EEPROM
-      errCode = lc01b_WritePage(memByte,LC01B_PAGE,pPage);
+      for(idx=0;idx<LC01B_PAGE;idx++)                                           //Build the page
+         dataOut[idx] = memByte + idx;                                          //0x00 - 0x7F
+      errCode = lc01b_WritePage(memByte,LC01B_PAGE,dataOut);
       if(errCode)                                                               //Break on an error
           break;
-      pPage += LC01B_PAGE;                                                      //Ref the next page to send
       memByte += LC01B_PAGE;                                                    //Bump the EEPROM address
    }
-   
-   //Read the entire LC01B sequentially
    if(errCode)
        errHandler();
-   else
-      lc01b_ReadSeq(0x00,LC01B_CAP,dataIn);
    
    
    //---------------------------------------------
@@ -170,38 +176,41 @@ int main(void) {
    obee_Write(EE_WRITE_ER,OFFSET_LAST,0xDEAD);
    
    //Read back the first and last EEPROM words
-   wordIn = obee_Read(OFFSET_ZERO);
-   wordIn = obee_Read(OFFSET_LAST);
+   if(obee_Read(OFFSET_ZERO) != 0xDEAD || obee_Read(OFFSET_LAST) != 0xDEAD)
+      errHandler();
    
    //Copy 24LC01B contents into the PIC24F on-board EEPROM   
-   for(ctr=0; ctr<LC01B_CAP; ctr+=WORD_LEN){
-      memcpy(&wordIn,&dataIn[ctr],WORD_LEN);
-      obee_Write(EE_WRITE_ER,ctr,wordIn);
-   }
-   
-   //Read the contents back
-   idx = 0;
-   for(ctr=0; ctr<LC01B_CAP; ctr+=WORD_LEN){
-      dataWords[idx++] = obee_Read(ctr);
+   if(mirror_Lc01bToNvm(0x00,OFFSET_ZERO,LC01B_CAP))                            //I2C reads overlap NVM programming
+      errHandler();
+   
+   //Read the contents back one chunk at a time. Each word holds two
+   //consecutive ASCII table bytes, low byte first
+   for(ctr=0; ctr<LC01B_CAP; ctr+=MIRROR_CHUNK){
+      obee_ReadSeq(ctr,MIRROR_CHUNK,dataWords);
+      for(idx=0; idx<MIRROR_CHUNK/WORD_LEN; idx++){
+         if(dataWords[idx] != (((ctr + idx*WORD_LEN + 1) << 8) | (ctr + idx*WORD_LEN)))
+            errHandler();
+      }
    }
     
    //Erase words 12-15; 0x7FFE16 - 0x7FFE1C
    obee_Erase(EE_ERASE_FOUR,24);                                                //24 byte offset
    
-   //Read the 1st 64 words (128 bytes) of the EEPROM sequentially
-   obee_ReadSeq(0,128,dataWords);
-   
-   //Bulk erase the entire contents of the on-board EEPROM
-   obee_Erase(EE_ERASE_BULK,0);
+   //Read the erased words back sequentially
+   obee_ReadSeq(24,4*WORD_LEN,dataWords);
+   for(idx=0; idx<4; idx++){
+      if(dataWords[idx] != 0xFFFF)
+         errHandler();
+   }
    
    //Fill the EEPROM contents with 0xA5A5
-   //Using program only bit (NVMCONbits.pgmonly). Memory already erased
-   memset(dataWords,0xA5A5,512);
-   obee_WriteSeq(EE_WRITE_NOE,OFFSET_ZERO,512,dataWords);                       //No erase
+   //The whole 512 bytes, so one bulk erase, then program only
+   //(EE_WRITE_NOE) runs of the pattern word
+   obee_Fill(OFFSET_ZERO,512,0xA5A5);
    
-   //Read back the contents
-   memset(dataWords,0x0000,512);
-   obee_ReadSeq(OFFSET_ZERO,512,dataWords);
+   //Check the contents in one pass
+   if(obee_Verify(OFFSET_ZERO,512,0xA5A5) != OBEE_NO_MISMATCH)
+      errHandler();
    
    //Demo complete
    while(1);
@@ -9,41 +9,245 @@
  *    locations that have already been erased
  *  - Write/Erase operations do not impede normal program execution 
  *    (if using interrupts)
+ *  - Erases and writes are queued and dispatched one NVM cycle at a time
+ *    from the NVM interrupt. The blocking functions queue an operation and
+ *    wait on it; with the interrupt disabled the waiting caller runs the
+ *    queue itself
+ *  - Reads of words with queued writes or erases are served from the queue
+ *  - obee_WriteBulk only erases words that need a 0->1 bit change and
+ *    groups those erases into aligned 8 and 4 word operations
+ *  - obee_Fill bulk erases only for the full 512 bytes; any other range
+ *    gets the same per block erase plan. Words are then programmed
+ *    without erase in runs that skip words already holding the pattern,
+ *    and a 0xFFFF pattern needs the erase alone
  */
 
 #include "xc.h"
+#include "sys.h"
 #include "obeeprom.h"
+#include "eestats.h"
 
 uint16_t __attribute__ ((space(eedata))) eedata;
 
-//Erase 1, 4 or 8 EEPROM words or bulk erase the entire contents
-void obee_Erase(uint16_t progOp, uint16_t offset){
+//Operation queue. Only touched by the ISR once an operation is queued
+static obee_Op_t * volatile obee_pHead = 0;
+static obee_Op_t *obee_pTail = 0;
+static uint16_t obee_Pos;                                                       //Byte position within the head operation
+static volatile uint8_t obee_Running = 0;                                       //An NVM cycle is in progress
+
+//Data word of an operation at a byte position. Fills repeat one word
+static uint16_t obee_DataWord(obee_Op_t *pOp, uint16_t pos){
     
+    return pOp->pData[pOp->repeat ? 0 : pos/WORD_LEN];
+}
+
+//Start the next NVM cycle of the head operation. Runs in the ISR
+static void obee_Dispatch(void){
+    
+    obee_Op_t *pOp = obee_pHead;
     uint16_t ee_offset;
     
-    //One, four, or eight word OR bulk erase
-    NVMCON = progOp;                                          
+    NVMCON = pOp->nvmOp;                                                        //Erase type or EE_WRITE_ER/EE_WRITE_NOE
+    STATS_NVM(pOp->nvmOp);
     
     //Compute address if not a bulk erase
-    if(progOp != EE_ERASE_BULK){                                             
+    if(pOp->nvmOp != EE_ERASE_BULK){
         TBLPAG = __builtin_tblpage(&eedata);
-        ee_offset = __builtin_tbloffset(&eedata) + offset; 
-        __builtin_tblwtl(ee_offset,0);
+        ee_offset = __builtin_tbloffset(&eedata) + pOp->offset + obee_Pos;
+        __builtin_tblwtl(ee_offset,pOp->pData ? obee_DataWord(pOp,obee_Pos) : 0);
     }
     
+    obee_Running = 1;
     asm volatile ("disi #5");                                                   //Disable interrupts for 5 instructions
-    __builtin_write_NVM();                                                      //Initiate the unlock and erase sequence 
-    while(NVMCONbits.WR);                                                       //Wait for the operation to complete
+    __builtin_write_NVM();                                                      //Initiate the unlock and write sequence
+}
+
+//Retire the finished NVM cycle and dispatch the next one
+void obee_Service(void){
+    
+    obee_Op_t *pOp = obee_pHead;
+    
+    if(pOp == 0 || NVMCONbits.WR)
+       return;
+    
+    if(obee_Running){
+       obee_Running = 0;
+       if(NVMCONbits.WRERR)                                                     //Cleared by the next cycle
+          pOp->failed = 1;
+       obee_Pos += WORD_LEN;
+       if(pOp->pData && obee_Pos < pOp->len){                                   //More words in the sequence
+          obee_Dispatch();
+          return;
+       }
+       
+       //Operation complete; dispatch the next before the callback
+       STATS_XFER(pOp->pData ? STATS_API_OBEE_WRITE : STATS_API_OBEE_ERASE,pOp->len,pOp->t0);
+       obee_pHead = pOp->pNext;
+       if(obee_pHead == 0)
+          obee_pTail = 0;
+       obee_Pos = 0;
+       if(obee_pHead)
+          obee_Dispatch();
+       pOp->busy = 0;
+       if(pOp->pDone)
+          pOp->pDone(pOp);
+       return;
+    }
+    obee_Dispatch();                                                            //Kick from an idle queue
+}
+
+//Queue an operation. An idle queue is kicked through the NVM interrupt flag
+//so the unlock sequence always runs from obee_Service
+static void obee_Submit(obee_Op_t *pOp, uint16_t nvmOp, uint16_t offset, uint16_t len, uint16_t *pData, uint8_t repeat, obee_Done_t pDone){
+    
+    uint8_t intEnable;
+    
+    pOp->nvmOp = nvmOp;
+    pOp->repeat = repeat;
+    pOp->offset = offset;
+    pOp->len = len;
+    pOp->pData = pData;
+    pOp->pDone = pDone;
+    pOp->pNext = 0;
+    pOp->failed = 0;
+#ifdef EE_STATS
+    pOp->t0 = STATS_NOW();
+#endif
+    
+    if(pData && len == 0){                                                      //Nothing to write
+       pOp->busy = 0;
+       if(pDone)
+          pDone(pOp);
+       return;
+    }
+    pOp->busy = 1;
+    
+    intEnable = _NVMIE;
+    _NVMIE = 0;
+    if(obee_pHead == 0){
+       obee_pHead = obee_pTail = pOp;
+       obee_Pos = 0;
+       _NVMIF = 1;                                                              //Software interrupt starts the queue
+    }
+    else{
+       obee_pTail->pNext = pOp;
+       obee_pTail = pOp;
+    }
+    _NVMIE = intEnable;
 }
 
-//Read a words from the EEPROM at the specified offset
+//Queue an erase of 1, 4 or 8 words or a bulk erase
+void obee_EraseAsync(obee_Op_t *pOp, uint16_t progOp, uint16_t offset, obee_Done_t pDone){
+    
+    obee_Submit(pOp,progOp,offset,WORD_LEN,0,0,pDone);
+}
+
+//Queue a write of the specified number of bytes
+void obee_WriteAsync(obee_Op_t *pOp, uint16_t wrType, uint16_t offset, uint16_t len, uint16_t *pBuffer, obee_Done_t pDone){
+    
+    obee_Submit(pOp,wrType,offset,len,pBuffer,0,pDone);
+}
+
+//Queue a write of one word repeated over the specified number of bytes
+void obee_FillAsync(obee_Op_t *pOp, uint16_t wrType, uint16_t offset, uint16_t len, uint16_t *pPattern, obee_Done_t pDone){
+    
+    obee_Submit(pOp,wrType,offset,len,pPattern,1,pDone);
+}
+
+//Block until a queued operation completes
+ee_Errors_t obee_Wait(obee_Op_t *pOp){
+    
+    while(pOp->busy){
+       if(!_NVMIE && _NVMIF){                                                   //No ISR; run the queue here
+          _NVMIF = 0;
+          obee_Service();
+       }
+    }
+    return pOp->failed ? ERR_NVM_WRITE : ERR_NONE;
+}
+
+//Non-zero while any operation is queued or in progress
+uint8_t obee_Busy(void){
+    
+    return obee_pHead != 0;
+}
+
+//Set the NVM interrupt priority and enable it
+void obee_Init(void){
+    
+    _NVMIF = 0;
+    _NVMIP = OBEE_INT_PRI;
+    _NVMIE = 1;
+}
+
+//Erase 1, 4 or 8 EEPROM words or bulk erase the entire contents. Returns
+//the status of the erase cycle
+static ee_Errors_t obee_EraseWait(uint16_t progOp, uint16_t offset){
+    
+    obee_Op_t op;
+    
+    obee_EraseAsync(&op,progOp,offset,0);
+    return obee_Wait(&op);
+}
+
+//Erase 1, 4 or 8 EEPROM words or bulk erase the entire contents
+void obee_Erase(uint16_t progOp, uint16_t offset){
+    
+    obee_EraseWait(progOp,offset);
+}
+
+//Apply the queued operations to one word, oldest first
+static uint16_t obee_Pending(uint16_t offset, uint16_t ee_data){
+    
+    obee_Op_t *pOp;
+    uint16_t first, span;
+    
+    for(pOp = obee_pHead; pOp; pOp = pOp->pNext){
+       switch(pOp->nvmOp){
+          case EE_ERASE_BULK:
+             ee_data = 0xFFFF;
+             break;
+          case EE_ERASE_ONE:
+          case EE_ERASE_FOUR:
+          case EE_ERASE_EIGHT:
+             span = (pOp->nvmOp == EE_ERASE_ONE) ? 1 : (pOp->nvmOp == EE_ERASE_FOUR) ? 4 : 8;
+             first = pOp->offset & ~(span*WORD_LEN - 1);                        //Erases cover an aligned block
+             if(offset >= first && offset < first + span*WORD_LEN)
+                ee_data = 0xFFFF;
+             break;
+          default:                                                              //EE_WRITE_ER or EE_WRITE_NOE
+             if(offset >= pOp->offset && offset < pOp->offset + pOp->len){
+                if(pOp->nvmOp == EE_WRITE_NOE)
+                   ee_data &= obee_DataWord(pOp,offset - pOp->offset);          //Program only clears bits
+                else
+                   ee_data = obee_DataWord(pOp,offset - pOp->offset);
+             }
+             break;
+       }
+    }
+    return ee_data;
+}
+
+//Read a words from the EEPROM at the specified offset. Words with queued
+//writes or erases are served from the queue
 uint16_t obee_Read(uint16_t offset){
     
     uint16_t ee_data, ee_offset;
+    uint8_t  intEnable = _NVMIE;
+#ifdef EE_STATS
+    uint32_t t0 = STATS_NOW();
+#endif
     
+    //An operation retired between the table read and the queue walk would
+    //be in neither; the queue stays put until the word is patched
+    _NVMIE = 0;
     TBLPAG = __builtin_tblpage(&eedata);
     ee_offset = __builtin_tbloffset(&eedata) + offset;
     ee_data = __builtin_tblrdl(ee_offset);
+    if(obee_pHead)
+       ee_data = obee_Pending(offset,ee_data);
+    _NVMIE = intEnable;
+    STATS_XFER(STATS_API_OBEE_READ,WORD_LEN,t0);
     return(ee_data);
 }
 
@@ -59,33 +263,231 @@ void obee_ReadSeq(uint16_t offset,uint16_t len,uint16_t *pBuffer){
    }
 }
 
-//Write a word at the specified memory offset
+//Read a list of segments with one table page setup
+void obee_ReadGather(obee_Seg_t *pSegs, uint8_t count){
+   
+   uint16_t base, pos;
+   uint16_t *pDst;
+   uint8_t  idx, intEnable = _NVMIE;
+#ifdef EE_STATS
+   uint32_t t0 = STATS_NOW();
+#endif
+   
+   _NVMIE = 0;                                                                  //Queue stays put for the whole gather
+   TBLPAG = __builtin_tblpage(&eedata);
+   base = __builtin_tbloffset(&eedata);
+   for(idx=0; idx<count; idx++){
+      pDst = pSegs[idx].pDst;
+      for(pos=pSegs[idx].offset; pos<pSegs[idx].offset + pSegs[idx].len; pos+=WORD_LEN){
+         *pDst = __builtin_tblrdl(base + pos);
+         if(obee_pHead)
+            *pDst = obee_Pending(pos,*pDst);
+         pDst++;
+      }
+      STATS_XFER(STATS_API_OBEE_READ,pSegs[idx].len,t0);
+   }
+   _NVMIE = intEnable;
+}
+
+//Write a word at the specified memory offset. With EE_WRITE_ER the NVM
+//controller erases the word itself before programming it
 void obee_Write(uint16_t wrType, uint16_t offset, uint16_t data){
     
-    uint16_t ee_offset;
-    
-    //Flash requires the word to be erased b4 being written to
-    if(wrType == EE_WRITE_ER)
-       obee_Erase(EE_ERASE_ONE, offset);                                        //Erase one word                                        
+    obee_Op_t op;
     
-    //Write the data word to the EEPROM
-    NVMCON = wrType;                                                            //EE_WRITE_ER or EE_WRITE_NOE
-    TBLPAG = __builtin_tblpage(&eedata);
-    ee_offset = __builtin_tbloffset(&eedata) + offset;
-    __builtin_tblwtl(ee_offset,data);
-    asm volatile ("disi #5");                                                   //Disable interrupts for 5 instructions
-    __builtin_write_NVM();                                                      //Initiate the unlock and erase sequence 
-    while(NVMCONbits.WR);                                                       //Wait for the operation to complete
+    obee_WriteAsync(&op,wrType,offset,WORD_LEN,&data,0);
+    obee_Wait(&op);
 }
 
 //Write the specified number of words to the desired memory offset
 void obee_WriteSeq(uint16_t wrType, uint16_t offset, uint16_t len, uint16_t *pBuffer){
    
+   obee_Op_t op;
+   
+   obee_WriteAsync(&op,wrType,offset,len,pBuffer,0);                            //wrType = EE_WRITE_ER or EE_WRITE_NOE
+   obee_Wait(&op);
+}
+
+
+//Write only the words that changed. Words that just need 1->0 bit changes
+//are programmed without an erase. Returns the number of words skipped
+uint16_t obee_WriteDiff(uint16_t offset, uint16_t len, uint16_t *pBuffer){
+   
    uint16_t ee_offset = offset;
    uint16_t lastWord = offset + len;
+   uint16_t current, skipped = 0;
    
-   while(ee_offset<lastWord){
-      obee_Write(wrType,ee_offset, *pBuffer);                                      //wrType = EE_WRITE_ER or EE_WRITE_NOE
-      pBuffer++; ee_offset += WORD_LEN; 
+   while(ee_offset < lastWord){
+      current = obee_Read(ee_offset);
+      if(*pBuffer == current)
+         skipped++;                                                             //Already holds the data
+      else if(*pBuffer & ~current)
+         obee_Write(EE_WRITE_ER,ee_offset,*pBuffer);                            //Needs a 0->1 transition
+      else
+         obee_Write(EE_WRITE_NOE,ee_offset,*pBuffer);                           //Only clears bits
+      pBuffer++; ee_offset += WORD_LEN;
+   }
+   return skipped;
+}
+
+//Count the words flagged in an erase mask
+static uint16_t obee_Count(uint8_t mask){
+   
+   uint16_t count = 0;
+   
+   for(; mask; mask >>= 1)
+      count += mask & 1;
+   return count;
+}
+
+//Erase the flagged words of an 8 word block using the fewest NVM operations.
+//Bits of inRange mark block words that belong to the write. Stops at the
+//first failed erase
+static ee_Errors_t obee_EraseBlock(uint16_t blockOffset, uint8_t needMask, uint8_t inRange){
+   
+   uint8_t half, word;
+   ee_Errors_t errCode = ERR_NONE;
+   
+   //Whole block in one operation
+   if(inRange == 0xFF && obee_Count(needMask) > 1)
+      return obee_EraseWait(EE_ERASE_EIGHT,blockOffset);
+   
+   //Each half of four words
+   for(half=0; half<ERASE_ROW && errCode == ERR_NONE; half+=4){
+      uint8_t halfNeed  = (needMask >> half) & 0x0F;
+      uint8_t halfRange = (inRange >> half) & 0x0F;
+      
+      if(halfRange == 0x0F && obee_Count(halfNeed) > 1)
+         errCode = obee_EraseWait(EE_ERASE_FOUR,blockOffset + half*WORD_LEN);
+      else{
+         for(word=0; word<4 && errCode == ERR_NONE; word++){
+            if(halfNeed & (1 << word))
+               errCode = obee_EraseWait(EE_ERASE_ONE,blockOffset + (half+word)*WORD_LEN);
+         }
+      }
    }
-}
\ No newline at end of file
+   return errCode;
+}
+
+//Erase the words of a range that programming alone cannot reach, one 8 word
+//block at a time
+ee_Errors_t obee_ErasePlan(uint16_t offset, uint16_t len, uint16_t *pBuffer){
+   
+   uint16_t ee_offset = offset;
+   uint16_t lastWord = offset + len;
+   uint16_t blockOffset, wordOffset, current;
+   uint8_t  needMask, inRange, word;
+   ee_Errors_t errCode = ERR_NONE;
+   
+   while(ee_offset < lastWord && errCode == ERR_NONE){
+      blockOffset = ee_offset & ~(ERASE_ROW*WORD_LEN - 1);                      //Aligned 8 word block
+      
+      //Find the words that need erasing. Programming can only clear bits
+      needMask = inRange = 0;
+      for(word=0; word<ERASE_ROW; word++){
+         wordOffset = blockOffset + word*WORD_LEN;
+         if(wordOffset < ee_offset || wordOffset >= lastWord)
+            continue;
+         inRange |= 1 << word;
+         current = obee_Read(wordOffset);
+         if(*pBuffer++ & ~current)                                              //Needs a 0->1 transition
+            needMask |= 1 << word;
+      }
+      
+      if(needMask)
+         errCode = obee_EraseBlock(blockOffset,needMask,inRange);
+      ee_offset = blockOffset + ERASE_ROW*WORD_LEN;
+   }
+   return errCode;
+}
+
+//Write the specified number of bytes with planned erases
+void obee_WriteBulk(uint16_t offset, uint16_t len, uint16_t *pBuffer){
+   
+   uint16_t ee_offset;
+   
+   obee_ErasePlan(offset,len,pBuffer);
+   
+   //Program every word without a further erase
+   for(ee_offset=offset; ee_offset<offset + len; ee_offset+=WORD_LEN)
+      obee_Write(EE_WRITE_NOE,ee_offset,*pBuffer++);
+}
+
+//Fill a range with one word. Only the whole memory gets a bulk erase;
+//any other range erases, per 8 word block, only words that need a 0->1
+//transition. Erased words already hold an all ones pattern; the rest
+//are programmed without erase in runs, skipping words that already match
+void obee_Fill(uint16_t offset, uint16_t len, uint16_t pattern){
+   
+   obee_Op_t op;
+   uint16_t ee_offset, blockOffset, wordOffset, runStart;
+   uint16_t lastWord = offset + len;
+   uint8_t  needMask, inRange, word;
+   
+   if(offset == OFFSET_ZERO && len == OFFSET_LAST + 1)
+      obee_Erase(EE_ERASE_BULK,0);
+   else{
+      for(ee_offset=offset; ee_offset<lastWord; ee_offset=blockOffset + ERASE_ROW*WORD_LEN){
+         blockOffset = ee_offset & ~(ERASE_ROW*WORD_LEN - 1);                   //Aligned 8 word block
+         needMask = inRange = 0;
+         for(word=0; word<ERASE_ROW; word++){
+            wordOffset = blockOffset + word*WORD_LEN;
+            if(wordOffset < ee_offset || wordOffset >= lastWord)
+               continue;
+            inRange |= 1 << word;
+            if(pattern & ~obee_Read(wordOffset))
+               needMask |= 1 << word;
+         }
+         if(needMask)
+            obee_EraseBlock(blockOffset,needMask,inRange);
+      }
+   }
+   if(pattern == 0xFFFF)
+      return;                                                                   //Erase alone does it
+   
+   for(ee_offset=runStart=offset; ; ee_offset+=WORD_LEN){
+      if(ee_offset < lastWord && obee_Read(ee_offset) != pattern)
+         continue;                                                              //Extend the run
+      if(ee_offset > runStart){
+         obee_FillAsync(&op,EE_WRITE_NOE,runStart,ee_offset - runStart,&pattern,0);
+         obee_Wait(&op);
+      }
+      if(ee_offset >= lastWord)
+         break;
+      runStart = ee_offset + WORD_LEN;
+   }
+}
+
+//Compare a range against one word. Waits for queued operations first
+//so the cells themselves are checked
+uint16_t obee_Verify(uint16_t offset, uint16_t len, uint16_t pattern){
+   
+   uint16_t base, pos;
+#ifdef EE_STATS
+   uint32_t t0 = STATS_NOW();
+#endif
+   
+   while(obee_pHead){                                                           //Drain the queue
+      if(!_NVMIE && _NVMIF){
+         _NVMIF = 0;
+         obee_Service();
+      }
+   }
+   
+   TBLPAG = __builtin_tblpage(&eedata);
+   base = __builtin_tbloffset(&eedata);
+   for(pos=offset; pos<offset + len; pos+=WORD_LEN){
+      if(__builtin_tblrdl(base + pos) != pattern)
+         break;
+   }
+   STATS_XFER(STATS_API_OBEE_READ,pos - offset,t0);
+   return (pos < offset + len) ? pos : OBEE_NO_MISMATCH;
+}
+
+#ifdef __XC16__
+//NVM write/erase complete. Also raised in software to start an idle queue
+void __attribute__((interrupt,no_auto_psv)) _NVMInterrupt(void){
+    _NVMIF = 0;
+    obee_Service();
+}
+#endif
\ No newline at end of file
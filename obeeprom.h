@@ -21,10 +21,102 @@ extern "C" {
     
 #define WORD_LEN  2
 #define NUM_WORDS 256
+#define ERASE_ROW 8                                                             //Words per EE_ERASE_EIGHT block
     
 #define OFFSET_ZERO 0
 #define OFFSET_LAST 511
+
+#define OBEE_INT_PRI 3                                                          //NVM interrupt priority
+#define OBEE_NO_MISMATCH 0xFFFF                                                 //obee_Verify found every word matching
+
+//One piece of a gather read
+typedef struct{
+   uint16_t          offset;                                                    //Byte offset, even
+   uint16_t          len;                                                       //Bytes to read, even
+   uint16_t          *pDst;                                                     //Where the words go
+}obee_Seg_t;
+
+//Queued erase or write. Owned by the caller and must stay in scope,
+//along with any data buffer, until busy clears
+typedef struct obee_Op obee_Op_t;
+typedef void (*obee_Done_t)(obee_Op_t *);                                       //Completion callback; runs in the ISR
+
+struct obee_Op{
+   uint16_t          nvmOp;                                                     //EE_ERASE_xxx, EE_WRITE_ER or EE_WRITE_NOE
+   uint16_t          offset;                                                    //Byte offset of the first word
+   uint16_t          len;                                                       //Bytes to write
+   uint16_t          *pData;                                                    //Words to write; NULL for erases
+   uint8_t           repeat;                                                    //Non-zero: pData is one word written over len
+   obee_Done_t       pDone;                                                     //Optional; NULL to poll instead
+   volatile uint8_t  busy;                                                      //Non-zero until complete
+   uint8_t           failed;                                                    //Non-zero if a cycle ended with WRERR
+   obee_Op_t         *pNext;                                                    //Queue link
+#ifdef EE_STATS
+   uint32_t          t0;                                                        //Submit time, stats time base
+#endif
+};
   
+//-------------------------------------------------------
+// Input:   None
+// Returns: None
+// Summary: Sets the NVM interrupt priority and enables
+//          it. Without it, blocking calls run the queue
+//          themselves
+//-------------------------------------------------------
+void     obee_Init(void);
+
+//-------------------------------------------------------
+// Input:   None
+// Returns: None
+// Summary: Retires the finished NVM cycle and starts the
+//          next one. Called from the NVM ISR
+//-------------------------------------------------------
+void     obee_Service(void);
+
+//-------------------------------------------------------
+// Input:   Operation handle
+// Returns: ERR_NVM_WRITE if any of its cycles ended with
+//          WRERR set, otherwise ERR_NONE
+// Summary: Blocks until the operation completes
+//-------------------------------------------------------
+ee_Errors_t obee_Wait(obee_Op_t *);
+
+//-------------------------------------------------------
+// Input:   None
+// Returns: Non-zero while operations are queued
+// Summary: Reports whether the NVM queue is busy
+//-------------------------------------------------------
+uint8_t  obee_Busy(void);
+
+//-------------------------------------------------------
+// Input:   Operation handle, programming operation,
+//          address offset and optional callback
+// Returns: None
+// Summary: Queues an erase of 1, 4, 8 or all (bulk)
+//          words and returns at once
+//-------------------------------------------------------
+void     obee_EraseAsync(obee_Op_t *, uint16_t, uint16_t, obee_Done_t);
+
+//-------------------------------------------------------
+// Input:   Operation handle, write type, address offset,
+//          length of data in bytes, pointer to the words
+//          to write and optional callback
+// Returns: None
+// Summary: Queues a write of one or more words and
+//          returns at once
+//-------------------------------------------------------
+void     obee_WriteAsync(obee_Op_t *, uint16_t, uint16_t, uint16_t, uint16_t *, obee_Done_t);
+
+//-------------------------------------------------------
+// Input:   Operation handle, write type, address offset,
+//          length in bytes, pointer to one pattern word
+//          and optional callback
+// Returns: None
+// Summary: Queues a write of the pattern word to every
+//          word of the range and returns at once
+//-------------------------------------------------------
+void     obee_FillAsync(obee_Op_t *, uint16_t, uint16_t, uint16_t, uint16_t *, obee_Done_t);
+
 //-------------------------------------------------------
 // Input:   Programming operation and address offset 
 // Returns: None
@@ -36,7 +128,9 @@ void     obee_Erase(uint16_t, uint16_t);
 //-------------------------------------------------------
 // Input:   Address offset
 // Returns: One data word
-// Summary: Reads a single word from the EEPROM
+// Summary: Reads a single word from the EEPROM. Words
+//          with queued writes or erases are served from
+//          the queue
 //-------------------------------------------------------
 uint16_t obee_Read(uint16_t);
 
@@ -49,6 +143,16 @@ uint16_t obee_Read(uint16_t);
 //-------------------------------------------------------
 void     obee_ReadSeq(uint16_t,uint16_t,uint16_t *);
 
+//-------------------------------------------------------
+// Input:   Array of segments and the segment count
+// Returns: None
+// Summary: Gather read. Sets up the table page once and
+//          holds the NVM interrupt off once for all the
+//          segments, checking the queue only when it
+//          has pending operations
+//-------------------------------------------------------
+void     obee_ReadGather(obee_Seg_t *,uint8_t);
+
 //-------------------------------------------------------
 // Input:   Write Type, address offset and word to write 
 // Returns: None
@@ -64,6 +168,69 @@ void     obee_Write(uint16_t, uint16_t, uint16_t);
 // Summary:
 void     obee_WriteSeq(uint16_t,uint16_t,uint16_t,uint16_t *);
 
+//-------------------------------------------------------
+// Input:   Address offset, length of data in bytes and
+//          a pointer to the words to be written
+// Returns: ERR_NVM_WRITE if an erase failed
+// Summary: Erases only the words of the range that need
+//          a 0->1 bit change to take the new data, using
+//          aligned 8 and 4 word erases where two or more
+//          share a block. The words can then all be
+//          programmed with EE_WRITE_NOE
+//-------------------------------------------------------
+ee_Errors_t obee_ErasePlan(uint16_t,uint16_t,uint16_t *);
+
+//-------------------------------------------------------
+// Input:   Address offset, length of data in bytes and
+//          a pointer to the words to write
+// Returns: None
+// Summary: Bulk write with planned erases. Only words
+//          that need a 0->1 bit change are erased, using
+//          aligned 8 and 4 word erases where two or more
+//          such words share a block. Every word is then
+//          programmed with EE_WRITE_NOE
+//-------------------------------------------------------
+void     obee_WriteBulk(uint16_t,uint16_t,uint16_t *);
+
+//-------------------------------------------------------
+// Input:   Address offset, length of data in bytes and
+//          a pointer to the words to write
+// Returns: Number of words skipped
+// Summary: Differential write. Identical words are
+//          skipped, words that only need 1->0 bit
+//          changes use EE_WRITE_NOE and the rest
+//          EE_WRITE_ER
+//-------------------------------------------------------
+uint16_t obee_WriteDiff(uint16_t,uint16_t,uint16_t *);
+
+//-------------------------------------------------------
+// Input:   Address offset, length in bytes and the
+//          pattern word
+// Returns: None
+// Summary: Fills the range with the pattern. Only an
+//          offset of 0 with a length of exactly 512 is
+//          bulk erased; any other range, even one that
+//          covers nearly all of it, goes block by block
+//          and erases just the words needing a 0->1
+//          change, grouped into aligned 8 and 4 word
+//          erases. Words are then programmed with
+//          EE_WRITE_NOE in runs, skipping those that
+//          already match; a 0xFFFF pattern needs the
+//          erase alone
+//-------------------------------------------------------
+void     obee_Fill(uint16_t,uint16_t,uint16_t);
+
+//-------------------------------------------------------
+// Input:   Address offset, length in bytes and the
+//          pattern word
+// Returns: Offset of the first word that differs, or
+//          OBEE_NO_MISMATCH
+// Summary: Waits for queued operations, then compares
+//          the range against the pattern in one pass of
+//          table reads
+//-------------------------------------------------------
+uint16_t obee_Verify(uint16_t,uint16_t,uint16_t);
+
 
 #ifdef	__cplusplus
 }
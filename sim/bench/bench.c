@@ -0,0 +1,421 @@
+/*******************************************************************************
+ * Cycle accounting benchmark of the blocking lc01b_xxx, obee_xxx and mirror_xxx
+ * entry points on the host simulator
+ *
+ * Summary:
+ *  - FCY is 16MHz. The I2C1 model runs at I2C_BRG_100 and I2C_BRG_400 with
+ *    the simulator's bus timing (sim.h). 24xx write cycles take
+ *    LC01B_TWC_US, the datasheet maximum, and NVM cycles 4ms (TIWD)
+ *  - Each API runs BENCH_REPS times per payload size with MI2C1 and NVM
+ *    interrupts on, as main.c runs them. Set up writes (erasing NVM for
+ *    EE_WRITE_NOE, writing the data a read or diff expects) are not timed
+ *  - 24xx rows run on a 24LC01B (8 byte pages) and a 24LC512 (128 byte
+ *    pages). NVM only rows are run once and report bus_khz 0
+ *  - Output is JSON Lines on stdout: one "config" record, then one
+ *    "result" record per API, variant and size. Per call figures are
+ *    averages over the reps; worst_us is the slowest rep
+ *
+ * Result fields:
+ *   bytes_per_s   payload bytes over total time
+ *   bus_util      fraction of the time a bus event was in flight
+ *   write_cycles  24xx page write cycles per call
+ *   nvm_cycles    NVM erase and write cycles per call
+ *   nvm_erased    NVM words erased per call
+ *   cpu_accesses  main line register accesses per call; each busy-wait
+ *                 loop iteration costs at least one
+ *   isrs          MI2C1 and NVM interrupts taken per call
+ * *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eemirror.h"
+#include "sim.h"
+
+#define BENCH_REPS 4
+#define BENCH_PAT  4                                                            //Fill and verify pattern bytes
+
+typedef ee_Errors_t (*bench_Run_t)(uint16_t, uint16_t);
+typedef void (*bench_Prep_t)(uint16_t, uint16_t);
+
+//One benchmarked entry point. Sizes end at 0
+typedef struct{
+   const char    *api;
+   const char    *variant;
+   bench_Run_t   pRun;
+   bench_Prep_t  pPrep;                                                         //Untimed set up before each call; may be NULL
+   uint16_t      sizes[6];
+}bench_Api_t;
+
+//24xx part under test
+typedef struct{
+   const char    *name;
+   lc01b_Dev_t   desc;
+   uint16_t      pageSize;
+   uint32_t      size;
+}bench_Dev_t;
+
+static const bench_Dev_t bench_Devs[] = {
+   {"24LC01B", LC01B_DEV_24LC01B,    LC01B_PAGE, LC01B_CAP},
+   {"24LC512", LC01B_DEV_24LC512(0), 128,        65536UL}
+};
+static lc01b_Dev_t bench_Desc;
+static uint32_t bench_Size;                                                     //Capacity of the part under test
+static uint8_t bench_Out[LC01B_MAX_PAGE], bench_In[LC01B_MAX_PAGE];
+static uint16_t bench_Words[NUM_WORDS];
+static uint8_t bench_Pat[BENCH_PAT] = {0xA5,0x5A,0x0F,0xF0};
+static uint8_t bench_Rep;                                                       //Varies the data between reps
+
+//---------------------------------------------------------------
+//Boot the simulator and drivers with one part on the bus, or the
+//24LC01B alone for NULL
+//---------------------------------------------------------------
+static void bench_Boot(uint16_t brg, const bench_Dev_t *pDev){
+
+   uint8_t idx;
+
+   sim_Reset();
+   if(pDev && pDev->size != LC01B_CAP){
+      sim_Eeps[0].present = 0;
+      sim_Attach(0,pDev->pageSize,pDev->size,2,0,1);
+   }
+   for(idx=0; idx<SIM_MAX_EEPS; idx++)
+      sim_Eeps[idx].twcUs = LC01B_TWC_US;
+   if(pDev){
+      bench_Desc = pDev->desc;
+      bench_Size = pDev->size;
+   }
+   else{
+      bench_Desc = (lc01b_Dev_t)LC01B_DEV_24LC01B;
+      bench_Size = LC01B_CAP;
+   }
+   lc01b_SetDevice(&bench_Desc);
+   init_I2C(brg);
+   obee_Init();
+}
+
+//Payload for a call: differs between reps so diff writes see changes
+static void bench_Data(uint16_t len){
+
+   uint16_t idx;
+
+   for(idx=0; idx<len && idx<sizeof(bench_Out); idx++)
+      bench_Out[idx] = idx * 37 + bench_Rep;
+   for(idx=0; idx<len/WORD_LEN && idx<NUM_WORDS; idx++)
+      bench_Words[idx] = (idx * 0x0101) ^ (bench_Rep << 4);
+}
+
+//---------------------------------------------------------------
+//24xx entry points
+//---------------------------------------------------------------
+static ee_Errors_t bench_WriteByte(uint16_t addr, uint16_t len){ return lc01b_WriteByte(addr,bench_Out[0]); }
+static ee_Errors_t bench_WritePage(uint16_t addr, uint16_t len){ return lc01b_WritePage(addr,len,bench_Out); }
+static ee_Errors_t bench_Write(uint16_t addr, uint16_t len){ return lc01b_Write(addr,len,bench_Out); }
+static ee_Errors_t bench_WriteObject(uint16_t addr, uint16_t len){ return lc01b_WriteObject(addr,len,bench_Out); }
+static ee_Errors_t bench_WriteObjectCrc(uint16_t addr, uint16_t len){ return lc01b_WriteObjectCrc(addr,len - 2,bench_Out,LC01B_CRC16); }
+static ee_Errors_t bench_Fill(uint16_t addr, uint16_t len){ return lc01b_Fill(addr,len,bench_Pat,BENCH_PAT); }
+static ee_Errors_t bench_Verify(uint16_t addr, uint16_t len){ return lc01b_Verify(addr,len,bench_Pat,BENCH_PAT,0); }
+static ee_Errors_t bench_ReadByte(uint16_t addr, uint16_t len){ return lc01b_ReadByte(addr,bench_In); }
+static ee_Errors_t bench_ReadSeq(uint16_t addr, uint16_t len){ return lc01b_ReadSeq(addr,len,bench_In); }
+static ee_Errors_t bench_ReadCur(uint16_t addr, uint16_t len){ return lc01b_ReadCur(len,bench_In); }
+static ee_Errors_t bench_ReadStream(uint16_t addr, uint16_t len){ return lc01b_ReadStream(addr,len,bench_In); }
+static ee_Errors_t bench_ReadObject(uint16_t addr, uint16_t len){ return lc01b_ReadObject(addr,len,bench_In); }
+static ee_Errors_t bench_ReadObjectCrc(uint16_t addr, uint16_t len){ return lc01b_ReadObjectCrc(addr,len - 2,bench_In,LC01B_CRC16); }
+static ee_Errors_t bench_AckPoll(uint16_t addr, uint16_t len){ return ack_Poll(); }
+
+static ee_Errors_t bench_Idle(uint16_t addr, uint16_t len){
+
+   return lc01b_Idle() ? ERR_NONE : ERR_BUS_TIMEOUT;
+}
+
+//One byte changed since the set up write
+static ee_Errors_t bench_WriteDiff(uint16_t addr, uint16_t len){
+
+   bench_Out[len/2] ^= 0x80;
+   return lc01b_WriteDiff(addr,len,bench_Out,0);
+}
+
+//Four segments, highest address first
+static ee_Errors_t bench_ReadBatch(uint16_t addr, uint16_t len){
+
+   lc01b_Seg_t segs[4];
+   uint8_t idx;
+
+   for(idx=0; idx<4; idx++){
+      segs[idx].ee_addr = addr + (3 - idx) * (len/4);
+      segs[idx].len = len/4;
+      segs[idx].pDst = &bench_In[(3 - idx) * (len/4)];
+   }
+   return lc01b_ReadBatch(segs,4);
+}
+
+//Four updates collected and committed
+static ee_Errors_t bench_BatchCommit(uint16_t addr, uint16_t len){
+
+   lc01b_Seg_t segs[4];
+   lc01b_Batch_t batch;
+   uint8_t idx;
+   ee_Errors_t errCode = ERR_NONE;
+
+   lc01b_BatchInit(&batch,segs,4);
+   for(idx=0; idx<4 && errCode == ERR_NONE; idx++)
+      errCode = lc01b_BatchAdd(&batch,addr + idx * (len/4),len/4,&bench_Out[idx * (len/4)]);
+   if(errCode == ERR_NONE)
+      errCode = lc01b_BatchCommit(&batch);
+   return errCode;
+}
+
+static ee_Errors_t bench_Calibrate(uint16_t addr, uint16_t len){
+
+   uint16_t brg;
+
+   return lc01b_Calibrate(addr,&brg);
+}
+
+//Set up: the data the call reads back or compares against
+static void bench_PrepData(uint16_t addr, uint16_t len){ lc01b_Write(addr,len,bench_Out); }
+static void bench_PrepFill(uint16_t addr, uint16_t len){ lc01b_Fill(addr,len,bench_Pat,BENCH_PAT); }
+static void bench_PrepCrc(uint16_t addr, uint16_t len){ lc01b_WriteObjectCrc(addr,len - 2,bench_Out,LC01B_CRC16); }
+
+//Set up: device pointer at addr, as a stream of records leaves it
+static void bench_PrepPtr(uint16_t addr, uint16_t len){
+
+   if(addr)
+      lc01b_ReadSeq(addr - 1,1,bench_In);
+   else
+      lc01b_ReadSeq(bench_Size - 1,1,bench_In);
+}
+
+//lc01b_Calibrate goes last; it leaves the bus at the speed it picked
+static const bench_Api_t bench_Lc01b[] = {
+   {"lc01b_WriteByte",      "",          bench_WriteByte,      0,              {1}},
+   {"lc01b_WritePage",      "",          bench_WritePage,      0,              {4,8,64,128}},
+   {"lc01b_Write",          "",          bench_Write,          0,              {4,8,64,128}},
+   {"lc01b_WriteObject",    "",          bench_WriteObject,    0,              {4,8,64,128}},
+   {"lc01b_WriteObjectCrc", "CRC16",     bench_WriteObjectCrc, 0,              {4,8,64,128}},
+   {"lc01b_WriteDiff",      "1_changed", bench_WriteDiff,      bench_PrepData, {4,8,64,128}},
+   {"lc01b_Fill",           "",          bench_Fill,           0,              {4,8,64,128}},
+   {"lc01b_Verify",         "",          bench_Verify,         bench_PrepFill, {4,8,64,128}},
+   {"lc01b_ReadByte",       "",          bench_ReadByte,       0,              {1}},
+   {"lc01b_ReadSeq",        "",          bench_ReadSeq,        0,              {4,8,64,128}},
+   {"lc01b_ReadCur",        "",          bench_ReadCur,        bench_PrepPtr,  {4,8,64,128}},
+   {"lc01b_ReadStream",     "",          bench_ReadStream,     bench_PrepPtr,  {4,8,64,128}},
+   {"lc01b_ReadObject",     "",          bench_ReadObject,     0,              {4,8,64,128}},
+   {"lc01b_ReadObjectCrc",  "CRC16",     bench_ReadObjectCrc,  bench_PrepCrc,  {4,8,64,128}},
+   {"lc01b_ReadBatch",      "4_segs",    bench_ReadBatch,      0,              {4,8,64,128}},
+   {"lc01b_BatchCommit",    "4_updates", bench_BatchCommit,    0,              {4,8,64,128}},
+   {"ack_Poll",             "",          bench_AckPoll,        0,              {0}},
+   {"lc01b_Idle",           "",          bench_Idle,           0,              {0}},
+   {"lc01b_Calibrate",      "",          bench_Calibrate,      0,              {LC01B_CAL_LEN}}
+};
+
+//---------------------------------------------------------------
+//On-board EEPROM entry points. Lengths are in bytes
+//---------------------------------------------------------------
+static ee_Errors_t bench_ObeeWriteEr(uint16_t off, uint16_t len){ obee_Write(EE_WRITE_ER,off,bench_Words[0]); return ERR_NONE; }
+static ee_Errors_t bench_ObeeWriteNoe(uint16_t off, uint16_t len){ obee_Write(EE_WRITE_NOE,off,bench_Words[0]); return ERR_NONE; }
+static ee_Errors_t bench_ObeeWriteSeqEr(uint16_t off, uint16_t len){ obee_WriteSeq(EE_WRITE_ER,off,len,bench_Words); return ERR_NONE; }
+static ee_Errors_t bench_ObeeWriteSeqNoe(uint16_t off, uint16_t len){ obee_WriteSeq(EE_WRITE_NOE,off,len,bench_Words); return ERR_NONE; }
+static ee_Errors_t bench_ObeeWriteBulk(uint16_t off, uint16_t len){ obee_WriteBulk(off,len,bench_Words); return ERR_NONE; }
+static ee_Errors_t bench_ObeeWriteDiff(uint16_t off, uint16_t len){ obee_WriteDiff(off,len,bench_Words); return ERR_NONE; }
+static ee_Errors_t bench_ObeeFill(uint16_t off, uint16_t len){ obee_Fill(off,len,0xA5A5); return ERR_NONE; }
+static ee_Errors_t bench_ObeeReadSeq(uint16_t off, uint16_t len){ obee_ReadSeq(off,len,bench_Words); return ERR_NONE; }
+static ee_Errors_t bench_ObeeEraseOne(uint16_t off, uint16_t len){ obee_Erase(EE_ERASE_ONE,off); return ERR_NONE; }
+static ee_Errors_t bench_ObeeEraseFour(uint16_t off, uint16_t len){ obee_Erase(EE_ERASE_FOUR,off); return ERR_NONE; }
+static ee_Errors_t bench_ObeeEraseEight(uint16_t off, uint16_t len){ obee_Erase(EE_ERASE_EIGHT,off); return ERR_NONE; }
+static ee_Errors_t bench_ObeeEraseBulk(uint16_t off, uint16_t len){ obee_Erase(EE_ERASE_BULK,off); return ERR_NONE; }
+
+static ee_Errors_t bench_ObeeRead(uint16_t off, uint16_t len){
+
+   bench_Words[0] = obee_Read(off);
+   return ERR_NONE;
+}
+
+static ee_Errors_t bench_ObeeVerify(uint16_t off, uint16_t len){
+
+   return (obee_Verify(off,len,0xA5A5) == OBEE_NO_MISMATCH) ? ERR_NONE : ERR_VERIFY;
+}
+
+//Two segments, second half first
+static ee_Errors_t bench_ObeeReadGather(uint16_t off, uint16_t len){
+
+   obee_Seg_t segs[2] = {{off + len/2,len/2,&bench_Words[len/4]},{off,len/2,bench_Words}};
+
+   obee_ReadGather(segs,2);
+   return ERR_NONE;
+}
+
+//Set up: erased for programming alone, or zeros so every 0->1 bit
+//needs an erase
+static void bench_PrepErased(uint16_t off, uint16_t len){ obee_Fill(off,len,0xFFFF); }
+static void bench_PrepZeros(uint16_t off, uint16_t len){ obee_Fill(off,len,0x0000); }
+static void bench_PrepPattern(uint16_t off, uint16_t len){ obee_Fill(off,len,0xA5A5); }
+
+static const bench_Api_t bench_Obee[] = {
+   {"obee_Write",           "EE_WRITE_ER",    bench_ObeeWriteEr,     0,                 {WORD_LEN}},
+   {"obee_Write",           "EE_WRITE_NOE",   bench_ObeeWriteNoe,    bench_PrepErased,  {WORD_LEN}},
+   {"obee_WriteSeq",        "EE_WRITE_ER",    bench_ObeeWriteSeqEr,  0,                 {4,8,64,128}},
+   {"obee_WriteSeq",        "EE_WRITE_NOE",   bench_ObeeWriteSeqNoe, bench_PrepErased,  {4,8,64,128}},
+   {"obee_WriteBulk",       "over_zeros",     bench_ObeeWriteBulk,   bench_PrepZeros,   {4,8,64,128}},
+   {"obee_WriteDiff",       "over_zeros",     bench_ObeeWriteDiff,   bench_PrepZeros,   {4,8,64,128}},
+   {"obee_Fill",            "over_zeros",     bench_ObeeFill,        bench_PrepZeros,   {4,8,64,128}},
+   {"obee_Verify",          "",               bench_ObeeVerify,      bench_PrepPattern, {4,8,64,128}},
+   {"obee_Read",            "",               bench_ObeeRead,        0,                 {WORD_LEN}},
+   {"obee_ReadSeq",         "",               bench_ObeeReadSeq,     0,                 {4,8,64,128}},
+   {"obee_ReadGather",      "2_segs",         bench_ObeeReadGather,  0,                 {4,8,64,128}},
+   {"obee_Erase",           "EE_ERASE_ONE",   bench_ObeeEraseOne,    0,                 {WORD_LEN}},
+   {"obee_Erase",           "EE_ERASE_FOUR",  bench_ObeeEraseFour,   0,                 {4*WORD_LEN}},
+   {"obee_Erase",           "EE_ERASE_EIGHT", bench_ObeeEraseEight,  0,                 {8*WORD_LEN}},
+   {"obee_Erase",           "EE_ERASE_BULK",  bench_ObeeEraseBulk,   0,                 {OFFSET_LAST + 1}}
+};
+
+//---------------------------------------------------------------
+//Copies between the 24LC01B and the on-board EEPROM
+//---------------------------------------------------------------
+static ee_Errors_t bench_ToNvm(uint16_t off, uint16_t len){ return mirror_Lc01bToNvm(0,off,len); }
+static ee_Errors_t bench_ToLc01b(uint16_t off, uint16_t len){ return mirror_NvmToLc01b(off,0,len); }
+
+static const bench_Api_t bench_Mirror[] = {
+   {"mirror_Lc01bToNvm",    "main.c_blank", bench_ToNvm,   bench_PrepErased, {LC01B_CAP}},
+   {"mirror_Lc01bToNvm",    "over_zeros",   bench_ToNvm,   bench_PrepZeros,  {LC01B_CAP}},
+   {"mirror_NvmToLc01b",    "",             bench_ToLc01b, 0,                {LC01B_CAP}}
+};
+
+//Names of the error codes in the output
+static const char *bench_ErrName(ee_Errors_t errCode){
+
+   static const char *names[] = {
+      "ERR_MEM_BOUNDS","ERR_CNTL_NACK","ERR_MEM_NACK","ERR_PAGE_NACK","ERR_PAGE_BOUNDS",
+      "ERR_NO_KEY","ERR_KEYS_FULL","ERR_BUS_TIMEOUT","ERR_BUS_COLLISION","ERR_CRC",
+      "ERR_BATCH_FULL","ERR_VERIFY"
+   };
+
+   if(errCode == ERR_NONE)
+      return "ERR_NONE";
+   if(errCode >= ERR_MEM_BOUNDS && errCode <= ERR_VERIFY)
+      return names[errCode - ERR_MEM_BOUNDS];
+   return "ERR_UNKNOWN";
+}
+
+//Page write cycles started on every part
+static uint32_t bench_WriteCycles(void){
+
+   uint32_t count = 0;
+   uint8_t idx;
+
+   for(idx=0; idx<SIM_MAX_EEPS; idx++)
+      count += sim_Eeps[idx].writeCycles;
+   return count;
+}
+
+//NVM cycles run and words erased
+static uint32_t bench_NvmCycles(uint32_t *pErased){
+
+   uint32_t count = 0;
+   uint16_t idx;
+
+   *pErased = 0;
+   for(idx=0; idx<SIM_NVM_KINDS; idx++)
+      count += sim_Nvm.cycles[idx];
+   for(idx=0; idx<SIM_NVM_WORDS; idx++)
+      *pErased += sim_Nvm.wear[idx];
+   return count;
+}
+
+//---------------------------------------------------------------
+//Run one entry point BENCH_REPS times at one size and print its
+//result record
+//---------------------------------------------------------------
+static void bench_Measure(uint16_t busKhz, const char *device, uint32_t space, const bench_Api_t *pApi, uint16_t len){
+
+   uint64_t t0, bus0, acc0, cycles = 0, busy = 0, accesses = 0, worst = 0;
+   uint32_t wc0, nvm0, erased0, isr0, erased, writeCycles = 0, nvmCycles = 0, nvmErased = 0, isrs = 0;
+   uint16_t addr;
+   ee_Errors_t errCode, status = ERR_NONE;
+
+   for(bench_Rep=0; bench_Rep<BENCH_REPS; bench_Rep++){
+      addr = (len && len <= space) ? (bench_Rep * len) % space : 0;
+      bench_Data(len);
+      if(pApi->pPrep)
+         pApi->pPrep(addr,len);
+
+      t0 = sim_Now();
+      bus0 = sim_Bus.busyCycles;
+      acc0 = sim_Cpu.accesses[0];
+      wc0 = bench_WriteCycles();
+      nvm0 = bench_NvmCycles(&erased0);
+      isr0 = sim_Cpu.isrs[0] + sim_Cpu.isrs[1];
+
+      errCode = pApi->pRun(addr,len);
+
+      t0 = sim_Now() - t0;
+      cycles += t0;
+      if(t0 > worst)
+         worst = t0;
+      busy += sim_Bus.busyCycles - bus0;
+      accesses += sim_Cpu.accesses[0] - acc0;
+      writeCycles += bench_WriteCycles() - wc0;
+      nvmCycles += bench_NvmCycles(&erased) - nvm0;
+      nvmErased += erased - erased0;
+      isrs += sim_Cpu.isrs[0] + sim_Cpu.isrs[1] - isr0;
+      if(status == ERR_NONE)
+         status = errCode;
+
+      //Anything still queued finishes outside the timed call
+      while(obee_Busy() || lc01b_Busy())
+         sim_Run(100);
+   }
+
+   printf("{\"type\":\"result\",\"bus_khz\":%u,\"device\":\"%s\",\"api\":\"%s\",\"variant\":\"%s\","
+          "\"bytes\":%u,\"status\":\"%s\",\"calls\":%u,\"us_per_call\":%.1f,\"worst_us\":%.1f,"
+          "\"bytes_per_s\":%.0f,\"bus_util\":%.3f,\"write_cycles\":%.2f,\"nvm_cycles\":%.2f,"
+          "\"nvm_erased\":%.2f,\"cpu_accesses\":%.0f,\"isrs\":%.1f}\n",
+          busKhz,device,pApi->api,pApi->variant,len,bench_ErrName(status),BENCH_REPS,
+          (double)cycles / BENCH_REPS * 1e6 / FCY,(double)worst * 1e6 / FCY,
+          cycles ? (double)len * BENCH_REPS * FCY / cycles : 0.0,
+          cycles ? (double)busy / cycles : 0.0,
+          (double)writeCycles / BENCH_REPS,(double)nvmCycles / BENCH_REPS,(double)nvmErased / BENCH_REPS,
+          (double)accesses / BENCH_REPS,(double)isrs / BENCH_REPS);
+}
+
+//Every size of every entry point in a table
+static void bench_Table(uint16_t busKhz, const char *device, uint32_t space, const bench_Api_t *pApis, uint8_t count){
+
+   uint8_t idx, size;
+
+   for(idx=0; idx<count; idx++){
+      size = 0;
+      do{
+         bench_Measure(busKhz,device,space,&pApis[idx],pApis[idx].sizes[size]);
+      }while(pApis[idx].sizes[++size]);
+   }
+}
+
+int main(void){
+
+   static const struct{ uint16_t khz, brg; } buses[] = {{100,I2C_BRG_100},{400,I2C_BRG_400}};
+   uint8_t bus, dev;
+
+   printf("{\"type\":\"config\",\"fcy\":%lu,\"reps\":%u,\"twc_us\":%lu,\"nvm_us\":%lu,"
+          "\"access_cycles\":%u,\"isr_cycles\":%u,\"brg_100\":%u,\"brg_400\":%u}\n",
+          FCY,BENCH_REPS,LC01B_TWC_US,(unsigned long)4000,SIM_ACCESS_CYCLES,SIM_ISR_CYCLES,
+          (unsigned)I2C_BRG_100,(unsigned)I2C_BRG_400);
+
+   for(bus=0; bus<sizeof(buses)/sizeof(buses[0]); bus++){
+      for(dev=0; dev<sizeof(bench_Devs)/sizeof(bench_Devs[0]); dev++){
+         bench_Boot(buses[bus].brg,&bench_Devs[dev]);
+         bench_Table(buses[bus].khz,bench_Devs[dev].name,bench_Devs[dev].size,bench_Lc01b,sizeof(bench_Lc01b)/sizeof(bench_Lc01b[0]));
+      }
+      bench_Boot(buses[bus].brg,0);
+      bench_Table(buses[bus].khz,"24LC01B+NVM",LC01B_CAP,bench_Mirror,sizeof(bench_Mirror)/sizeof(bench_Mirror[0]));
+   }
+
+   bench_Boot(I2C_BRG_400,0);
+   bench_Table(0,"NVM",OFFSET_LAST + 1,bench_Obee,sizeof(bench_Obee)/sizeof(bench_Obee[0]));
+
+   if(sim_Errors)
+      fprintf(stderr,"bench: %u model errors\n",(unsigned)sim_Errors);
+   return sim_Errors != 0;
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * Compression benchmark of eepack.c: a 128 byte 24LC01B log filled with
+ * pack_Put from a set of sample signals, against the same samples stored
+ * raw, two bytes each
+ *
+ * Summary:
+ *  - lc01b_WritePage and lc01b_ReadStream are stubs over a RAM image of the
+ *    part; each page write is one write cycle of LC01B_TWC_US. No simulator
+ *    or drivers are linked
+ *  - Each signal is packed until pack_Put reports the log full, then read
+ *    back with pack_Read and compared
+ *  - Output is JSON Lines on stdout: one "config" record, then one
+ *    "result" record per signal
+ *
+ * Result fields:
+ *   samples           samples packed into the log
+ *   raw_samples       samples the log holds stored raw
+ *   ratio             raw bytes for the samples over log bytes used
+ *   write_cycles      page writes to pack them, one per frame
+ *   raw_write_cycles  page writes to store the same samples raw
+ *   cycles_saved      raw_write_cycles - write_cycles
+ *   twc_ms_saved      write cycle time saved at LC01B_TWC_US
+ *   round_trip        "ok" when pack_Read gave back every sample
+ * *****************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "eepack.h"
+
+#define BENCH_LOG LC01B_CAP
+#define BENCH_MAX (BENCH_LOG - BENCH_LOG / PACK_FRAME)                          //One sample per byte bar the headers
+
+typedef void (*bench_Gen_t)(int16_t *, uint16_t);
+
+//One sample signal
+typedef struct{
+   const char    *name;
+   bench_Gen_t   pGen;
+}bench_Signal_t;
+
+//Stub device
+static lc01b_Dev_t bench_Dev = LC01B_DEV_24LC01B;
+static uint8_t bench_Mem[BENCH_LOG];
+static uint16_t bench_Writes;
+static uint32_t bench_Seed;
+
+lc01b_Dev_t *lc01b_GetDevice(void){
+
+   return &bench_Dev;
+}
+
+ee_Errors_t lc01b_WritePage(uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf){
+
+   memcpy(&bench_Mem[ee_addr],pDataBuf,dataLen);
+   bench_Writes++;
+   return ERR_NONE;
+}
+
+ee_Errors_t lc01b_ReadStream(uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf){
+
+   memcpy(pDataBuf,&bench_Mem[ee_addr],readLen);
+   return ERR_NONE;
+}
+
+//Repeatable pseudo random numbers
+static uint16_t bench_Rand(void){
+
+   bench_Seed = bench_Seed * 1103515245UL + 12345;
+   return bench_Seed >> 16;
+}
+
+//Counts up by one
+static void bench_Ramp(int16_t *pOut, uint16_t count){
+
+   uint16_t idx;
+
+   for(idx=0; idx<count; idx++)
+      pOut[idx] = 1000 + idx;
+}
+
+//Slow sine of +/-2000 over about 400 samples, by rotation so no libm
+static void bench_Sine(int16_t *pOut, uint16_t count){
+
+   int32_t x = 2000, y = 0;
+   uint16_t idx;
+
+   for(idx=0; idx<count; idx++){
+      x -= y >> 6;
+      y += x >> 6;
+      pOut[idx] = 1500 + y;
+   }
+}
+
+//Steady reading with +/-1 jitter
+static void bench_Jitter(int16_t *pOut, uint16_t count){
+
+   uint16_t idx;
+
+   for(idx=0; idx<count; idx++)
+      pOut[idx] = 2048 + (int16_t)(bench_Rand() % 3) - 1;
+}
+
+//Random walk of up to +/-100 a step; about half the steps take two bytes
+static void bench_Walk(int16_t *pOut, uint16_t count){
+
+   int16_t value = 0;
+   uint16_t idx;
+
+   for(idx=0; idx<count; idx++){
+      value += (int16_t)(bench_Rand() % 201) - 100;
+      pOut[idx] = value;
+   }
+}
+
+//Full range noise; the worst case
+static void bench_Noise(int16_t *pOut, uint16_t count){
+
+   uint16_t idx;
+
+   for(idx=0; idx<count; idx++)
+      pOut[idx] = (int16_t)bench_Rand();
+}
+
+static const bench_Signal_t bench_Signals[] = {
+   {"ramp",   bench_Ramp},
+   {"sine",   bench_Sine},
+   {"jitter", bench_Jitter},
+   {"walk",   bench_Walk},
+   {"noise",  bench_Noise},
+};
+
+//Fill the log with one signal and print its record. Returns non-zero
+//if it did not read back
+static int bench_Run(const bench_Signal_t *pSig){
+
+   int16_t samples[BENCH_MAX], out[BENCH_MAX];
+   uint16_t count = 0, readCount = 0, used, rawWrites;
+   pack_Enc_t enc;
+   int ok;
+
+   bench_Seed = 1;
+   pSig->pGen(samples,BENCH_MAX);
+   memset(bench_Mem,PACK_BLANK,sizeof(bench_Mem));
+   bench_Writes = 0;
+
+   pack_EncInit(&enc,0,BENCH_LOG);
+   while(count < BENCH_MAX && pack_Put(&enc,samples[count]) == ERR_NONE)
+      count++;
+   pack_Flush(&enc);                                                            //Nothing to write if the log filled
+   used = (enc.ee_addr - enc.base) + (enc.fill ? PACK_FRAME : 0);
+
+   pack_Read(0,BENCH_LOG,out,BENCH_MAX,&readCount);
+   ok = readCount == count && memcmp(out,samples,count * sizeof(int16_t)) == 0;
+   rawWrites = (count * sizeof(int16_t) + LC01B_PAGE - 1) / LC01B_PAGE;
+
+   printf("{\"type\":\"result\",\"signal\":\"%s\",\"samples\":%u,\"raw_samples\":%u,"
+          "\"ratio\":%.2f,\"write_cycles\":%u,\"raw_write_cycles\":%u,\"cycles_saved\":%d,"
+          "\"twc_ms_saved\":%.1f,\"round_trip\":\"%s\"}\n",
+          pSig->name,count,(unsigned)(BENCH_LOG / sizeof(int16_t)),
+          (double)(count * sizeof(int16_t)) / used,bench_Writes,rawWrites,
+          (int)rawWrites - (int)bench_Writes,
+          ((int)rawWrites - (int)bench_Writes) * (LC01B_TWC_US / 1000.0),ok ? "ok" : "mismatch");
+   return !ok;
+}
+
+int main(void){
+
+   unsigned idx;
+   int fails = 0;
+
+   printf("{\"type\":\"config\",\"log_bytes\":%u,\"frame\":%u,\"key_frames\":%u,\"twc_us\":%lu}\n",
+          BENCH_LOG,PACK_FRAME,PACK_KEY_FRAMES,LC01B_TWC_US);
+   for(idx=0; idx<sizeof(bench_Signals)/sizeof(bench_Signals[0]); idx++)
+      fails += bench_Run(&bench_Signals[idx]);
+   if(fails)
+      fprintf(stderr,"bench_pack: %d signals did not round trip\n",fails);
+   return fails != 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * File:   libpic30.h
+ *
+ * Host stand-in for the XC16 delay macros. Delays advance the simulated
+ * clock by the same number of instruction cycles as on the part
+ */
+
+#ifndef SIM_LIBPIC30_H
+#define	SIM_LIBPIC30_H
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+void sim_Delay(uint32_t);
+
+#define __delay_us(d) sim_Delay((uint32_t)((d) * (FCY / 1000000UL)))
+#define __delay_ms(d) sim_Delay((uint32_t)((d) * (FCY / 1000UL)))
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SIM_LIBPIC30_H */
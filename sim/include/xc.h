@@ -0,0 +1,132 @@
+/*
+ * File:   xc.h
+ *
+ * Host stand-in for the XC16 device header. Declares the PIC24F16KA102
+ * registers the drivers touch. Each register access goes through a
+ * sim_xxx() call that advances the simulated clock, steps the I2C1 and
+ * NVM models and delivers pending interrupts, so driver code built
+ * against this header runs unchanged on the host
+ */
+
+#ifndef SIM_XC_H
+#define	SIM_XC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+//I2C1 control register
+typedef union{
+   uint16_t w;
+   struct{
+      unsigned SEN:1, RSEN:1, PEN:1, RCEN:1, ACKEN:1, ACKDT:1, STREN:1, GCEN:1;
+      unsigned SMEN:1, DISSLW:1, A10M:1, IPMIEN:1, SCLREL:1, I2CSIDL:1, :1, I2CEN:1;
+   }b;
+}sim_I2C1CON_t;
+
+//I2C1 status register
+typedef union{
+   uint16_t w;
+   struct{
+      unsigned TBF:1, RBF:1, R_W:1, S:1, P:1, D_A:1, I2COV:1, IWCOL:1;
+      unsigned ADD10:1, GCSTAT:1, BCL:1, :3, TRSTAT:1, ACKSTAT:1;
+   }b;
+}sim_I2C1STAT_t;
+
+//NVM control register
+typedef union{
+   uint16_t w;
+   struct{
+      unsigned NVMOP:6, ERASE:1, :5, PGMONLY:1, WRERR:1, WREN:1, WR:1;
+   }b;
+}sim_NVMCON_t;
+
+//Timer2 control register
+typedef union{
+   uint16_t w;
+   struct{
+      unsigned :1, TCS:1, :1, T32:1, TCKPS:2, TGATE:1, :6, TSIDL:1, :1, TON:1;
+   }b;
+}sim_T2CON_t;
+
+//Interrupt flag, enable and priority bits the drivers use
+typedef struct{ unsigned SI2C1IF:1, MI2C1IF:1; }sim_IFS1_t;
+typedef struct{ unsigned SI2C1IE:1, MI2C1IE:1; }sim_IEC1_t;
+typedef struct{ unsigned SI2C1IP:3, :1, MI2C1IP:3; }sim_IPC4_t;
+
+//PORTB pins: RB8 = SCL1, RB9 = SDA1, RB15 = LED
+typedef struct{ unsigned :8, TRISB8:1, TRISB9:1, :5, TRISB15:1; }sim_TRISB_t;
+typedef struct{ unsigned :8, LATB8:1, LATB9:1, :5, LATB15:1; }sim_LATB_t;
+
+//Register access. Every call is one simulated bus access
+volatile uint16_t *sim_I2C1CONw(void);
+volatile sim_I2C1CON_t *sim_I2C1CON(void);
+volatile sim_I2C1STAT_t *sim_I2C1STAT(void);
+volatile uint16_t *sim_I2C1BRG(void);
+volatile uint16_t *sim_I2C1TRN(void);
+volatile uint16_t *sim_I2C1RCV(void);
+volatile sim_IFS1_t *sim_IFS1(void);
+volatile sim_IEC1_t *sim_IEC1(void);
+volatile sim_IPC4_t *sim_IPC4(void);
+volatile uint16_t *sim_NVMCONw(void);
+volatile sim_NVMCON_t *sim_NVMCON(void);
+volatile unsigned *sim_NVMIF(void);
+volatile unsigned *sim_NVMIE(void);
+volatile unsigned *sim_NVMIP(void);
+volatile uint16_t *sim_T2CONw(void);
+volatile sim_T2CON_t *sim_T2CON(void);
+volatile uint16_t *sim_TMR2(void);
+volatile uint16_t *sim_TMR3HLD(void);
+volatile uint16_t *sim_PR2(void);
+volatile uint16_t *sim_PR3(void);
+volatile sim_TRISB_t *sim_TRISB(void);
+volatile sim_LATB_t *sim_LATB(void);
+
+#define I2C1CON      (*sim_I2C1CONw())
+#define I2C1CONbits  (sim_I2C1CON()->b)
+#define I2C1STATbits (sim_I2C1STAT()->b)
+#define I2C1BRG      (*sim_I2C1BRG())
+#define I2C1TRN      (*sim_I2C1TRN())
+#define I2C1RCV      (*sim_I2C1RCV())
+#define IFS1bits     (*sim_IFS1())
+#define IEC1bits     (*sim_IEC1())
+#define IPC4bits     (*sim_IPC4())
+#define NVMCON       (*sim_NVMCONw())
+#define NVMCONbits   (sim_NVMCON()->b)
+#define _NVMIF       (*sim_NVMIF())
+#define _NVMIE       (*sim_NVMIE())
+#define _NVMIP       (*sim_NVMIP())
+#define T2CON        (*sim_T2CONw())
+#define T2CONbits    (sim_T2CON()->b)
+#define TMR2         (*sim_TMR2())
+#define TMR3HLD      (*sim_TMR3HLD())
+#define PR2          (*sim_PR2())
+#define PR3          (*sim_PR3())
+#define TRISBbits    (*sim_TRISB())
+#define LATBbits     (*sim_LATB())
+
+extern uint16_t TBLPAG;
+
+//Table access to the data EEPROM at 0x7FFE00
+#define __builtin_tblpage(p)   0x7F
+#define __builtin_tbloffset(p) 0xFE00
+uint16_t sim_TblRdl(uint16_t);
+void sim_TblWtl(uint16_t,uint16_t);
+void sim_WriteNvm(void);
+#define __builtin_tblrdl(offset)      sim_TblRdl(offset)
+#define __builtin_tblwtl(offset,data) sim_TblWtl(offset,data)
+#define __builtin_write_NVM()         sim_WriteNvm()
+
+//Attributes and inline assembly with no host meaning
+#define space(x)    unused
+#define asm
+#define volatile(x)
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SIM_XC_H */
@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * Host simulator core: clock, interrupt controller and Timer2/3
+ *
+ * Summary:
+ *  - Every register access from the drivers lands in sim_Access(), which
+ *    charges SIM_ACCESS_CYCLES, steps the I2C1 and NVM models and takes
+ *    any enabled interrupt that is pending
+ *  - Interrupts nest by priority like the PIC24 CPU: the MI2C1 handler
+ *    (IPC4) can preempt the NVM handler (IPC3) but not the other way
+ *    round. The handlers are the driver's own lc01b_Service and
+ *    obee_Service, which the XC16 ISRs call on the part
+ *  - Timer2 runs 16-bit or, with T32, as the T2/T3 pair with TMR3HLD
+ *    latched on a TMR2 read
+ * *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "sim.h"
+
+sim_Cpu_t sim_Cpu;
+uint32_t sim_Errors;
+
+static uint64_t sim_Clock;
+static uint8_t sim_Ipl = 0;                                                     //Running CPU priority; 0 is the main line
+
+//Interrupt controller
+static sim_IFS1_t sim_Ifs1;
+static sim_IEC1_t sim_Iec1;
+static sim_IPC4_t sim_Ipc4;
+static unsigned sim_NvmIf, sim_NvmIe, sim_NvmIp;
+
+//Timer2/3
+static sim_T2CON_t sim_T2con;
+static uint16_t sim_Tmr2, sim_Tmr3Hld, sim_Pr2 = 0xFFFF, sim_Pr3 = 0xFFFF;
+static uint16_t sim_Tmr2Shown, sim_Tmr3Shown;                                   //Last values handed out; a change is a write
+static uint32_t sim_TmrBase;                                                    //Count at sim_TmrStart
+static uint64_t sim_TmrStart;
+static uint8_t sim_TmrOn = 0;
+
+//Report a protocol violation seen by a model
+void sim_Error(const char *pFmt,...){
+
+   va_list args;
+
+   sim_Errors++;
+   fprintf(stderr,"sim @%llu: ",(unsigned long long)sim_Clock);
+   va_start(args,pFmt);
+   vfprintf(stderr,pFmt,args);
+   va_end(args);
+   fputc('\n',stderr);
+}
+
+//Timer count from the clock
+static uint32_t sim_TmrCount(void){
+
+   static const uint16_t prescale[4] = {1,8,64,256};
+   uint64_t count = sim_TmrBase;
+   uint64_t period = sim_T2con.b.T32 ? (((uint64_t)sim_Pr3 << 16) | sim_Pr2) + 1 : (uint64_t)sim_Pr2 + 1;
+
+   if(sim_TmrOn)
+      count += (sim_Clock - sim_TmrStart) / prescale[sim_T2con.b.TCKPS];
+   return count % period;
+}
+
+//Follow TON and writes to TMR2
+static void sim_TmrStep(void){
+
+   if(sim_Tmr2 != sim_Tmr2Shown){                                               //Written since the last access
+      sim_TmrBase = sim_T2con.b.T32 ? ((uint32_t)sim_Tmr3Hld << 16) | sim_Tmr2 : sim_Tmr2;
+      sim_TmrStart = sim_Clock;
+      sim_Tmr2Shown = sim_Tmr2;
+      sim_Tmr3Shown = sim_Tmr3Hld;
+   }
+   if(sim_T2con.b.TON != sim_TmrOn){
+      sim_TmrBase = sim_TmrCount();
+      sim_TmrStart = sim_Clock;
+      sim_TmrOn = sim_T2con.b.TON;
+   }
+}
+
+//Take the highest priority pending interrupt above the running priority,
+//until none is left
+static void sim_Interrupts(void){
+
+   uint8_t saved, i2cPri, nvmPri;
+
+   for(;;){
+      i2cPri = (sim_Ifs1.MI2C1IF && sim_Iec1.MI2C1IE) ? sim_Ipc4.MI2C1IP : 0;
+      nvmPri = (sim_NvmIf && sim_NvmIe) ? sim_NvmIp : 0;
+      if(i2cPri <= sim_Ipl && nvmPri <= sim_Ipl)
+         return;
+
+      saved = sim_Ipl;
+      sim_Clock += SIM_ISR_CYCLES;
+      if(i2cPri >= nvmPri){
+         sim_Ipl = i2cPri;
+         sim_Cpu.isrs[0]++;
+         sim_Ifs1.MI2C1IF = 0;                                                  //As _MI2C1Interrupt
+         lc01b_Service();
+      }
+      else{
+         sim_Ipl = nvmPri;
+         sim_Cpu.isrs[1]++;
+         sim_NvmIf = 0;                                                         //As _NVMInterrupt
+         obee_Service();
+      }
+      sim_Ipl = saved;
+   }
+}
+
+//One register access
+void sim_Access(void){
+
+   sim_Clock += SIM_ACCESS_CYCLES;
+   sim_Cpu.accesses[sim_Ipl != 0]++;
+   sim_TmrStep();
+   sim_I2cStep();
+   sim_NvmStep();
+   sim_Interrupts();
+}
+
+//Interrupt flags the models raise
+void sim_RaiseI2c(void){
+
+   sim_Ifs1.MI2C1IF = 1;
+}
+
+void sim_RaiseNvm(void){
+
+   sim_NvmIf = 1;
+}
+
+uint64_t sim_Now(void){
+
+   return sim_Clock;
+}
+
+//Spin for a number of cycles, one access at a time
+void sim_Run(uint64_t cycles){
+
+   uint64_t end = sim_Clock + cycles;
+
+   while(sim_Clock < end)
+      sim_Access();
+}
+
+//__delay_us and __delay_ms
+void sim_Delay(uint32_t cycles){
+
+   if(sim_Ipl)
+      sim_Error("delay of %lu cycles in an ISR",(unsigned long)cycles);
+   sim_Clock += cycles;
+   sim_Access();
+}
+
+//Clear the counters, keep the memory
+void sim_ClearCounts(void){
+
+   uint8_t idx;
+
+   memset(&sim_Bus,0,sizeof(sim_Bus));
+   sim_Trace[0] = 0;
+   memset(sim_Nvm.cycles,0,sizeof(sim_Nvm.cycles));
+   memset(sim_Nvm.wear,0,sizeof(sim_Nvm.wear));
+   sim_Nvm.busyCycles = 0;
+   sim_Nvm.failed = 0;
+   memset(&sim_Cpu,0,sizeof(sim_Cpu));
+   for(idx=0; idx<SIM_MAX_EEPS; idx++){
+      sim_Eeps[idx].writeCycles = 0;
+      sim_Eeps[idx].busyNacks = 0;
+      sim_Eeps[idx].bytesWritten = 0;
+      sim_Eeps[idx].bytesRead = 0;
+   }
+}
+
+//Power up
+void sim_Reset(void){
+
+   sim_Clock = 0;
+   sim_Ipl = 0;
+   sim_Errors = 0;
+   memset(&sim_Ifs1,0,sizeof(sim_Ifs1));
+   memset(&sim_Iec1,0,sizeof(sim_Iec1));
+   memset(&sim_Ipc4,0,sizeof(sim_Ipc4));
+   sim_Ipc4.MI2C1IP = 4;
+   sim_NvmIf = sim_NvmIe = 0;
+   sim_NvmIp = 4;
+   sim_T2con.w = 0;
+   sim_Tmr2 = sim_Tmr2Shown = sim_Tmr3Hld = sim_Tmr3Shown = 0;
+   sim_Pr2 = sim_Pr3 = 0xFFFF;
+   sim_TmrBase = 0;
+   sim_TmrStart = 0;
+   sim_TmrOn = 0;
+   memset(&sim_Fault,0,sizeof(sim_Fault));
+   sim_I2cReset();
+   sim_NvmReset();
+   sim_ClearCounts();
+   sim_Attach(0,8,128,1,0,0);                                                   //24LC01B
+}
+
+//Interrupt controller registers
+volatile sim_IFS1_t *sim_IFS1(void){
+
+   sim_Access();
+   return &sim_Ifs1;
+}
+
+volatile sim_IEC1_t *sim_IEC1(void){
+
+   sim_Access();
+   return &sim_Iec1;
+}
+
+volatile sim_IPC4_t *sim_IPC4(void){
+
+   sim_Access();
+   return &sim_Ipc4;
+}
+
+volatile unsigned *sim_NVMIF(void){
+
+   sim_Access();
+   return &sim_NvmIf;
+}
+
+volatile unsigned *sim_NVMIE(void){
+
+   sim_Access();
+   return &sim_NvmIe;
+}
+
+volatile unsigned *sim_NVMIP(void){
+
+   sim_Access();
+   return &sim_NvmIp;
+}
+
+//Timer registers
+volatile uint16_t *sim_T2CONw(void){
+
+   sim_Access();
+   return &sim_T2con.w;
+}
+
+volatile sim_T2CON_t *sim_T2CON(void){
+
+   sim_Access();
+   return &sim_T2con;
+}
+
+volatile uint16_t *sim_TMR2(void){
+
+   uint32_t count;
+
+   sim_Access();
+   count = sim_TmrCount();
+   sim_Tmr2 = sim_Tmr2Shown = count;
+   if(sim_T2con.b.T32 && sim_Tmr3Hld == sim_Tmr3Shown)                          //Unless written ahead of a TMR2 write
+      sim_Tmr3Hld = sim_Tmr3Shown = count >> 16;                                //Latched for the high word read
+   return &sim_Tmr2;
+}
+
+volatile uint16_t *sim_TMR3HLD(void){
+
+   sim_Access();
+   return &sim_Tmr3Hld;
+}
+
+volatile uint16_t *sim_PR2(void){
+
+   sim_Access();
+   return &sim_Pr2;
+}
+
+volatile uint16_t *sim_PR3(void){
+
+   sim_Access();
+   return &sim_Pr3;
+}
@@ -0,0 +1,198 @@
+/*
+ * File:   sim.h
+ *
+ * Host simulator of the PIC24F16KA102 peripherals the EEPROM drivers use:
+ * the I2C1 master with up to eight 24xx parts on the bus, the data EEPROM
+ * NVM engine, Timer2/3 and the MI2C1 and NVM interrupts. lc01b.c and
+ * obeeprom.c build unchanged against sim/include/xc.h
+ *
+ * Timing model, in instruction cycles at FCY:
+ *  - Every register access costs SIM_ACCESS_CYCLES; code between accesses
+ *    is free. Busy-wait loops therefore burn time at about the rate they
+ *    do on the part
+ *  - One SCL period is BRG + 1 + FCY * 130ns (Tpgd) cycles. Start, repeated
+ *    start, stop and ack take one period, a transmitted byte nine (eight
+ *    bits and the ack) and a received byte eight
+ *  - Interrupt entry and exit cost SIM_ISR_CYCLES
+ *  - 24xx write cycles and NVM cycles run in parallel with the CPU for
+ *    their configured times
+ */
+
+#ifndef SIM_H
+#define	SIM_H
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define SIM_ACCESS_CYCLES 2                                                     //Instruction cycles per register access
+#define SIM_ISR_CYCLES    20                                                    //Interrupt entry and exit
+#define SIM_PGD_CYCLES    2                                                     //Tpgd of 130ns at 16MHz, rounded
+#define SIM_MAX_EEPS      8                                                     //24xx parts on the bus
+#define SIM_EEP_MAX_SIZE  65536UL
+#define SIM_EEP_MAX_PAGE  128
+#define SIM_NVM_WORDS     256
+#define SIM_NEVER         UINT64_MAX
+#define SIM_TRACE_LEN     4096
+
+//NVM cycle kinds, indexes of sim_Nvm_t.cycles
+#define SIM_NVM_ERASE_ONE   0
+#define SIM_NVM_ERASE_FOUR  1
+#define SIM_NVM_ERASE_EIGHT 2
+#define SIM_NVM_ERASE_BULK  3
+#define SIM_NVM_WRITE_ER    4
+#define SIM_NVM_WRITE_NOE   5
+#define SIM_NVM_KINDS       6
+
+//One 24xx part
+typedef struct{
+   uint8_t  present;                                                            //Answers on the bus
+   uint8_t  cs;                                                                 //A2..A0 strapping
+   uint8_t  csPins;                                                             //Non-zero if the part decodes A2..A0
+   uint8_t  blockBits;                                                          //Address bits carried in the control byte
+   uint8_t  addrBytes;                                                          //Memory address bytes, 1 or 2
+   uint16_t pageSize;                                                           //Page latch size
+   uint32_t size;                                                               //Capacity in bytes
+   uint32_t twcUs;                                                              //Write cycle time
+   uint8_t  stuck;                                                              //Next write cycle never ends
+   uint8_t  mem[SIM_EEP_MAX_SIZE];
+
+   //Protocol state
+   uint8_t  phase;
+   uint8_t  block;
+   uint8_t  addrHi;
+   uint32_t ptr;                                                                //Address pointer
+   uint32_t latchBase;                                                          //Page being latched
+   uint16_t latchPos;                                                           //Next latch position within the page
+   uint16_t latchCount;                                                         //Bytes latched since the address
+   uint8_t  latch[SIM_EEP_MAX_PAGE];
+   uint8_t  latched[SIM_EEP_MAX_PAGE];
+   uint64_t busyUntil;                                                          //End of the running write cycle
+
+   //Counters
+   uint32_t writeCycles;                                                        //Page write cycles started
+   uint32_t busyNacks;                                                          //Control bytes NACK'd in a write cycle
+   uint32_t bytesWritten;                                                       //Bytes committed by write cycles
+   uint32_t bytesRead;
+}sim_Eep_t;
+
+//Injectable faults. Counts run from when they are set
+typedef struct{
+   uint32_t nackByte;                                                           //NACK the Nth transmitted byte; 0 = off
+   uint32_t collisions;                                                         //Bus events that end in a collision
+   uint8_t  sdaStuck;                                                           //SCL clocks a stuck slave needs to let go of SDA
+   uint8_t  stall;                                                              //Next bus event never completes until the module is reset
+   uint32_t rxErrByte;                                                          //Corrupt the Nth received byte; 0 = off
+   uint8_t  rxErrMask;                                                          //Bits flipped in it
+   uint32_t nvmFail;                                                            //Fail the Nth NVM cycle with WRERR; 0 = off
+}sim_Faults_t;
+
+//I2C1 bus counters
+typedef struct{
+   uint64_t busyCycles;                                                         //Cycles with a bus event in flight
+   uint32_t starts;
+   uint32_t restarts;
+   uint32_t stops;
+   uint32_t txBytes;
+   uint32_t rxBytes;
+   uint32_t nacks;                                                              //Transmitted bytes not acknowledged
+   uint32_t collisions;
+   uint32_t recoveries;                                                         //Stops bit-banged with the module off
+}sim_Bus_t;
+
+//NVM engine state and counters
+typedef struct{
+   uint16_t words[SIM_NVM_WORDS];
+   uint32_t cycleUs[SIM_NVM_KINDS];                                             //Cycle time of each kind
+   uint32_t cycles[SIM_NVM_KINDS];                                              //Cycles run of each kind
+   uint32_t wear[SIM_NVM_WORDS];                                                //Erases seen by each word
+   uint64_t busyCycles;
+   uint32_t failed;                                                             //Cycles ended with WRERR
+}sim_Nvm_t;
+
+//CPU counters
+typedef struct{
+   uint64_t accesses[2];                                                        //Register accesses: main line, ISRs
+   uint32_t isrs[2];                                                            //Interrupts taken: MI2C1, NVM
+}sim_Cpu_t;
+
+extern sim_Eep_t sim_Eeps[SIM_MAX_EEPS];
+extern sim_Faults_t sim_Fault;
+extern sim_Bus_t sim_Bus;
+extern sim_Nvm_t sim_Nvm;
+extern sim_Cpu_t sim_Cpu;
+extern uint32_t sim_Errors;                                                     //Protocol violations seen by the models
+
+//Bus trace: S start, Sr repeated start, P stop, A0+ / A0- byte sent and
+//ACK'd / NACK'd, <5A byte received, A / N master ACK / NACK
+extern char sim_Trace[SIM_TRACE_LEN];
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Nothing
+// Summary:  Powers up: clock at zero, registers at their
+//           reset values, one blank 24LC01B on the bus,
+//           NVM erased, faults and counters cleared
+//-------------------------------------------------------
+void sim_Reset(void);
+
+//-------------------------------------------------------
+// Receives: Chip select, page size, capacity, address
+//           bytes, block bits and whether A2..A0 are
+//           decoded
+// Returns:  The part, blank, or NULL if the bus is full
+// Summary:  Adds a 24xx part to the bus
+//-------------------------------------------------------
+sim_Eep_t *sim_Attach(uint8_t,uint16_t,uint32_t,uint8_t,uint8_t,uint8_t);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Nothing
+// Summary:  Clears the bus, NVM and CPU counters, the
+//           per part counters and the bus trace. Memory
+//           is kept
+//-------------------------------------------------------
+void sim_ClearCounts(void);
+
+//-------------------------------------------------------
+// Receives: Nothing
+// Returns:  Instruction cycles since sim_Reset
+// Summary:  Simulated clock
+//-------------------------------------------------------
+uint64_t sim_Now(void);
+
+//-------------------------------------------------------
+// Receives: Instruction cycles
+// Returns:  Nothing
+// Summary:  Lets time pass as the main line would in a
+//           register polling loop; models advance and
+//           enabled interrupts are taken
+//-------------------------------------------------------
+void sim_Run(uint64_t);
+
+//-------------------------------------------------------
+// Receives: Instruction cycles
+// Returns:  Nothing
+// Summary:  __delay_us/__delay_ms. The I2C1 model watches
+//           the port pins across delays. A delay inside an
+//           ISR is an error
+//-------------------------------------------------------
+void sim_Delay(uint32_t);
+
+//Model internals
+void sim_Access(void);
+void sim_RaiseI2c(void);
+void sim_RaiseNvm(void);
+void sim_I2cReset(void);
+void sim_I2cStep(void);
+void sim_NvmReset(void);
+void sim_NvmStep(void);
+void sim_Error(const char *,...);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SIM_H */
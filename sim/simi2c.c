@@ -0,0 +1,475 @@
+/*******************************************************************************
+ * Host model of the I2C1 master and the 24xx parts on its bus
+ *
+ * Summary:
+ *  - Setting SEN, RSEN, PEN, RCEN or ACKEN, or writing I2C1TRN, starts one
+ *    bus event. It is picked up at the next register access and completes
+ *    a fixed number of SCL periods later, clearing its control bit (or
+ *    TRSTAT), updating ACKSTAT/I2C1RCV and raising MI2C1IF. Writing
+ *    I2C1TRN while an event is in flight sets IWCOL
+ *  - Each 24xx part follows the control byte, memory address and data
+ *    phases. Written bytes go to a page latch whose position wraps within
+ *    the page; the stop bit commits the latched bytes and starts the write
+ *    cycle, during which the part NACKs its control byte. A stop after the
+ *    address alone only moves the pointer. Reads run from the address
+ *    pointer and wrap at the end of the part
+ *  - Clearing I2CEN drops the event in flight and hands the pins to
+ *    TRISB8/9. SCL clocks and a stop made there are seen by the parts, so
+ *    lc01b_Recover can be checked
+ * *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "sim.h"
+
+sim_Eep_t sim_Eeps[SIM_MAX_EEPS];
+sim_Faults_t sim_Fault;
+sim_Bus_t sim_Bus;
+char sim_Trace[SIM_TRACE_LEN];
+
+//Bus events
+enum{
+   EV_NONE = 0,
+   EV_START,
+   EV_RSTART,
+   EV_STOP,
+   EV_TX,
+   EV_RX,
+   EV_ACK
+};
+
+//24xx protocol phases
+enum{
+   PH_IDLE = 0,                                                                 //Not addressed
+   PH_CTRL,                                                                     //Start seen, control byte next
+   PH_ADDR_HI,                                                                  //High address byte next
+   PH_ADDR,                                                                     //Low address byte next
+   PH_WRITE,                                                                    //Data bytes into the page latch
+   PH_READ                                                                      //Data bytes out from the pointer
+};
+
+#define SIM_TRN_EMPTY 0xFFFF                                                    //No byte waiting in I2C1TRN
+
+static uint8_t sim_EepCount;
+static sim_I2C1CON_t sim_Con;
+static sim_I2C1STAT_t sim_Stat;
+static uint16_t sim_Brg, sim_Trn = SIM_TRN_EMPTY, sim_Rcv;
+static sim_TRISB_t sim_Trisb;
+static sim_LATB_t sim_Latb;
+
+static uint8_t sim_Event = EV_NONE;                                             //Bus event in flight
+static uint8_t sim_TxByte;
+static uint64_t sim_EventStart, sim_EventEnd;
+static uint8_t sim_Stalled = 0;                                                 //Event in flight never completes
+static uint8_t sim_SclHigh = 1, sim_SdaHigh = 1;                                //Pins while the port drives them
+
+//Add a part
+sim_Eep_t *sim_Attach(uint8_t cs, uint16_t pageSize, uint32_t size, uint8_t addrBytes, uint8_t blockBits, uint8_t csPins){
+
+   sim_Eep_t *pEep;
+
+   if(sim_EepCount >= SIM_MAX_EEPS || size > SIM_EEP_MAX_SIZE || pageSize > SIM_EEP_MAX_PAGE)
+      return 0;
+   pEep = &sim_Eeps[sim_EepCount++];
+   memset(pEep,0,sizeof(*pEep));
+   memset(pEep->mem,0xFF,sizeof(pEep->mem));                                    //Shipped erased
+   pEep->present = 1;
+   pEep->cs = cs;
+   pEep->csPins = csPins;
+   pEep->blockBits = blockBits;
+   pEep->addrBytes = addrBytes;
+   pEep->pageSize = pageSize;
+   pEep->size = size;
+   pEep->twcUs = 3000;                                                          //Typical; 5ms max
+   return pEep;
+}
+
+//Empty bus, module at its reset values
+void sim_I2cReset(void){
+
+   sim_EepCount = 0;
+   sim_Con.w = 0;
+   sim_Stat.w = 0;
+   sim_Brg = 0;
+   sim_Trn = SIM_TRN_EMPTY;
+   sim_Rcv = 0;
+   memset(&sim_Trisb,0xFF,sizeof(sim_Trisb));
+   memset(&sim_Latb,0,sizeof(sim_Latb));
+   sim_Event = EV_NONE;
+   sim_Stalled = 0;
+   sim_SclHigh = sim_SdaHigh = 1;
+}
+
+//Append to the bus trace; a full trace keeps its start
+static void sim_Log(const char *pText){
+
+   size_t used = strlen(sim_Trace);
+
+   if(used + strlen(pText) + 2 < SIM_TRACE_LEN)
+      sprintf(sim_Trace + used,"%s%s",used ? " " : "",pText);
+}
+
+static void sim_LogByte(const char *pFmt, uint8_t dataByte){
+
+   char text[8];
+
+   sprintf(text,pFmt,dataByte);
+   sim_Log(text);
+}
+
+//One SCL period in instruction cycles
+static uint64_t sim_Period(void){
+
+   return (uint64_t)sim_Brg + 1 + SIM_PGD_CYCLES;
+}
+
+//Non-zero if a control byte selects the part
+static uint8_t sim_Selects(sim_Eep_t *pEep, uint8_t ctrl){
+
+   uint8_t pins = (ctrl >> 1) & 0x07;
+
+   if((ctrl & 0xF0) != 0xA0 || !pEep->present)
+      return 0;
+   if(pEep->csPins)
+      return (pins >> pEep->blockBits) == (pEep->cs >> pEep->blockBits);
+   return 1;                                                                    //A2..A0 not decoded
+}
+
+//Start or repeated start: every part waits for a control byte. A repeated
+//start abandons a page write
+static void sim_BusStart(void){
+
+   uint8_t idx;
+
+   for(idx=0; idx<sim_EepCount; idx++){
+      sim_Eeps[idx].phase = PH_CTRL;
+      sim_Eeps[idx].latchCount = 0;
+   }
+}
+
+//Stop: a part with latched bytes writes them and starts its write cycle
+static void sim_BusStop(void){
+
+   sim_Eep_t *pEep;
+   uint16_t pos;
+   uint8_t idx;
+
+   for(idx=0; idx<sim_EepCount; idx++){
+      pEep = &sim_Eeps[idx];
+      if(pEep->phase == PH_WRITE && pEep->latchCount){
+         for(pos=0; pos<pEep->pageSize; pos++){
+            if(pEep->latched[pos]){
+               pEep->mem[pEep->latchBase + pos] = pEep->latch[pos];
+               pEep->bytesWritten++;
+            }
+         }
+         pEep->busyUntil = pEep->stuck ? SIM_NEVER : sim_Now() + (uint64_t)pEep->twcUs * (FCY / 1000000UL);
+         pEep->writeCycles++;
+      }
+      pEep->phase = PH_IDLE;
+      pEep->latchCount = 0;
+   }
+}
+
+//Clock a byte to the parts. Returns non-zero if one of them ACKs it
+static uint8_t sim_BusTx(uint8_t dataByte){
+
+   sim_Eep_t *pEep;
+   uint8_t idx, acked = 0;
+   uint32_t addr;
+
+   sim_Bus.txBytes++;
+   if(sim_Fault.nackByte && --sim_Fault.nackByte == 0){                         //Injected NACK; everyone drops off
+      for(idx=0; idx<sim_EepCount; idx++)
+         sim_Eeps[idx].phase = PH_IDLE;
+      return 0;
+   }
+
+   for(idx=0; idx<sim_EepCount; idx++){
+      pEep = &sim_Eeps[idx];
+      switch(pEep->phase){
+         case PH_CTRL:
+            if(!sim_Selects(pEep,dataByte)){
+               pEep->phase = PH_IDLE;
+               break;
+            }
+            if(sim_Now() < pEep->busyUntil){                                    //In its write cycle
+               pEep->busyNacks++;
+               pEep->phase = PH_IDLE;
+               break;
+            }
+            pEep->block = ((dataByte >> 1) & 0x07) & ((1 << pEep->blockBits) - 1);
+            if(dataByte & 1)
+               pEep->phase = PH_READ;
+            else
+               pEep->phase = (pEep->addrBytes == 2) ? PH_ADDR_HI : PH_ADDR;
+            if(acked)
+               sim_Error("two parts answer control byte 0x%02X",dataByte);
+            acked = 1;
+            break;
+
+         case PH_ADDR_HI:
+            pEep->addrHi = dataByte;
+            pEep->phase = PH_ADDR;
+            acked = 1;
+            break;
+
+         case PH_ADDR:
+            if(pEep->addrBytes == 2)
+               addr = ((uint32_t)pEep->addrHi << 8) | dataByte;
+            else
+               addr = ((uint32_t)pEep->block << 8) | dataByte;
+            pEep->ptr = addr % pEep->size;
+            pEep->latchBase = pEep->ptr - pEep->ptr % pEep->pageSize;
+            pEep->latchPos = pEep->ptr % pEep->pageSize;
+            pEep->latchCount = 0;
+            memset(pEep->latched,0,sizeof(pEep->latched));
+            pEep->phase = PH_WRITE;
+            acked = 1;
+            break;
+
+         case PH_WRITE:
+            pEep->latch[pEep->latchPos] = dataByte;                             //Wraps within the page
+            pEep->latched[pEep->latchPos] = 1;
+            pEep->latchPos = (pEep->latchPos + 1) % pEep->pageSize;
+            pEep->ptr = pEep->latchBase + pEep->latchPos;
+            pEep->latchCount++;
+            acked = 1;
+            break;
+
+         case PH_READ:
+            sim_Error("byte 0x%02X sent to a part in read mode",dataByte);
+            break;
+
+         default:
+            break;
+      }
+   }
+   if(!acked)
+      sim_Bus.nacks++;
+   return acked;
+}
+
+//Clock a byte in from the addressed part
+static uint8_t sim_BusRx(void){
+
+   sim_Eep_t *pEep;
+   uint8_t idx, dataByte = 0xFF;                                                //Pulled up when nobody drives SDA
+   uint8_t found = 0;
+
+   sim_Bus.rxBytes++;
+   for(idx=0; idx<sim_EepCount; idx++){
+      pEep = &sim_Eeps[idx];
+      if(pEep->phase == PH_READ){
+         dataByte = pEep->mem[pEep->ptr];
+         pEep->ptr = (pEep->ptr + 1) % pEep->size;
+         pEep->bytesRead++;
+         found = 1;
+      }
+   }
+   if(!found)
+      sim_Error("receive with no part in read mode");
+   if(sim_Fault.rxErrByte && --sim_Fault.rxErrByte == 0)
+      dataByte ^= sim_Fault.rxErrMask;                                          //Injected bit errors
+   return dataByte;
+}
+
+//Master NACK ends a read
+static void sim_BusAck(uint8_t nack){
+
+   uint8_t idx;
+
+   if(!nack)
+      return;
+   for(idx=0; idx<sim_EepCount; idx++)
+      if(sim_Eeps[idx].phase == PH_READ)
+         sim_Eeps[idx].phase = PH_IDLE;
+}
+
+//Finish the event in flight
+static void sim_Complete(void){
+
+   uint8_t event = sim_Event;
+
+   sim_Event = EV_NONE;
+   sim_Bus.busyCycles += sim_EventEnd - sim_EventStart;
+
+   //Stuck SDA or an injected collision: the event ends in BCL
+   if(sim_Fault.sdaStuck || (sim_Fault.collisions && sim_Fault.collisions--)){
+      sim_Log("BCL");
+      sim_Con.b.SEN = sim_Con.b.RSEN = sim_Con.b.PEN = sim_Con.b.RCEN = sim_Con.b.ACKEN = 0;
+      sim_Stat.b.TRSTAT = 0;
+      sim_Stat.b.TBF = 0;
+      sim_Stat.b.BCL = 1;
+      sim_Bus.collisions++;
+      sim_RaiseI2c();
+      return;
+   }
+
+   switch(event){
+      case EV_START:
+         sim_Con.b.SEN = 0;
+         sim_Bus.starts++;
+         sim_Log("S");
+         sim_BusStart();
+         break;
+      case EV_RSTART:
+         sim_Con.b.RSEN = 0;
+         sim_Bus.restarts++;
+         sim_Log("Sr");
+         sim_BusStart();
+         break;
+      case EV_STOP:
+         sim_Con.b.PEN = 0;
+         sim_Bus.stops++;
+         sim_Log("P");
+         sim_BusStop();
+         break;
+      case EV_TX:
+         sim_Stat.b.ACKSTAT = !sim_BusTx(sim_TxByte);
+         sim_LogByte(sim_Stat.b.ACKSTAT ? "%02X-" : "%02X+",sim_TxByte);
+         sim_Stat.b.TRSTAT = 0;
+         sim_Stat.b.TBF = 0;
+         break;
+      case EV_RX:
+         sim_Con.b.RCEN = 0;
+         sim_Rcv = sim_BusRx();
+         sim_LogByte("<%02X",sim_Rcv);
+         sim_Stat.b.RBF = 1;
+         break;
+      case EV_ACK:
+         sim_Con.b.ACKEN = 0;
+         sim_Log(sim_Con.b.ACKDT ? "N" : "A");
+         sim_BusAck(sim_Con.b.ACKDT);
+         break;
+      default:
+         break;
+   }
+   sim_RaiseI2c();
+}
+
+//Start the event a register write asked for
+static void sim_Begin(uint8_t event, uint8_t periods){
+
+   sim_Event = event;
+   sim_EventStart = sim_Now();
+   sim_EventEnd = sim_EventStart + periods * sim_Period();
+   if(sim_Fault.stall){
+      sim_Fault.stall = 0;
+      sim_Stalled = 1;
+   }
+}
+
+//Pins driven from the port while the module is off. A rising SCL clocks
+//the parts; SDA rising with SCL high is a stop
+static void sim_PortStep(void){
+
+   uint8_t scl = sim_Trisb.TRISB8 || sim_Latb.LATB8;
+   uint8_t sda = sim_Trisb.TRISB9 || sim_Latb.LATB9;
+
+   if(scl && !sim_SclHigh && sim_Fault.sdaStuck)
+      sim_Fault.sdaStuck--;                                                     //Slave shifts out another bit
+   if(sda && !sim_SdaHigh && scl && sim_SclHigh){
+      sim_Bus.recoveries++;
+      sim_Log("P(port)");
+      sim_BusStop();
+   }
+   sim_SclHigh = scl;
+   sim_SdaHigh = sda;
+}
+
+//Advance the module to the current time
+void sim_I2cStep(void){
+
+   if(!sim_Con.b.I2CEN){
+      sim_Event = EV_NONE;                                                      //Module off; nothing in flight
+      sim_Stalled = 0;
+      sim_Con.b.SEN = sim_Con.b.RSEN = sim_Con.b.PEN = sim_Con.b.RCEN = sim_Con.b.ACKEN = 0;
+      sim_Stat.b.TRSTAT = 0;
+      sim_Stat.b.TBF = 0;
+      sim_Trn = SIM_TRN_EMPTY;
+      sim_PortStep();
+      return;
+   }
+   sim_SclHigh = sim_SdaHigh = 1;                                               //Module drives the pins
+
+   if(sim_Event != EV_NONE){
+      if(sim_Trn != SIM_TRN_EMPTY){                                             //Written while busy
+         sim_Trn = SIM_TRN_EMPTY;
+         sim_Stat.b.IWCOL = 1;
+      }
+      if(!sim_Stalled && sim_Now() >= sim_EventEnd)
+         sim_Complete();
+      return;
+   }
+
+   if(sim_Con.b.SEN)
+      sim_Begin(EV_START,1);
+   else if(sim_Con.b.RSEN)
+      sim_Begin(EV_RSTART,1);
+   else if(sim_Con.b.PEN)
+      sim_Begin(EV_STOP,1);
+   else if(sim_Con.b.RCEN)
+      sim_Begin(EV_RX,8);
+   else if(sim_Con.b.ACKEN)
+      sim_Begin(EV_ACK,1);
+   else if(sim_Trn != SIM_TRN_EMPTY){
+      sim_TxByte = sim_Trn;
+      sim_Trn = SIM_TRN_EMPTY;
+      sim_Stat.b.TRSTAT = 1;
+      sim_Stat.b.TBF = 1;
+      sim_Begin(EV_TX,9);
+   }
+}
+
+//I2C1 registers
+volatile uint16_t *sim_I2C1CONw(void){
+
+   sim_Access();
+   return &sim_Con.w;
+}
+
+volatile sim_I2C1CON_t *sim_I2C1CON(void){
+
+   sim_Access();
+   return &sim_Con;
+}
+
+volatile sim_I2C1STAT_t *sim_I2C1STAT(void){
+
+   sim_Access();
+   return &sim_Stat;
+}
+
+volatile uint16_t *sim_I2C1BRG(void){
+
+   sim_Access();
+   return &sim_Brg;
+}
+
+volatile uint16_t *sim_I2C1TRN(void){
+
+   sim_Access();
+   return &sim_Trn;
+}
+
+volatile uint16_t *sim_I2C1RCV(void){
+
+   sim_Access();
+   sim_Stat.b.RBF = 0;                                                          //Reading the buffer empties it
+   return &sim_Rcv;
+}
+
+//Port registers
+volatile sim_TRISB_t *sim_TRISB(void){
+
+   sim_Access();
+   return &sim_Trisb;
+}
+
+volatile sim_LATB_t *sim_LATB(void){
+
+   sim_Access();
+   return &sim_Latb;
+}
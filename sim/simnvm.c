@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * Host model of the PIC24F16KA102 data EEPROM and its NVM engine
+ *
+ * Summary:
+ *  - 256 words at 0x7FFE00, read with TBLRDL at TBLPAG 0x7F. The array
+ *    reads its old contents until a cycle completes
+ *  - __builtin_tblwtl loads the one word write latch. __builtin_write_NVM
+ *    starts the cycle NVMCON selects and sets WR; the cycle completes
+ *    sim_Nvm.cycleUs[] later, clearing WR and raising NVMIF
+ *  - Erases clear 1, 4 or 8 aligned words, or all of them, to 0xFFFF.
+ *    EE_WRITE_ER erases and programs the word in one cycle; EE_WRITE_NOE
+ *    (PGMONLY) can only clear bits, so an unerased word reads back the AND
+ *    of old and new
+ *  - Every cycle defaults to 4ms (TIWD). Erases are counted per word as
+ *    wear
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "sim.h"
+
+#define SIM_NVM_PAGE 0x7F
+#define SIM_NVM_BASE 0xFE00
+#define SIM_NVM_TIWD 4000                                                       //Data EEPROM cycle, us
+
+sim_Nvm_t sim_Nvm;
+uint16_t TBLPAG;
+
+static sim_NVMCON_t sim_Nvmcon;
+static uint16_t sim_LatchOffset, sim_LatchData;
+static uint8_t sim_Kind;                                                        //Cycle in progress
+static uint16_t sim_Word;                                                       //Its word, from the latch
+static uint16_t sim_Data;
+static uint64_t sim_CycleStart, sim_CycleEnd;
+static uint8_t sim_Failing;                                                     //Cycle in progress ends in WRERR
+
+//Erased array, no cycle running
+void sim_NvmReset(void){
+
+   uint8_t kind;
+
+   memset(sim_Nvm.words,0xFF,sizeof(sim_Nvm.words));
+   for(kind=0; kind<SIM_NVM_KINDS; kind++)
+      sim_Nvm.cycleUs[kind] = SIM_NVM_TIWD;
+   sim_Nvmcon.w = 0;
+   TBLPAG = 0;
+   sim_LatchOffset = sim_LatchData = 0;
+   sim_Failing = 0;
+}
+
+//Word index of a table offset
+static uint16_t sim_NvmIndex(uint16_t offset){
+
+   if(TBLPAG != SIM_NVM_PAGE || offset < SIM_NVM_BASE || (offset & 1))
+      sim_Error("table access at %02X:%04X is not a data EEPROM word",TBLPAG,offset);
+   return ((offset - SIM_NVM_BASE) / 2) % SIM_NVM_WORDS;
+}
+
+//Erase an aligned block of words
+static void sim_NvmErase(uint16_t word, uint16_t count){
+
+   uint16_t idx;
+
+   word -= word % count;
+   for(idx=word; idx<word + count; idx++){
+      sim_Nvm.words[idx] = 0xFFFF;
+      sim_Nvm.wear[idx]++;
+   }
+}
+
+//Apply the finished cycle
+static void sim_NvmComplete(void){
+
+   sim_Nvmcon.b.WR = 0;
+   sim_Nvm.busyCycles += sim_CycleEnd - sim_CycleStart;
+   sim_Nvm.cycles[sim_Kind]++;
+
+   if(sim_Failing){                                                             //Injected failure; nothing changes
+      sim_Failing = 0;
+      sim_Nvmcon.b.WRERR = 1;
+      sim_Nvm.failed++;
+   }
+   else{
+      switch(sim_Kind){
+         case SIM_NVM_ERASE_ONE:   sim_NvmErase(sim_Word,1);                 break;
+         case SIM_NVM_ERASE_FOUR:  sim_NvmErase(sim_Word,4);                 break;
+         case SIM_NVM_ERASE_EIGHT: sim_NvmErase(sim_Word,8);                 break;
+         case SIM_NVM_ERASE_BULK:  sim_NvmErase(0,SIM_NVM_WORDS);            break;
+         case SIM_NVM_WRITE_ER:
+            sim_NvmErase(sim_Word,1);
+            sim_Nvm.words[sim_Word] = sim_Data;
+            break;
+         case SIM_NVM_WRITE_NOE:
+            sim_Nvm.words[sim_Word] &= sim_Data;                                //Programming only clears bits
+            break;
+         default:
+            break;
+      }
+   }
+   sim_RaiseNvm();
+}
+
+//Advance the engine to the current time
+void sim_NvmStep(void){
+
+   if(sim_Nvmcon.b.WR && sim_Now() >= sim_CycleEnd)
+      sim_NvmComplete();
+}
+
+//TBLRDL
+uint16_t sim_TblRdl(uint16_t offset){
+
+   sim_Access();
+   return sim_Nvm.words[sim_NvmIndex(offset)];
+}
+
+//TBLWTL into the write latch
+void sim_TblWtl(uint16_t offset, uint16_t data){
+
+   sim_Access();
+   sim_LatchOffset = offset;
+   sim_LatchData = data;
+}
+
+//Unlock sequence and WR set
+void sim_WriteNvm(void){
+
+   uint16_t nvmOp;
+
+   sim_Access();
+   nvmOp = sim_Nvmcon.w & 0x707F;                                               //WREN, PGMONLY, ERASE and NVMOP
+   if(sim_Nvmcon.b.WR){
+      sim_Error("NVM cycle started while one is running");
+      return;
+   }
+
+   switch(nvmOp){
+      case 0x4058: sim_Kind = SIM_NVM_ERASE_ONE;   break;
+      case 0x4059: sim_Kind = SIM_NVM_ERASE_FOUR;  break;
+      case 0x405A: sim_Kind = SIM_NVM_ERASE_EIGHT; break;
+      case 0x4050: sim_Kind = SIM_NVM_ERASE_BULK;  break;
+      case 0x4004: sim_Kind = SIM_NVM_WRITE_ER;    break;
+      case 0x5004: sim_Kind = SIM_NVM_WRITE_NOE;   break;
+      default:
+         sim_Error("NVMCON 0x%04X is not a data EEPROM operation",sim_Nvmcon.w);
+         return;
+   }
+   sim_Word = (sim_Kind == SIM_NVM_ERASE_BULK) ? 0 : sim_NvmIndex(sim_LatchOffset);
+   sim_Data = sim_LatchData;
+   sim_Failing = sim_Fault.nvmFail && --sim_Fault.nvmFail == 0;
+   sim_CycleStart = sim_Now();
+   sim_CycleEnd = sim_CycleStart + (uint64_t)sim_Nvm.cycleUs[sim_Kind] * (FCY / 1000000UL);
+   sim_Nvmcon.b.WRERR = 0;
+   sim_Nvmcon.b.WR = 1;
+}
+
+//NVM registers
+volatile uint16_t *sim_NVMCONw(void){
+
+   sim_Access();
+   return &sim_Nvmcon.w;
+}
+
+volatile sim_NVMCON_t *sim_NVMCON(void){
+
+   sim_Access();
+   return &sim_Nvmcon;
+}
@@ -0,0 +1,25 @@
+/*
+ * File:   simtest.h
+ *
+ * Check macros for the host tests. A failed check is reported and
+ * counted; SIM_TEST_END prints the result and is the exit status
+ */
+
+#ifndef SIMTEST_H
+#define	SIMTEST_H
+
+#include <stdio.h>
+
+static int simtest_Fails = 0;
+
+#define CHECK(cond) do{ \
+      if(!(cond)){ \
+         printf("FAIL %s:%d: %s\n",__FILE__,__LINE__,#cond); \
+         simtest_Fails++; \
+      } \
+   }while(0)
+
+#define SIM_TEST_END(name) \
+   (printf("%s: %s\n",(name),simtest_Fails ? "FAILED" : "PASS"),simtest_Fails != 0)
+
+#endif	/* SIMTEST_H */
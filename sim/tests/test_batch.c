@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * Scatter-gather reads and write batches on the simulated 24xx parts:
+ * lc01b_ReadBatch merging segments across gaps up to the re-address cost
+ * and streaming long runs through its bounce buffer, and
+ * lc01b_BatchCommit writing one page per touched page, reading back only
+ * the holes in a partly covered page
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "sim.h"
+#include "simtest.h"
+
+//Memory pattern written straight into the model
+#define TEST_BYTE(addr) ((uint8_t)((addr) * 5 + 3))
+
+//Blank bus with one part of the given kind holding the pattern
+static sim_Eep_t *test_Boot(lc01b_Dev_t *pDesc, uint16_t pageSize, uint32_t size, uint8_t addrBytes){
+
+   sim_Eep_t *pEep = &sim_Eeps[0];
+   uint32_t addr;
+
+   sim_Reset();
+   if(pDesc){
+      sim_Eeps[0].present = 0;
+      pEep = sim_Attach(0,pageSize,size,addrBytes,0,1);
+   }
+   for(addr=0; addr<size; addr++)
+      pEep->mem[addr] = TEST_BYTE(addr);
+   init_I2C(I2C_BRG_400);
+   lc01b_SetDevice(pDesc);
+   return pEep;
+}
+
+//Non-zero if the buffer holds the pattern from addr on
+static uint8_t test_Holds(const uint8_t *pData, uint16_t addr, uint16_t len){
+
+   uint16_t idx;
+
+   for(idx=0; idx<len; idx++){
+      if(pData[idx] != TEST_BYTE(addr + idx))
+         return 0;
+   }
+   return 1;
+}
+
+//Segments within LC01B_READ_OVERHEAD + address bytes of each other are
+//read straight through; one byte further costs a new addressed read
+static void test_Merge(void){
+
+   uint8_t a[4], b[2], c[3], d[2];
+   lc01b_Seg_t segs[4] = {
+      {0x30,sizeof(c),c},                                                       //Out of order
+      {0x10,sizeof(a),a},
+      {0x14 + LC01B_READ_OVERHEAD + 1,sizeof(b),b},                             //Gap of 4 on a one address byte part
+      {0x1A + LC01B_READ_OVERHEAD + 1 + 1,sizeof(d),d},                         //Gap of 5 after the merged run
+   };
+   sim_Eep_t *pEep = test_Boot(0,0,LC01B_CAP,1);
+
+   sim_ClearCounts();
+   CHECK(lc01b_ReadBatch(segs,4) == ERR_NONE);
+   CHECK(test_Holds(a,0x10,sizeof(a)) && test_Holds(b,0x18,sizeof(b)));
+   CHECK(test_Holds(c,0x30,sizeof(c)) && test_Holds(d,0x1F,sizeof(d)));
+   CHECK(pEep->bytesRead == (0x1A - 0x10) + sizeof(d) + sizeof(c));             //First two as one run
+   CHECK(sim_Bus.restarts == 3);                                                //Three addressed reads
+
+   //Overlapping and empty segments
+   segs[0].ee_addr = 0x12;
+   segs[0].len = 0;
+   segs[2].ee_addr = 0x11;
+   segs[3].ee_addr = 0x12;
+   sim_ClearCounts();
+   CHECK(lc01b_ReadBatch(segs,4) == ERR_NONE);
+   CHECK(test_Holds(a,0x10,4) && test_Holds(b,0x11,2) && test_Holds(d,0x12,2));
+   CHECK(pEep->bytesRead == 4 && sim_Bus.restarts == 1);
+
+   //Limits
+   CHECK(lc01b_ReadBatch(segs,LC01B_SEG_MAX + 1) == ERR_MEM_BOUNDS);
+   segs[1].ee_addr = LC01B_CAP - 2;
+   CHECK(lc01b_ReadBatch(segs,4) == ERR_MEM_BOUNDS);
+   CHECK(sim_Errors == 0);
+}
+
+//Two address bytes widen the gap that is read through by one
+static void test_MergeWide(void){
+
+   uint8_t a[2], b[2];
+   lc01b_Dev_t desc = LC01B_DEV_24LC64(0);
+   lc01b_Seg_t segs[2] = {{0x100,sizeof(a),a},{0x102 + LC01B_READ_OVERHEAD + 2,sizeof(b),b}};
+   sim_Eep_t *pEep = test_Boot(&desc,32,8192,2);
+
+   sim_ClearCounts();
+   CHECK(lc01b_ReadBatch(segs,2) == ERR_NONE);
+   CHECK(test_Holds(a,0x100,2) && test_Holds(b,0x107,2));
+   CHECK(pEep->bytesRead == 9 && sim_Bus.restarts == 1);
+
+   segs[1].ee_addr++;
+   sim_ClearCounts();
+   CHECK(lc01b_ReadBatch(segs,2) == ERR_NONE);
+   CHECK(test_Holds(b,0x108,2));
+   CHECK(pEep->bytesRead == 4 && sim_Bus.restarts == 2);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+//A run longer than LC01B_BATCH_BUF streams through the bounce buffer with
+//current address reads after the first chunk
+static void test_Bounce(void){
+
+   uint8_t a[20], b[60];
+   lc01b_Seg_t segs[2] = {{0x08,sizeof(a),a},{0x18,sizeof(b),b}};
+   sim_Eep_t *pEep = test_Boot(0,0,LC01B_CAP,1);
+
+   sim_ClearCounts();
+   CHECK(lc01b_ReadBatch(segs,2) == ERR_NONE);
+   CHECK(test_Holds(a,0x08,sizeof(a)) && test_Holds(b,0x18,sizeof(b)));
+   CHECK(pEep->bytesRead == 0x18 + sizeof(b) - 0x08);
+   CHECK(sim_Bus.restarts == 1);
+   CHECK(sim_Bus.starts == (0x18 + sizeof(b) - 0x08 + LC01B_BATCH_BUF - 1) / LC01B_BATCH_BUF);
+   CHECK(sim_Errors == 0);
+}
+
+//One page write per touched page; only the page with a hole between its
+//updates is read first, and only across the written span
+static void test_Commit(void){
+
+   uint8_t u1[2] = {0xA1,0xA2}, u2[2] = {0xB1,0xB2}, u3[8], u4[4] = {0xD1,0xD2,0xD3,0xD4};
+   uint8_t u5 = 0xE1, u6 = 0xF1, idx;
+   lc01b_Seg_t segs[6];
+   lc01b_Batch_t batch;
+   sim_Eep_t *pEep = test_Boot(0,0,LC01B_CAP,1);
+
+   for(idx=0; idx<sizeof(u3); idx++)
+      u3[idx] = 0xC0 + idx;
+   lc01b_BatchInit(&batch,segs,6);
+   CHECK(lc01b_BatchAdd(&batch,0x0C,2,u2) == ERR_NONE);                         //Page 1 with a hole at 0x0B
+   CHECK(lc01b_BatchAdd(&batch,0x09,2,u1) == ERR_NONE);
+   CHECK(lc01b_BatchAdd(&batch,0x10,8,u3) == ERR_NONE);                         //All of page 2
+   CHECK(lc01b_BatchAdd(&batch,0x1E,4,u4) == ERR_NONE);                         //Across pages 3 and 4
+   CHECK(lc01b_BatchAdd(&batch,0x22,1,&u5) == ERR_NONE);
+   CHECK(lc01b_BatchAdd(&batch,0x21,1,&u6) == ERR_NONE);                        //Added last, so it wins
+   CHECK(lc01b_BatchAdd(&batch,0x40,1,&u6) == ERR_BATCH_FULL);
+   CHECK(lc01b_BatchAdd(&batch,LC01B_CAP - 1,2,&u6) == ERR_MEM_BOUNDS);
+
+   sim_ClearCounts();
+   CHECK(lc01b_BatchCommit(&batch) == ERR_NONE);
+   CHECK(batch.count == 0);
+   CHECK(pEep->writeCycles == 4);
+   CHECK(pEep->bytesRead == 0x0E - 0x09);                                       //Page 1 span only
+   CHECK(pEep->bytesWritten == 5 + 8 + 2 + 3);
+
+   CHECK(pEep->mem[0x08] == TEST_BYTE(0x08) && pEep->mem[0x0E] == TEST_BYTE(0x0E));
+   CHECK(pEep->mem[0x09] == 0xA1 && pEep->mem[0x0A] == 0xA2);
+   CHECK(pEep->mem[0x0B] == TEST_BYTE(0x0B));                                   //Hole kept
+   CHECK(pEep->mem[0x0C] == 0xB1 && pEep->mem[0x0D] == 0xB2);
+   CHECK(memcmp(&pEep->mem[0x10],u3,sizeof(u3)) == 0);
+   CHECK(pEep->mem[0x1D] == TEST_BYTE(0x1D));
+   CHECK(pEep->mem[0x1E] == 0xD1 && pEep->mem[0x1F] == 0xD2 && pEep->mem[0x20] == 0xD3);
+   CHECK(pEep->mem[0x21] == 0xF1 && pEep->mem[0x22] == 0xE1);
+   CHECK(pEep->mem[0x23] == TEST_BYTE(0x23));
+
+   //An empty batch writes nothing
+   sim_ClearCounts();
+   CHECK(lc01b_BatchCommit(&batch) == ERR_NONE);
+   CHECK(pEep->writeCycles == 0 && pEep->bytesRead == 0);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Merge();
+   test_MergeWide();
+   test_Bounce();
+   test_Commit();
+   return SIM_TEST_END("test_batch");
+}
@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * Object layout test: eeobj.h addresses for a known table, and EEOBJ_SAVE
+ * and EEOBJ_LOAD against stubbed object calls. Built without the drivers
+ *
+ * Defining one of EEOBJ_FAIL_OVERFLOW, EEOBJ_FAIL_RANGE, EEOBJ_FAIL_CRC or
+ * EEOBJ_FAIL_SIZE gives a layout or call eeobj.h must refuse to compile;
+ * make test checks that each one fails
+ * *****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "simtest.h"
+
+typedef struct{ uint8_t b[10]; } test_Arr_t;
+typedef struct{ uint8_t b[100]; } test_Big_t;
+
+#ifdef EEOBJ_FAIL_OVERFLOW
+#define TEST_EXTRA(X) X(big,test_Big_t,0)                                       //Ends past the 128 byte part
+#elif defined(EEOBJ_FAIL_CRC)
+#define TEST_EXTRA(X) X(bad,uint8_t,3)                                          //Not a CRC type
+#else
+#define TEST_EXTRA(X)
+#endif
+#ifdef EEOBJ_FAIL_RANGE
+#define EEOBJ_BASE 0x7FC0                                                       //Layout would pass 0x8000
+#endif
+
+#define EEOBJ_TABLE(X) \
+   X(b1,uint8_t,0) \
+   X(pi,float,LC01B_CRC8) \
+   X(bigUn,uint64_t,LC01B_CRC16) \
+   X(arr,test_Arr_t,LC01B_CRC16) \
+   X(w,uint16_t,0) \
+   TEST_EXTRA(X)
+#include "eeobj.h"
+
+//Stub device and the last object call made
+static uint8_t test_Mem[LC01B_CAP];
+static struct{
+   uint16_t addr;
+   uint16_t len;
+   void     *pObj;
+   uint8_t  crc;
+}test_Call;
+static ee_Errors_t test_ReadErr;
+
+ee_Errors_t lc01b_WriteObjectCrc(uint16_t ee_addr,uint16_t objLen,void *pObj,uint8_t crcType){
+
+   test_Call.addr = ee_addr;
+   test_Call.len = objLen;
+   test_Call.pObj = pObj;
+   test_Call.crc = crcType;
+   memcpy(&test_Mem[ee_addr],pObj,objLen);
+   return ERR_NONE;
+}
+
+ee_Errors_t lc01b_ReadObjectCrc(uint16_t ee_addr,uint16_t objLen,void *pObj,uint8_t crcType){
+
+   test_Call.addr = ee_addr;
+   test_Call.len = objLen;
+   test_Call.pObj = pObj;
+   test_Call.crc = crcType;
+   memcpy(pObj,&test_Mem[ee_addr],objLen);
+   return test_ReadErr;
+}
+
+//Addresses in table order; an object that fits in a page never
+//straddles one
+static void test_Layout(void){
+
+   CHECK(EEOBJ_b1 == 0);
+   CHECK(EEOBJ_pi == 1);                                                        //Five bytes fit after b1
+   CHECK(EEOBJ_bigUn == 6);                                                     //Ten bytes need two pages from here or not
+   CHECK(EEOBJ_arr == 16);                                                      //Twelve from 16 is two pages, from 17 three
+   CHECK(EEOBJ_w == 28);
+   CHECK(EEOBJ_END == 30);
+
+   CHECK(EEOBJ_LAST_pi == EEOBJ_pi + sizeof(float) + LC01B_CRC8 - 1);
+   CHECK(EEOBJ_LAST_bigUn == 15);
+   CHECK(EEOBJ_LAST_b1 < EEOBJ_pi && EEOBJ_LAST_pi < EEOBJ_bigUn);              //No overlaps
+   CHECK(EEOBJ_LAST_bigUn < EEOBJ_arr && EEOBJ_LAST_arr < EEOBJ_w);
+   CHECK(EEOBJ_pi / LC01B_PAGE == EEOBJ_LAST_pi / LC01B_PAGE);
+   CHECK(EEOBJ_w / LC01B_PAGE == EEOBJ_LAST_w / LC01B_PAGE);
+
+   //Placement rule on its own
+   CHECK(EEOBJ_PLACE(7,2) == 8);
+   CHECK(EEOBJ_PLACE(7,1) == 7);
+   CHECK(EEOBJ_PLACE(3,9) == 3);                                                //Two pages either way
+   CHECK(EEOBJ_PLACE(1,16) == 8);
+}
+
+//SAVE and LOAD pass the object's address, size and CRC type
+static void test_SaveLoad(void){
+
+   float pi = 3.14159f, piIn = 0;
+   uint64_t bigUn = 0x0123456789ABCDEFULL, bigIn = 0;
+
+   CHECK(EEOBJ_SAVE(pi,&pi) == ERR_NONE);
+   CHECK(test_Call.addr == EEOBJ_pi && test_Call.len == sizeof(float));
+   CHECK(test_Call.crc == LC01B_CRC8 && test_Call.pObj == &pi);
+
+   CHECK(EEOBJ_SAVE(bigUn,&bigUn) == ERR_NONE);
+   CHECK(test_Call.addr == EEOBJ_bigUn && test_Call.len == sizeof(uint64_t));
+   CHECK(test_Call.crc == LC01B_CRC16);
+
+   CHECK(EEOBJ_LOAD(pi,&piIn) == ERR_NONE);
+   CHECK(test_Call.addr == EEOBJ_pi && piIn == pi);
+   CHECK(EEOBJ_LOAD(bigUn,&bigIn) == ERR_NONE);
+   CHECK(bigIn == bigUn);
+
+   test_ReadErr = ERR_CRC;
+   CHECK(EEOBJ_LOAD(pi,&piIn) == ERR_CRC);                                      //Status passes straight through
+   test_ReadErr = ERR_NONE;
+
+#ifdef EEOBJ_FAIL_SIZE
+   {
+      double wide = 0;
+      EEOBJ_SAVE(pi,&wide);                                                     //Wrong size for pi
+   }
+#endif
+}
+
+int main(void){
+
+   test_Layout();
+   test_SaveLoad();
+   return SIM_TEST_END("test_eeobj");
+}
@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * Transaction engine test: lc01b_Service driven one bus event at a time
+ * through start, address, data and stop, the read turnaround, the ack
+ * poll and the NACK paths, then the same transactions from the MI2C1
+ * interrupt, and a re-init dropping queued transactions
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "sim.h"
+#include "simtest.h"
+
+static uint8_t test_Done;
+static lc01b_Xfer_t *test_pLast;
+
+static void test_Callback(lc01b_Xfer_t *pXfer){
+
+   test_Done++;
+   test_pLast = pXfer;
+}
+
+//Power up with the MI2C1 interrupt off; the test is the ISR
+static void test_Boot(void){
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   IEC1bits.MI2C1IE = 0;
+   test_Done = 0;
+   test_pLast = 0;
+}
+
+//Wait for the next bus event and run the engine on it, as the ISR would.
+//Returns the events serviced until the transaction completed
+static uint16_t test_Service(lc01b_Xfer_t *pXfer){
+
+   uint16_t events = 0;
+
+   while(pXfer->busy && events < 1000){
+      while(!IFS1bits.MI2C1IF);
+      IFS1bits.MI2C1IF = 0;
+      lc01b_Service();
+      events++;
+   }
+   return events;
+}
+
+//Page write: start, control, address, data, stop, then ack polls until the
+//write cycle ends
+static void test_Write(void){
+
+   lc01b_Xfer_t xfer;
+   uint8_t data[2] = {0x5A,0xA5};
+   const char *pPoll;
+
+   test_Boot();
+   CHECK(lc01b_WriteAsync(&xfer,0x10,sizeof(data),data,test_Callback) == ERR_NONE);
+   CHECK(xfer.busy);
+   CHECK(I2C1CONbits.SEN);                                                      //Submit starts the bus
+   CHECK(test_Service(&xfer) > 6);
+   CHECK(!xfer.busy && xfer.errCode == ERR_NONE);
+   CHECK(test_Done == 1 && test_pLast == &xfer);
+   CHECK(sim_Eeps[0].mem[0x10] == 0x5A && sim_Eeps[0].mem[0x11] == 0xA5);
+
+   CHECK(strncmp(sim_Trace,"S A0+ 10+ 5A+ A5+ P S A0- P",27) == 0);
+   pPoll = sim_Trace + strlen(sim_Trace) - 8;
+   CHECK(strcmp(pPoll," S A0+ P") == 0);                                        //Final poll ACK'd
+   CHECK(sim_Eeps[0].busyNacks > 0);
+   CHECK(!lc01b_Busy());
+   CHECK(sim_Errors == 0);
+}
+
+//Random read: dummy write of the address, repeated start, control byte in
+//read mode, ACK every byte but the last
+static void test_Read(void){
+
+   lc01b_Xfer_t xfer;
+   uint8_t buf[3];
+
+   test_Boot();
+   sim_Eeps[0].mem[0x20] = 0x01;
+   sim_Eeps[0].mem[0x21] = 0x02;
+   sim_Eeps[0].mem[0x22] = 0x03;
+   CHECK(lc01b_ReadAsync(&xfer,0x20,sizeof(buf),buf,test_Callback) == ERR_NONE);
+   CHECK(test_Service(&xfer) == 12);                                            //One per bus event
+   CHECK(strcmp(sim_Trace,"S A0+ 20+ Sr A1+ <01 A <02 A <03 N P") == 0);
+   CHECK(xfer.errCode == ERR_NONE && test_Done == 1);
+   CHECK(buf[0] == 0x01 && buf[1] == 0x02 && buf[2] == 0x03);
+
+   //Current address read carries on from the pointer
+   sim_ClearCounts();
+   CHECK(lc01b_ReadCurAsync(&xfer,1,buf,test_Callback) == ERR_NONE);
+   test_Service(&xfer);
+   CHECK(strcmp(sim_Trace,"S A1+ <FF N P") == 0);
+   CHECK(sim_Errors == 0);
+}
+
+//NACKs abort with a stop and the matching error
+static void test_Nack(void){
+
+   lc01b_Xfer_t xfer;
+   uint8_t dataByte = 0x77, buf;
+
+   test_Boot();
+   sim_Eeps[0].present = 0;
+   CHECK(lc01b_WriteAsync(&xfer,0x30,1,&dataByte,test_Callback) == ERR_NONE);
+   CHECK(test_Service(&xfer) == 3);
+   CHECK(strcmp(sim_Trace,"S A0- P") == 0);
+   CHECK(xfer.errCode == ERR_CNTL_NACK);
+   CHECK(test_Done == 1);
+
+   sim_Eeps[0].present = 1;
+   sim_ClearCounts();
+   sim_Fault.nackByte = 2;                                                      //Memory address byte
+   CHECK(lc01b_ReadAsync(&xfer,0x30,1,&buf,0) == ERR_NONE);
+   test_Service(&xfer);
+   CHECK(strcmp(sim_Trace,"S A0+ 30- P") == 0);
+   CHECK(xfer.errCode == ERR_MEM_NACK);
+
+   sim_ClearCounts();
+   sim_Fault.nackByte = 3;                                                      //Data byte
+   CHECK(lc01b_WriteAsync(&xfer,0x30,1,&dataByte,0) == ERR_NONE);
+   test_Service(&xfer);
+   CHECK(strcmp(sim_Trace,"S A0+ 30+ 77- P") == 0);
+   CHECK(xfer.errCode == ERR_PAGE_NACK);
+   CHECK(!lc01b_Busy());
+   CHECK(sim_Errors == 0);
+}
+
+//Queued transactions run back to back from the interrupt, callbacks in
+//order, while the main line is free
+static void test_Interrupt(void){
+
+   lc01b_Xfer_t first, second;
+   uint8_t data[8] = {1,2,3,4,5,6,7,8}, buf[8];
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   test_Done = 0;
+   CHECK(lc01b_WriteAsync(&first,0x40,sizeof(data),data,test_Callback) == ERR_NONE);
+   CHECK(lc01b_ReadAsync(&second,0x40,sizeof(buf),buf,test_Callback) == ERR_NONE);
+   CHECK(lc01b_Busy());
+   while(second.busy)
+      sim_Run(100);
+   CHECK(!first.busy && first.errCode == ERR_NONE);
+   CHECK(second.errCode == ERR_NONE && test_pLast == &second && test_Done == 2);
+   CHECK(memcmp(buf,data,sizeof(data)) == 0);
+   CHECK(sim_Cpu.isrs[0] > 20);
+   CHECK(sim_Errors == 0);
+}
+
+//A re-init fails whatever is queued, the transaction cut off on the bus
+//included, and forgets the address pointer of every device. Two 24LC64s,
+//as the 24LC01B answers every chip select
+static void test_Reinit(void){
+
+   lc01b_Xfer_t first, second;
+   lc01b_Dev_t descA = LC01B_DEV_24LC64(0), descB = LC01B_DEV_24LC64(1);
+   uint8_t data[2] = {0x11,0x22}, buf[3];
+   uint8_t events;
+
+   test_Boot();
+   sim_Eeps[0].present = 0;
+   sim_Attach(0,32,8192,2,0,1);
+   sim_Attach(1,32,8192,2,0,1);
+   lc01b_SetDevice(&descA);
+   CHECK(lc01b_ReadAsync(&first,0x20,sizeof(buf),buf,0) == ERR_NONE);
+   test_Service(&first);
+   CHECK(lc01b_ReadDevAsync(&first,&descB,0x100,sizeof(buf),buf,0) == ERR_NONE);
+   test_Service(&first);
+   sim_ClearCounts();
+   CHECK(lc01b_ReadStream(0x23,1,buf) == ERR_NONE);
+   CHECK(sim_Bus.restarts == 0);                                                //Pointer known, no address phase
+
+   CHECK(lc01b_WriteAsync(&first,0x40,sizeof(data),data,test_Callback) == ERR_NONE);
+   CHECK(lc01b_ReadAsync(&second,0x40,sizeof(data),buf,test_Callback) == ERR_NONE);
+   for(events=0; events<4; events++){                                           //Into the first transaction
+      while(!IFS1bits.MI2C1IF);
+      IFS1bits.MI2C1IF = 0;
+      lc01b_Service();
+   }
+   CHECK(first.busy && second.busy);
+   init_I2C(I2C_BRG_400);
+   IEC1bits.MI2C1IE = 0;
+   CHECK(!first.busy && first.errCode == ERR_ABORTED);
+   CHECK(!second.busy && second.errCode == ERR_ABORTED);
+   CHECK(test_Done == 2 && test_pLast == &second);
+   CHECK(!lc01b_Busy());
+
+   //Both devices are addressed again
+   sim_ClearCounts();
+   CHECK(lc01b_ReadStream(0x24,1,buf) == ERR_NONE);
+   CHECK(sim_Bus.restarts == 1 && buf[0] == 0xFF);
+   lc01b_SetDevice(&descB);
+   sim_ClearCounts();
+   CHECK(lc01b_ReadStream(0x103,1,buf) == ERR_NONE);
+   CHECK(sim_Bus.restarts == 1);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Write();
+   test_Read();
+   test_Nack();
+   test_Interrupt();
+   test_Reinit();
+   return SIM_TEST_END("test_engine");
+}
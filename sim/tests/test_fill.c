@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Pattern fill and verify: lc01b_Fill and lc01b_Verify on the simulated
+ * 24LC01B, and obee_Fill and obee_Verify on the NVM model, with the bulk
+ * erase taken only for the exact whole memory range
+ * *****************************************************************************/
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "sim.h"
+#include "simtest.h"
+
+static void test_Boot(void){
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   obee_Init();
+}
+
+//Non-zero if the NVM words from offset on all hold the pattern
+static uint8_t test_Words(uint16_t offset, uint16_t len, uint16_t pattern){
+
+   uint16_t pos;
+
+   for(pos=offset; pos<offset + len; pos+=WORD_LEN){
+      if(sim_Nvm.words[pos/WORD_LEN] != pattern)
+         return 0;
+   }
+   return 1;
+}
+
+//NVM cycles of every kind
+static uint32_t test_NvmCycles(void){
+
+   uint32_t total = 0;
+   uint8_t kind;
+
+   for(kind=0; kind<SIM_NVM_KINDS; kind++)
+      total += sim_Nvm.cycles[kind];
+   return total;
+}
+
+//A three byte pattern across part pages, read back in one sequential read
+static void test_Lc01b(void){
+
+   uint8_t pat[3] = {0x12,0x34,0x56}, zero = 0x00;
+   uint16_t idx, mismatch = 0;
+   sim_Eep_t *pEep = &sim_Eeps[0];
+
+   test_Boot();
+   CHECK(lc01b_Fill(0x05,40,pat,sizeof(pat)) == ERR_NONE);
+   for(idx=0; idx<40; idx++)
+      CHECK(pEep->mem[0x05 + idx] == pat[idx % sizeof(pat)]);
+   CHECK(pEep->mem[0x04] == 0xFF && pEep->mem[0x2D] == 0xFF);
+   CHECK(pEep->writeCycles == 6 && pEep->bytesWritten == 40);                   //Part pages at both ends
+
+   sim_ClearCounts();
+   CHECK(lc01b_Verify(0x05,40,pat,sizeof(pat),&mismatch) == ERR_NONE);
+   CHECK(mismatch == LC01B_NO_MISMATCH);
+   CHECK(pEep->bytesRead == 40 && sim_Bus.restarts == 1);
+
+   pEep->mem[0x17] ^= 0x01;
+   CHECK(lc01b_Verify(0x05,40,pat,sizeof(pat),&mismatch) == ERR_VERIFY);
+   CHECK(mismatch == 0x17);
+   CHECK(lc01b_Verify(0x05,40,pat,sizeof(pat),0) == ERR_VERIFY);
+   CHECK(lc01b_Verify(0x05,0x12,pat,sizeof(pat),&mismatch) == ERR_NONE);        //Stops short of it
+
+   //Empty pattern and range checks, nothing on the bus
+   sim_ClearCounts();
+   CHECK(lc01b_Fill(0x05,40,pat,0) == ERR_ARG);
+   CHECK(lc01b_Verify(0x05,40,pat,0,&mismatch) == ERR_ARG);
+   CHECK(lc01b_Fill(LC01B_CAP - 4,8,pat,sizeof(pat)) == ERR_MEM_BOUNDS);
+   CHECK(sim_Bus.starts == 0);
+
+   //Zeroize the whole part from one byte
+   CHECK(lc01b_Fill(0x00,LC01B_CAP,&zero,1) == ERR_NONE);
+   CHECK(pEep->writeCycles == LC01B_CAP / LC01B_PAGE);
+   CHECK(lc01b_Verify(0x00,LC01B_CAP,&zero,1,&mismatch) == ERR_NONE);
+   CHECK(sim_Errors == 0);
+}
+
+//Bulk erase only for offset 0 and exactly 512 bytes; everything else is
+//planned per 8 word block
+static void test_Obee(void){
+
+   test_Boot();
+   obee_Fill(OFFSET_ZERO,OFFSET_LAST + 1,0xA5A5);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_BULK] == 1);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == (OFFSET_LAST + 1) / WORD_LEN);
+   CHECK(test_Words(OFFSET_ZERO,OFFSET_LAST + 1,0xA5A5));
+   CHECK(obee_Verify(OFFSET_ZERO,OFFSET_LAST + 1,0xA5A5) == OBEE_NO_MISMATCH);
+
+   //Matching words cost nothing
+   sim_ClearCounts();
+   obee_Fill(WORD_LEN,OFFSET_LAST + 1 - WORD_LEN,0xA5A5);
+   CHECK(test_NvmCycles() == 0);
+
+   //All but the first word: no bulk erase. Block 0 is erased in a single
+   //word for each of words 1-3 and a four word erase, the rest in eights
+   sim_ClearCounts();
+   obee_Fill(WORD_LEN,OFFSET_LAST + 1 - WORD_LEN,0x5A5A);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_BULK] == 0);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_EIGHT] == (OFFSET_LAST + 1) / (ERASE_ROW*WORD_LEN) - 1);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_FOUR] == 1 && sim_Nvm.cycles[SIM_NVM_ERASE_ONE] == 3);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == (OFFSET_LAST + 1) / WORD_LEN - 1);
+   CHECK(sim_Nvm.words[0] == 0xA5A5 && test_Words(WORD_LEN,OFFSET_LAST + 1 - WORD_LEN,0x5A5A));
+   CHECK(obee_Verify(OFFSET_ZERO,OFFSET_LAST + 1,0x5A5A) == OFFSET_ZERO);
+   CHECK(obee_Verify(WORD_LEN,OFFSET_LAST + 1 - WORD_LEN,0x5A5A) == OBEE_NO_MISMATCH);
+
+   //0xFFFF needs the erase alone
+   sim_ClearCounts();
+   obee_Fill(16,32,0xFFFF);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_EIGHT] == 2);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == 0 && sim_Nvm.cycles[SIM_NVM_WRITE_ER] == 0);
+   CHECK(obee_Verify(OFFSET_ZERO,OFFSET_LAST + 1,0x5A5A) == OFFSET_ZERO);
+   CHECK(obee_Verify(WORD_LEN,OFFSET_LAST + 1 - WORD_LEN,0x5A5A) == 16);
+
+   //Programming alone reaches a pattern that only clears bits
+   sim_ClearCounts();
+   obee_Fill(20,6,0x1234);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == 3 && test_NvmCycles() == 3);
+   CHECK(obee_Verify(20,6,0x1234) == OBEE_NO_MISMATCH);
+   CHECK(obee_Verify(16,32,0xFFFF) == 20);
+   CHECK(sim_Nvm.words[9] == 0xFFFF && sim_Nvm.words[13] == 0xFFFF);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Lc01b();
+   test_Obee();
+   return SIM_TEST_END("test_fill");
+}
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * Key/value record store on the simulated 24LC01B: set, get, overwrite,
+ * remount from the part, a torn record skipped on mount, compaction of a
+ * static key at KVS_AGE_MAX and the index and length limits
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "lc01bkvs.h"
+#include "sim.h"
+#include "simtest.h"
+
+//Place a record straight into the part, with a bad check byte if torn
+static void test_Record(uint8_t page, uint8_t key, uint8_t seq, uint8_t value, uint8_t torn){
+
+   uint8_t *pRec = &sim_Eeps[0].mem[page*LC01B_PAGE];
+   uint8_t sum = 0, idx;
+
+   memset(pRec,0,LC01B_PAGE);
+   pRec[KVS_KEY] = key;
+   pRec[KVS_SEQ] = seq;
+   pRec[KVS_LEN] = 1;
+   pRec[KVS_DATA] = value;
+   for(idx=0; idx<KVS_CHECK; idx++)
+      sum += pRec[idx];
+   pRec[KVS_CHECK] = ~sum + (torn ? 1 : 0);
+}
+
+//Pages holding a record of the key, and the page of the newest one
+static uint8_t test_Pages(uint8_t key, uint8_t *pNewest){
+
+   uint8_t page, count = 0;
+   uint8_t *pRec;
+
+   for(page=0; page<KVS_PAGES; page++){
+      pRec = &sim_Eeps[0].mem[page*LC01B_PAGE];
+      if(pRec[KVS_KEY] != key)
+         continue;
+      if(!count || (int8_t)(pRec[KVS_SEQ] - sim_Eeps[0].mem[*pNewest*LC01B_PAGE + KVS_SEQ]) > 0)
+         *pNewest = page;
+      count++;
+   }
+   return count;
+}
+
+//Set, get and overwrite; a torn newer record is ignored on mount and its
+//page is the next append
+static void test_PutGet(void){
+
+   uint8_t one[4] = {1,2,3,4}, two = 9, over[2] = {5,6}, out[4];
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Get(1,sizeof(out),out) == ERR_NO_KEY);
+
+   CHECK(kvs_Put(1,sizeof(one),one) == ERR_NONE);
+   CHECK(kvs_Put(2,1,&two) == ERR_NONE);
+   CHECK(kvs_Get(1,sizeof(out),out) == ERR_NONE && memcmp(out,one,4) == 0);
+   CHECK(kvs_Get(2,1,out) == ERR_NONE && out[0] == 9);
+   CHECK(sim_Eeps[0].mem[KVS_KEY] == 1 && sim_Eeps[0].mem[KVS_LEN] == 4);
+   CHECK(sim_Eeps[0].mem[LC01B_PAGE + KVS_KEY] == 2 && sim_Eeps[0].mem[LC01B_PAGE + KVS_SEQ] == 1);
+
+   //Overwrite appends; the first record is left in place
+   CHECK(kvs_Put(1,sizeof(over),over) == ERR_NONE);
+   CHECK(sim_Eeps[0].writeCycles == 3);
+   CHECK(sim_Eeps[0].mem[2*LC01B_PAGE + KVS_SEQ] == 2 && sim_Eeps[0].mem[KVS_DATA] == 1);
+   memset(out,0,sizeof(out));
+   CHECK(kvs_Get(1,sizeof(out),out) == ERR_NONE);
+   CHECK(out[0] == 5 && out[1] == 6 && out[2] == 0);                            //Only the stored length is copied
+
+   //Remount streams the part through one page buffer
+   test_Record(3,1,3,0x77,1);
+   sim_ClearCounts();
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(sim_Eeps[0].bytesRead == LC01B_CAP);
+   CHECK(kvs_Get(1,sizeof(out),out) == ERR_NONE && out[0] == 5);
+   CHECK(kvs_Get(2,1,out) == ERR_NONE && out[0] == 9);
+
+   //A well formed newer record is picked up
+   test_Record(3,2,3,0x42,0);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Get(2,1,out) == ERR_NONE && out[0] == 0x42);
+
+   //Torn again; the head follows the newest good record, so the torn page
+   //is written over next
+   test_Record(3,2,3,0x42,1);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Get(2,1,out) == ERR_NONE && out[0] == 9);
+   two = 10;
+   CHECK(kvs_Put(2,1,&two) == ERR_NONE);
+   CHECK(sim_Eeps[0].mem[3*LC01B_PAGE + KVS_KEY] == 2 && sim_Eeps[0].mem[3*LC01B_PAGE + KVS_SEQ] == 3);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Get(2,1,out) == ERR_NONE && out[0] == 10);
+   CHECK(sim_Errors == 0);
+}
+
+//A key that is never written again is moved forward once KVS_AGE_MAX
+//appends have passed it, and its old page rejoins the rotation
+static void test_Compact(void){
+
+   uint8_t value = 7, out = 0, newest = 0;
+   uint16_t seq;
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Put(1,1,&value) == ERR_NONE);                                      //Sequence 0, page 0
+   CHECK(kvs_Put(2,1,&value) == ERR_NONE);                                      //Sequence 1, page 1
+
+   //Appends up to sequence KVS_AGE_MAX leave key 2 where it is; the next
+   //one moves it
+   for(seq=2; seq<=KVS_AGE_MAX; seq++)
+      CHECK(kvs_Put(1,1,&value) == ERR_NONE);
+   CHECK(test_Pages(2,&newest) == 1 && newest == 1);
+   CHECK(kvs_Put(1,1,&value) == ERR_NONE);
+   CHECK(test_Pages(2,&newest) == 2 && newest != 1);
+   CHECK(sim_Eeps[0].mem[newest*LC01B_PAGE + KVS_SEQ] == KVS_AGE_MAX + 2);
+   CHECK(kvs_Get(2,1,&out) == ERR_NONE && out == 7);
+
+   //One lap later page 1 has been reused
+   for(seq=0; seq<KVS_PAGES; seq++)
+      CHECK(kvs_Put(1,1,&value) == ERR_NONE);
+   CHECK(sim_Eeps[0].mem[LC01B_PAGE + KVS_KEY] == 1);
+   CHECK(kvs_Mount() == ERR_NONE);
+   out = 0;
+   CHECK(kvs_Get(2,1,&out) == ERR_NONE && out == 7);
+   CHECK(sim_Errors == 0);
+}
+
+//Reserved keys, long values and a full index
+static void test_Limits(void){
+
+   uint8_t value[KVS_MAX_LEN + 1] = {0}, key;
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   CHECK(kvs_Mount() == ERR_NONE);
+   CHECK(kvs_Put(0x00,1,value) == ERR_MEM_BOUNDS);
+   CHECK(kvs_Put(0xFF,1,value) == ERR_MEM_BOUNDS);
+   CHECK(kvs_Put(1,KVS_MAX_LEN + 1,value) == ERR_MEM_BOUNDS);
+   for(key=1; key<=KVS_MAX_KEYS; key++)
+      CHECK(kvs_Put(key,KVS_MAX_LEN,value) == ERR_NONE);
+   CHECK(kvs_Put(key,1,value) == ERR_KEYS_FULL);
+   CHECK(kvs_Put(1,1,value) == ERR_NONE);                                       //Known keys still update
+   CHECK(sim_Eeps[0].writeCycles == KVS_MAX_KEYS + 1);
+}
+
+int main(void){
+
+   test_PutGet();
+   test_Compact();
+   test_Limits();
+   return SIM_TEST_END("test_kvs");
+}
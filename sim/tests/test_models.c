@@ -0,0 +1,441 @@
+/*******************************************************************************
+ * Simulator self test: the 24LC01B and NVM models and every injectable
+ * fault, driven through lc01b.c, obeeprom.c and eemirror.c
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eemirror.h"
+#include "sim.h"
+#include "simtest.h"
+
+#define CYCLES_PER_US (FCY / 1000000UL)
+
+//Power up with the drivers initialised. With polled set the MI2C1
+//interrupt is left off and the waiting callers run the engine
+static void test_Boot(uint16_t brg, uint8_t polled){
+
+   sim_Reset();
+   init_I2C(brg);
+   obee_Init();
+   if(polled)
+      IEC1bits.MI2C1IE = 0;
+}
+
+//Wait out a bus event the test started itself
+static void test_Idle(void){
+
+   while(I2C1CONbits.SEN || I2C1CONbits.PEN || I2C1CONbits.RSEN || I2C1CONbits.RCEN
+         || I2C1CONbits.ACKEN || I2C1STATbits.TRSTAT);
+}
+
+//Raw page write: address, data and stop, no polling
+static uint8_t test_RawWrite(uint8_t ee_addr, uint8_t len, const uint8_t *pData){
+
+   uint8_t idx, nack;
+
+   if(lc01b_SCM(ee_addr) != ERR_NONE)
+      return 1;
+   for(idx=0; idx<len; idx++){
+      I2C1TRN = pData[idx];
+      test_Idle();
+   }
+   nack = I2C1STATbits.ACKSTAT;
+   I2C1CONbits.PEN = 1;
+   test_Idle();
+   return nack;
+}
+
+//Raw control byte. Returns non-zero if it was NACK'd
+static uint8_t test_RawPoll(void){
+
+   uint8_t nack;
+
+   I2C1CONbits.SEN = 1;
+   test_Idle();
+   I2C1TRN = LC01B_WRITE;
+   test_Idle();
+   nack = I2C1STATbits.ACKSTAT;
+   I2C1CONbits.PEN = 1;
+   test_Idle();
+   return nack;
+}
+
+//Page latch wraps within its page; the stop starts the write cycle and the
+//part NACKs until it is over
+static void test_PageLatch(void){
+
+   sim_Eep_t *pEep = &sim_Eeps[0];
+   uint8_t data[4] = {0x11,0x22,0x33,0x44};
+   uint64_t t0;
+
+   test_Boot(I2C_BRG_100,1);
+   CHECK(test_RawWrite(0x0E,4,data) == 0);
+   t0 = sim_Now();
+   CHECK(pEep->mem[0x0E] == 0x11 && pEep->mem[0x0F] == 0x22);
+   CHECK(pEep->mem[0x08] == 0x33 && pEep->mem[0x09] == 0x44);                   //Wrapped to the page start
+   CHECK(pEep->mem[0x10] == 0xFF);
+   CHECK(pEep->writeCycles == 1);
+
+   CHECK(test_RawPoll() != 0);                                                  //Busy
+   CHECK(pEep->busyNacks == 1);
+   sim_Run(pEep->twcUs * CYCLES_PER_US - (sim_Now() - t0));
+   CHECK(test_RawPoll() == 0);                                                  //Write cycle over
+
+   //Address alone moves the pointer without a write cycle
+   CHECK(test_RawWrite(0x20,0,data) == 0);
+   CHECK(pEep->writeCycles == 1);
+   CHECK(pEep->ptr == 0x20);
+   CHECK(sim_Errors == 0);
+}
+
+//Sequential reads wrap at the end of the part; current address reads
+//carry on from the pointer
+static void test_Reads(void){
+
+   sim_Eep_t *pEep = &sim_Eeps[0];
+   uint8_t buf[8], idx;
+
+   test_Boot(I2C_BRG_400,0);
+   for(idx=0; idx<LC01B_CAP; idx++)
+      pEep->mem[idx] = idx ^ 0xA5;
+
+   CHECK(lc01b_ReadSeq(0x7C,4,buf) == ERR_NONE);
+   CHECK(buf[0] == (0x7C ^ 0xA5) && buf[3] == (0x7F ^ 0xA5));
+   CHECK(lc01b_ReadCur(4,buf) == ERR_NONE);                                     //Pointer wraps to 0x00
+   CHECK(buf[0] == (0x00 ^ 0xA5) && buf[3] == (0x03 ^ 0xA5));
+   CHECK(pEep->bytesRead == 8);
+   CHECK(sim_Errors == 0);
+}
+
+//Driver writes: one write cycle per page touched, each ack polled to the
+//end of its write cycle
+static void test_Writes(void){
+
+   sim_Eep_t *pEep = &sim_Eeps[0];
+   uint8_t data[20], idx;
+   uint64_t t0;
+
+   test_Boot(I2C_BRG_100,0);
+   for(idx=0; idx<sizeof(data); idx++)
+      data[idx] = idx + 1;
+   t0 = sim_Now();
+   CHECK(lc01b_Write(0x03,sizeof(data),data) == ERR_NONE);
+   CHECK(memcmp(pEep->mem + 0x03,data,sizeof(data)) == 0);
+   CHECK(pEep->writeCycles == 3);                                               //0x03-0x07, 0x08-0x0F, 0x10-0x16
+   CHECK(pEep->busyNacks > 0);
+   CHECK(sim_Now() - t0 >= 3 * pEep->twcUs * CYCLES_PER_US);
+   CHECK(sim_Errors == 0);
+}
+
+//NVM erase granularity, program-only and cycle time
+static void test_Nvm(void){
+
+   uint64_t t0;
+   uint16_t idx;
+
+   test_Boot(I2C_BRG_100,0);
+   for(idx=0; idx<16; idx++)
+      sim_Nvm.words[idx] = idx;
+
+   t0 = sim_Now();
+   obee_Erase(EE_ERASE_FOUR,26);                                                //Word 13; erases 12-15
+   CHECK(sim_Now() - t0 >= sim_Nvm.cycleUs[SIM_NVM_ERASE_FOUR] * CYCLES_PER_US);
+   CHECK(sim_Nvm.words[11] == 11 && sim_Nvm.words[12] == 0xFFFF && sim_Nvm.words[15] == 0xFFFF);
+   obee_Erase(EE_ERASE_EIGHT,0);
+   CHECK(sim_Nvm.words[0] == 0xFFFF && sim_Nvm.words[7] == 0xFFFF && sim_Nvm.words[8] == 8);
+   obee_Erase(EE_ERASE_ONE,16);
+   CHECK(sim_Nvm.words[8] == 0xFFFF && sim_Nvm.words[9] == 9);
+   CHECK(sim_Nvm.wear[8] == 1 && sim_Nvm.wear[12] == 1 && sim_Nvm.wear[9] == 0);
+
+   obee_Write(EE_WRITE_ER,20,0xF0F0);
+   CHECK(obee_Read(20) == 0xF0F0);
+   obee_Write(EE_WRITE_NOE,20,0x00FF);                                          //Only clears bits
+   CHECK(obee_Read(20) == 0x00F0);
+   obee_Erase(EE_ERASE_BULK,0);
+   CHECK(sim_Nvm.words[0] == 0xFFFF && sim_Nvm.words[255] == 0xFFFF);
+   CHECK(sim_Nvm.cycles[SIM_NVM_ERASE_FOUR] == 1 && sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == 1);
+   CHECK(sim_Errors == 0);
+}
+
+//Injected NACKs land on the control, address and data bytes in turn
+static void test_Nacks(uint8_t polled){
+
+   test_Boot(I2C_BRG_100,polled);
+   sim_Fault.nackByte = 1;
+   CHECK(lc01b_WriteByte(0x10,0x5A) == ERR_CNTL_NACK);
+   sim_Fault.nackByte = 2;
+   CHECK(lc01b_WriteByte(0x10,0x5A) == ERR_MEM_NACK);
+   sim_Fault.nackByte = 3;
+   CHECK(lc01b_WriteByte(0x10,0x5A) == ERR_PAGE_NACK);
+   CHECK(sim_Eeps[0].mem[0x10] == 0xFF);
+   CHECK(lc01b_WriteByte(0x10,0x5A) == ERR_NONE);
+   CHECK(sim_Eeps[0].mem[0x10] == 0x5A);
+
+   sim_Eeps[0].present = 0;                                                     //Nobody home
+   CHECK(lc01b_WriteByte(0x10,0x5A) == ERR_CNTL_NACK);
+   CHECK(sim_Errors == 0);
+}
+
+//Stuck SDA ends in a collision and is clocked free; a stalled event times
+//out. Either way the bus works again afterwards
+static void test_BusFaults(uint8_t polled){
+
+   lc01b_Xfer_t first, second;
+   uint8_t dataByte;
+
+   test_Boot(I2C_BRG_100,polled);
+   sim_Fault.sdaStuck = 9;
+   CHECK(lc01b_WriteByte(0x20,0x01) == ERR_BUS_COLLISION);
+   CHECK(sim_Fault.sdaStuck == 0);
+   CHECK(sim_Bus.recoveries == 1);
+   CHECK(lc01b_WriteByte(0x20,0x02) == ERR_NONE);
+
+   sim_Fault.collisions = 1;
+   CHECK(lc01b_ReadByte(0x20,&dataByte) == ERR_BUS_COLLISION);
+   CHECK(lc01b_ReadByte(0x20,&dataByte) == ERR_NONE && dataByte == 0x02);
+
+   sim_Fault.stall = 1;
+   CHECK(lc01b_WriteByte(0x21,0x03) == ERR_BUS_TIMEOUT);
+   CHECK(lc01b_WriteByte(0x21,0x04) == ERR_NONE);
+   CHECK(sim_Eeps[0].mem[0x21] == 0x04);
+
+   //A failed transaction holds the queue until the main line recovers
+   //the bus; the one behind it then runs
+   sim_ClearCounts();
+   sim_Fault.collisions = 1;
+   CHECK(lc01b_ReadAsync(&first,0x20,1,&dataByte,0) == ERR_NONE);
+   CHECK(lc01b_WriteAsync(&second,0x22,1,&dataByte,0) == ERR_NONE);
+   CHECK(lc01b_Wait(&second) == ERR_NONE);
+   CHECK(first.errCode == ERR_BUS_COLLISION);
+   CHECK(sim_Bus.recoveries == 1);
+   CHECK(I2C1BRG == I2C_BRG_100 && I2C1CON == 0x8000);                          //Set up again as init_I2C left it
+   CHECK(sim_Errors == 0);
+}
+
+//Write cycles up to the 5ms maximum are polled out; longer ones and a
+//part stuck in its write cycle run out the poll limit
+static void test_WriteCycles(void){
+
+   sim_Eep_t *pEep = &sim_Eeps[0];
+
+   test_Boot(I2C_BRG_400,0);
+   pEep->twcUs = LC01B_TWC_US;
+   CHECK(lc01b_WriteByte(0x30,0x11) == ERR_NONE);
+   pEep->twcUs = 4 * LC01B_TWC_US;
+   CHECK(lc01b_WriteByte(0x31,0x22) == ERR_CNTL_NACK);
+   sim_Run((uint64_t)pEep->twcUs * CYCLES_PER_US);
+   pEep->twcUs = LC01B_TWC_US;
+   CHECK(lc01b_WriteByte(0x31,0x22) == ERR_NONE);
+
+   pEep->stuck = 1;
+   CHECK(lc01b_WriteByte(0x32,0x33) == ERR_CNTL_NACK);
+   CHECK(pEep->mem[0x32] == 0x33);                                              //Written; the part never comes back
+   CHECK(sim_Errors == 0);
+}
+
+//Bit errors on the way in are caught by the object CRC; unknown CRC types
+//are refused
+static void test_BitErrors(void){
+
+   uint32_t value = 0x12345678, back = 0;
+
+   test_Boot(I2C_BRG_400,0);
+   CHECK(lc01b_WriteObjectCrc(0x40,sizeof(value),&value,LC01B_CRC16) == ERR_NONE);
+   sim_Fault.rxErrByte = 2;
+   sim_Fault.rxErrMask = 0x10;
+   CHECK(lc01b_ReadObjectCrc(0x40,sizeof(value),&back,LC01B_CRC16) == ERR_CRC);
+   CHECK(lc01b_ReadObjectCrc(0x40,sizeof(value),&back,LC01B_CRC16) == ERR_NONE);
+   CHECK(back == value);
+
+   //Only CRC-8 and CRC-16 are known; nothing goes on the bus otherwise
+   sim_ClearCounts();
+   CHECK(lc01b_WriteObjectCrc(0x40,sizeof(value),&value,0) == ERR_ARG);
+   CHECK(lc01b_WriteObjectCrc(0x40,sizeof(value),&value,LC01B_CRC16 + 1) == ERR_ARG);
+   CHECK(lc01b_ReadObjectCrc(0x40,sizeof(value),&back,LC01B_CRC16 + 1) == ERR_ARG);
+   CHECK(sim_Bus.starts == 0);
+   CHECK(lc01b_Crc(LC01B_CRC16 + 1,0x1234,&value,sizeof(value)) == 0x1234);
+   CHECK(sim_Errors == 0);
+}
+
+//A failed NVM cycle leaves the word alone
+static void test_NvmFault(void){
+
+   test_Boot(I2C_BRG_100,0);
+   obee_Write(EE_WRITE_ER,40,0x1234);
+   sim_Fault.nvmFail = 1;
+   obee_Write(EE_WRITE_ER,40,0xABCD);
+   CHECK(sim_Nvm.failed == 1);
+   CHECK(NVMCONbits.WRERR);
+   CHECK(sim_Nvm.words[20] == 0x1234);
+   CHECK(sim_Errors == 0);
+}
+
+//A read racing the NVM interrupt sees the queued data or the programmed
+//word, never the old contents. The phase of the read loop against the end
+//of the cycle is swept so the completion lands inside obee_Read
+static void test_NvmReadRace(void){
+
+   obee_Op_t op;
+   uint16_t data = 0x1234, phase, stale = 0;
+
+   for(phase=0; phase<16; phase++){
+      test_Boot(I2C_BRG_100,0);
+      obee_WriteAsync(&op,EE_WRITE_ER,60,WORD_LEN,&data,0);
+      sim_Run(SIM_ACCESS_CYCLES);                                               //Kick dispatches the cycle
+      sim_Run(phase * SIM_ACCESS_CYCLES);
+      while(op.busy)
+         if(obee_Read(60) != data)
+            stale++;
+   }
+   CHECK(stale == 0);
+   CHECK(sim_Errors == 0);
+}
+
+//LC01B -> NVM copy over a partly written range: erases only where bits
+//must rise, every word programmed without erase
+static void test_Mirror(void){
+
+   uint16_t idx, word, erased = 0;
+
+   test_Boot(I2C_BRG_400,0);
+   for(idx=0; idx<LC01B_CAP; idx++)
+      sim_Eeps[0].mem[idx] = idx * 7;
+   obee_Write(EE_WRITE_ER,0,0x0000);                                            //Needs an erase
+   obee_Write(EE_WRITE_ER,2,0x1F0F);                                            //Covers 0x150E; no erase
+   sim_ClearCounts();
+
+   CHECK(mirror_Lc01bToNvm(0,OFFSET_ZERO,LC01B_CAP) == ERR_NONE);
+   for(idx=0; idx<LC01B_CAP; idx+=WORD_LEN){
+      word = sim_Eeps[0].mem[idx] | (sim_Eeps[0].mem[idx+1] << 8);
+      if(sim_Nvm.words[idx / WORD_LEN] != word)
+         break;
+   }
+   CHECK(idx == LC01B_CAP);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_ER] == 0);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_NOE] == LC01B_CAP / WORD_LEN);
+   for(idx=0; idx<LC01B_CAP / WORD_LEN; idx++)
+      erased += sim_Nvm.wear[idx];
+   CHECK(erased == 1);                                                          //Word 0 alone
+
+   //A failed erase and a failed program cycle are both reported
+   obee_Write(EE_WRITE_ER,0,0x0000);
+   sim_Fault.nvmFail = 1;
+   CHECK(mirror_Lc01bToNvm(0,OFFSET_ZERO,LC01B_CAP) == ERR_NVM_WRITE);
+   CHECK(sim_Nvm.words[0] == 0x0000);
+   sim_Fault.nvmFail = 3;                                                       //Erase, then the second word
+   CHECK(mirror_Lc01bToNvm(0,OFFSET_ZERO,LC01B_CAP) == ERR_NVM_WRITE);
+   CHECK(sim_Nvm.failed == 2);
+   CHECK(mirror_Lc01bToNvm(0,OFFSET_ZERO,LC01B_CAP) == ERR_NONE);
+   CHECK(sim_Errors == 0);
+}
+
+//Differential writes rewrite only changed pages. A 32 byte 24LC64 page is
+//compared LC01B_DIFF_BUF bytes at a time
+static void test_WriteDiff(void){
+
+   lc01b_Dev_t desc = LC01B_DEV_24LC64(0);
+   uint8_t data[64];
+   uint16_t skipped;
+   sim_Eep_t *pEep;
+
+   test_Boot(I2C_BRG_400,0);
+   memset(data,0x11,sizeof(data));
+   memset(sim_Eeps[0].mem,0x11,32);
+   data[21] = 0x22;
+   CHECK(lc01b_WriteDiff(4,28,data,&skipped) == ERR_NONE);
+   CHECK(skipped == 3 && sim_Eeps[0].writeCycles == 1);                         //4 + 3 pages, one changed
+   CHECK(sim_Eeps[0].mem[25] == 0x22);
+
+   sim_Eeps[0].present = 0;
+   pEep = sim_Attach(0,32,8192,2,0,1);
+   lc01b_SetDevice(&desc);
+   memset(&pEep->mem[0x100],0x11,sizeof(data));
+   data[21] = 0x11;
+   data[63] = 0x33;                                                             //Last piece of the second page
+   CHECK(lc01b_WriteDiff(0x100,sizeof(data),data,&skipped) == ERR_NONE);
+   CHECK(skipped == 1 && pEep->writeCycles == 1);
+   CHECK(pEep->mem[0x13F] == 0x33);
+   CHECK(memcmp(&pEep->mem[0x100],data,sizeof(data)) == 0);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+//Copies on a 24LC64: 16-bit addresses, lengths past 255 and 32 byte pages
+//from the descriptor
+static void test_MirrorDev(void){
+
+   lc01b_Dev_t desc = LC01B_DEV_24LC64(0);
+   uint16_t idx, word, len = 300;
+   sim_Eep_t *pEep;
+
+   test_Boot(I2C_BRG_400,0);
+   sim_Eeps[0].present = 0;
+   pEep = sim_Attach(0,32,8192,2,0,1);
+   lc01b_SetDevice(&desc);
+   for(idx=0; idx<len; idx++)
+      pEep->mem[0x1000 + idx] = idx * 3;
+
+   CHECK(mirror_Lc01bToNvm(0x1000,OFFSET_ZERO,len) == ERR_NONE);
+   for(idx=0; idx<len; idx+=WORD_LEN){
+      word = pEep->mem[0x1000 + idx] | (pEep->mem[0x1000 + idx + 1] << 8);
+      if(sim_Nvm.words[idx / WORD_LEN] != word)
+         break;
+   }
+   CHECK(idx == len);
+
+   sim_ClearCounts();
+   CHECK(mirror_NvmToLc01b(OFFSET_ZERO,0x1F4,len) == ERR_NONE);
+   CHECK(memcmp(&pEep->mem[0x1F4],&pEep->mem[0x1000],len) == 0);
+   CHECK(pEep->writeCycles == 38);                                              //8 and 4 bytes up to 0x200, then 36 chunks
+   CHECK(pEep->mem[0x1F3] == 0xFF && pEep->mem[0x1F4 + len] == 0xFF);
+
+   CHECK(mirror_Lc01bToNvm(0x1F00,OFFSET_ZERO,0x100 + WORD_LEN) == ERR_MEM_BOUNDS);
+   CHECK(mirror_NvmToLc01b(OFFSET_ZERO,0x1FFF,2) == ERR_MEM_BOUNDS);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+//Speed calibration. A corrupt read back in the 100kHz pass is a verify
+//failure, and the scratch bytes go back all the same
+static void test_Calibrate(void){
+
+   uint8_t saved[LC01B_CAL_LEN] = {9,8,7,6,5,4,3,2};
+   uint16_t brg;
+
+   test_Boot(I2C_BRG_100,0);
+   memcpy(&sim_Eeps[0].mem[0x40],saved,sizeof(saved));
+   CHECK(lc01b_Calibrate(0x40,&brg) == ERR_NONE);
+   CHECK(brg == I2C_BRG_1000);
+   CHECK(memcmp(&sim_Eeps[0].mem[0x40],saved,sizeof(saved)) == 0);
+
+   sim_Fault.rxErrByte = LC01B_CAL_LEN + 1;                                     //First byte read back
+   sim_Fault.rxErrMask = 0x01;
+   CHECK(lc01b_Calibrate(0x40,&brg) == ERR_VERIFY);
+   CHECK(brg == I2C_BRG_100);
+   CHECK(memcmp(&sim_Eeps[0].mem[0x40],saved,sizeof(saved)) == 0);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_PageLatch();
+   test_Reads();
+   test_Writes();
+   test_Nvm();
+   test_Nacks(0);
+   test_Nacks(1);
+   test_BusFaults(0);
+   test_BusFaults(1);
+   test_WriteCycles();
+   test_BitErrors();
+   test_NvmFault();
+   test_NvmReadRace();
+   test_WriteDiff();
+   test_Mirror();
+   test_MirrorDev();
+   test_Calibrate();
+   return SIM_TEST_END("test_models");
+}
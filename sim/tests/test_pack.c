@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * Sample packing test: pack_Put and pack_Flush into a stubbed 24LC01B, then
+ * pack_Read and pack_DecFrame back out across 16-bit wrap-around, key
+ * frames, corrupt frames and a part written log. Built without the drivers
+ * *****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "eepack.h"
+#include "simtest.h"
+
+#define TEST_FRAMES (LC01B_CAP / PACK_FRAME)
+
+//Stub device: one page write or streaming read per call
+static lc01b_Dev_t test_Dev = LC01B_DEV_24LC01B;
+static uint8_t test_Mem[LC01B_CAP];
+static uint16_t test_Writes;
+static ee_Errors_t test_WriteErr;
+
+lc01b_Dev_t *lc01b_GetDevice(void){
+
+   return &test_Dev;
+}
+
+ee_Errors_t lc01b_WritePage(uint16_t ee_addr,uint16_t dataLen,uint8_t *pDataBuf){
+
+   if(test_WriteErr)
+      return test_WriteErr;
+   else if(ee_addr / LC01B_PAGE != (ee_addr + dataLen - 1) / LC01B_PAGE)
+      return ERR_PAGE_BOUNDS;
+   memcpy(&test_Mem[ee_addr],pDataBuf,dataLen);
+   test_Writes++;
+   return ERR_NONE;
+}
+
+ee_Errors_t lc01b_ReadStream(uint16_t ee_addr,uint16_t readLen,uint8_t *pDataBuf){
+
+   if((uint32_t)ee_addr + readLen > LC01B_CAP)
+      return ERR_MEM_BOUNDS;
+   memcpy(pDataBuf,&test_Mem[ee_addr],readLen);
+   return ERR_NONE;
+}
+
+//Blank part, fresh log over all of it
+static void test_Boot(pack_Enc_t *pEnc){
+
+   memset(test_Mem,PACK_BLANK,sizeof(test_Mem));
+   test_Writes = 0;
+   test_WriteErr = ERR_NONE;
+   CHECK(pack_EncInit(pEnc,0,LC01B_CAP) == ERR_NONE);
+}
+
+//Ramp of 1000, 1001, ... until the log is full. Key frames take six
+//samples (two byte absolute first sample), delta frames seven
+static uint16_t test_FillRamp(pack_Enc_t *pEnc){
+
+   uint16_t count = 0;
+
+   test_Boot(pEnc);
+   while(pack_Put(pEnc,1000 + count) == ERR_NONE)
+      count++;
+   return count;
+}
+
+//Steps across the int16_t range wrap and pack as small deltas
+static void test_Wrap(void){
+
+   static const int16_t jumps[] = {32767,-32768,-32767,32767,0,-1,-32768,32767,1,-32768};
+   int16_t samples[30], out[30];
+   uint16_t idx, count;
+   pack_Enc_t enc;
+
+   test_Boot(&enc);
+   CHECK(pack_Put(&enc,32767) == ERR_NONE);
+   CHECK(pack_Put(&enc,-32768) == ERR_NONE);
+   CHECK(pack_Flush(&enc) == ERR_NONE);
+   CHECK(test_Mem[0] == (PACK_KEY | 2));
+   CHECK(test_Mem[1] == 0xFE && test_Mem[2] == 0xFF);                           //Zig-zag 65534
+   CHECK(test_Mem[3] == 0x03);
+   CHECK(test_Mem[4] == 0x02);                                                  //+1 across the wrap, one byte
+   CHECK(test_Mem[5] == 0 && test_Mem[7] == 0);
+
+   //Full scale jumps, then a ramp of 1000 that wraps
+   for(idx=0; idx<sizeof(jumps)/sizeof(jumps[0]); idx++)
+      samples[idx] = jumps[idx];
+   for(; idx<sizeof(samples)/sizeof(samples[0]); idx++)
+      samples[idx] = (int16_t)(uint16_t)(30000 + 1000 * idx);
+
+   test_Boot(&enc);
+   for(idx=0; idx<sizeof(samples)/sizeof(samples[0]); idx++)
+      CHECK(pack_Put(&enc,samples[idx]) == ERR_NONE);
+   CHECK(pack_Flush(&enc) == ERR_NONE);
+   CHECK(pack_Read(0,LC01B_CAP,out,sizeof(out)/sizeof(out[0]),&count) == ERR_NONE);
+   CHECK(count == sizeof(samples)/sizeof(samples[0]));
+   CHECK(memcmp(out,samples,sizeof(samples)) == 0);
+}
+
+//Every PACK_KEY_FRAMES-th frame is a key frame and decoding can start on
+//one; delta frames ahead of it decode to nothing
+static void test_KeyFrames(void){
+
+   int16_t out[128];
+   uint16_t idx, count, first;
+   pack_Enc_t enc;
+
+   count = test_FillRamp(&enc);
+   CHECK(count == 4*6 + 12*7);
+   CHECK(test_Writes == TEST_FRAMES);                                           //One page write per frame
+   CHECK(pack_Put(&enc,0) == ERR_MEM_BOUNDS);
+   for(idx=0; idx<TEST_FRAMES; idx++)
+      CHECK(!(test_Mem[idx*PACK_FRAME] & PACK_KEY) == !!(idx % PACK_KEY_FRAMES));
+
+   CHECK(pack_Read(0,LC01B_CAP,out,sizeof(out)/sizeof(out[0]),&count) == ERR_NONE);
+   CHECK(count == 108);
+   for(idx=0; idx<count; idx++)
+      CHECK(out[idx] == 1000 + idx);
+
+   //From the second key frame, and from the delta frame after the first
+   first = 6 + 3*7;
+   CHECK(pack_Read(4*PACK_FRAME,LC01B_CAP - 4*PACK_FRAME,out,128,&count) == ERR_NONE);
+   CHECK(count == 108 - first && out[0] == 1000 + first);
+   CHECK(pack_Read(PACK_FRAME,LC01B_CAP - PACK_FRAME,out,128,&count) == ERR_NONE);
+   CHECK(count == 108 - first && out[0] == 1000 + first);
+   CHECK(out[count-1] == 1107);
+
+   //Output buffer too small for the next frame
+   CHECK(pack_Read(0,LC01B_CAP,out,10,&count) == ERR_NONE);
+   CHECK(count == 6);
+}
+
+//A corrupt frame decodes to nothing and drops sync until the next key
+//frame; a blank frame does neither
+static void test_Corrupt(void){
+
+   static const uint8_t offFrame[PACK_FRAME] = {0x07,1,1,1,1,1,1,0x81};         //Last varint runs off the frame
+   static const uint8_t longVarint[PACK_FRAME] = {0x01,0xFF,0xFF,0xFF,0x01,0,0,0};
+   uint8_t blank[PACK_FRAME];
+   int16_t out[128];
+   uint16_t count;
+   pack_Enc_t enc;
+   pack_Dec_t dec;
+
+   test_FillRamp(&enc);
+   test_Mem[5*PACK_FRAME] = 0x00;                                               //No samples
+   memcpy(&test_Mem[9*PACK_FRAME],offFrame,PACK_FRAME);
+   test_Mem[13*PACK_FRAME] = PACK_FRAME;                                        //More samples than fit
+
+   //Frames 0-4, then keys 8 and 12 alone
+   CHECK(pack_Read(0,LC01B_CAP,out,sizeof(out)/sizeof(out[0]),&count) == ERR_NONE);
+   CHECK(count == 33 + 6 + 6);
+   CHECK(out[32] == 1032);
+   CHECK(out[33] == 1054 && out[38] == 1059);
+   CHECK(out[39] == 1081 && out[44] == 1086);
+
+   pack_DecInit(&dec);
+   CHECK(pack_DecFrame(&dec,(uint8_t *)longVarint,out) == 0);                   //Key flag clear, not synced
+   CHECK(pack_DecFrame(&dec,&test_Mem[0],out) == 6);
+   CHECK(pack_DecFrame(&dec,(uint8_t *)longVarint,out) == 0);                   //More than 16 bits
+   CHECK(pack_DecFrame(&dec,&test_Mem[PACK_FRAME],out) == 0);
+
+   pack_DecInit(&dec);
+   memset(blank,PACK_BLANK,sizeof(blank));
+   CHECK(pack_DecFrame(&dec,&test_Mem[0],out) == 6);
+   CHECK(pack_DecFrame(&dec,blank,out) == 0);
+   CHECK(pack_DecFrame(&dec,&test_Mem[PACK_FRAME],out) == 7 && out[0] == 1006);
+}
+
+//Flushed part frames are rewritten in place; the log ends at the first
+//blank frame
+static void test_Flush(void){
+
+   int16_t out[128];
+   uint16_t idx, count;
+   pack_Enc_t enc;
+
+   test_Boot(&enc);
+   for(idx=0; idx<10; idx++)
+      CHECK(pack_Put(&enc,1000 + idx) == ERR_NONE);
+   CHECK(pack_Flush(&enc) == ERR_NONE);
+   CHECK(test_Writes == 2);
+   CHECK(pack_Read(0,LC01B_CAP,out,128,&count) == ERR_NONE);
+   CHECK(count == 10 && out[9] == 1009);
+
+   for(; idx<13; idx++)
+      CHECK(pack_Put(&enc,1000 + idx) == ERR_NONE);
+   CHECK(pack_Flush(&enc) == ERR_NONE);
+   CHECK(test_Writes == 3 && test_Mem[PACK_FRAME] == 7);
+   CHECK(pack_Read(0,LC01B_CAP,out,128,&count) == ERR_NONE);
+   CHECK(count == 13 && out[12] == 1012);
+}
+
+//Range checks, and a failed page write keeps the frame for a retry
+static void test_Limits(void){
+
+   int16_t out[16];
+   uint16_t idx, count;
+   pack_Enc_t enc;
+
+   CHECK(pack_EncInit(&enc,4,16) == ERR_PAGE_BOUNDS);
+   CHECK(pack_EncInit(&enc,0,12) == ERR_PAGE_BOUNDS);
+   CHECK(pack_EncInit(&enc,0,0) == ERR_MEM_BOUNDS);
+   CHECK(pack_EncInit(&enc,LC01B_CAP - PACK_FRAME,2*PACK_FRAME) == ERR_MEM_BOUNDS);
+   CHECK(pack_Read(0,LC01B_CAP + PACK_FRAME,out,16,&count) == ERR_MEM_BOUNDS);
+   CHECK(count == 0);
+
+   test_Boot(&enc);
+   for(idx=0; idx<5; idx++)
+      CHECK(pack_Put(&enc,1000 + idx) == ERR_NONE);
+   test_WriteErr = ERR_PAGE_NACK;
+   CHECK(pack_Put(&enc,1005) == ERR_PAGE_NACK);                                 //Fills the frame
+   CHECK(test_Mem[0] == PACK_BLANK);
+   test_WriteErr = ERR_NONE;
+   CHECK(pack_Put(&enc,1006) == ERR_NONE);
+   CHECK(pack_Flush(&enc) == ERR_NONE);
+   CHECK(pack_Read(0,LC01B_CAP,out,16,&count) == ERR_NONE);
+   CHECK(count == 7 && out[5] == 1005 && out[6] == 1006);
+}
+
+int main(void){
+
+   test_Wrap();
+   test_KeyFrames();
+   test_Corrupt();
+   test_Flush();
+   test_Limits();
+   return SIM_TEST_END("test_pack");
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Driver statistics built with EE_STATS: the 32-bit Timer2/3 time base
+ * across latencies past the 16-bit wrap, write cycle timing on one device
+ * and overlapped across a stripe set, and the per API counters
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eestats.h"
+#include "eestripe.h"
+#include "sim.h"
+#include "simtest.h"
+
+#define TICKS_PER_US ((FCY / 1000000UL) / 8)                                    //1:8 prescale
+
+//Queued NVM writes: the last one completes 40ms after submit, past where
+//a 16-bit Timer2 wraps
+static void test_Latency(void){
+
+   obee_Op_t ops[10];
+   uint16_t data = 0x55AA, idx;
+   ee_Stats_t stats;
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   obee_Init();
+   stats_Init();
+   for(idx=0; idx<10; idx++)
+      obee_WriteAsync(&ops[idx],EE_WRITE_ER,idx*WORD_LEN,WORD_LEN,&data,0);
+   obee_Wait(&ops[9]);
+
+   stats_Snapshot(&stats);
+   CHECK(stats.calls[STATS_API_OBEE_WRITE] == 10);
+   CHECK(stats.nvmOps[STATS_NVM_WRITE_ER] == 10);
+   CHECK(stats.hist[STATS_HIST_OBEE][STATS_BUCKETS-1] == 6);                    //20ms to 40ms, none wrapped
+   CHECK(stats_Now() > 40000UL * TICKS_PER_US);
+   CHECK(sim_Errors == 0);
+}
+
+//Page write cycle from stop bit to the answered poll
+static void test_WriteCycle(void){
+
+   uint8_t data[LC01B_PAGE] = {1,2,3,4,5,6,7,8};
+   ee_Stats_t stats;
+   uint32_t twc = sim_Eeps[0].twcUs * TICKS_PER_US;
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   stats_Init();
+   CHECK(lc01b_WritePage(0x10,sizeof(data),data) == ERR_NONE);
+
+   stats_Snapshot(&stats);
+   CHECK(stats.wcCount == 1);
+   CHECK(stats.wcMin == stats.wcMax);
+   CHECK(stats.wcMax >= twc && stats.wcMax < twc + twc/10);
+   CHECK(stats.polls > 0);
+   CHECK(stats.pageWrites[0x10 / LC01B_PAGE] == 1);
+   CHECK(stats.calls[STATS_API_LC01B_WRITE] == 1 && stats.bytes[STATS_API_LC01B_WRITE] == sizeof(data));
+   CHECK(sim_Errors == 0);
+}
+
+//Lazy striped writes leave a write cycle running on each device at once;
+//every one is timed from its own stop bit
+static void test_StripeCycles(void){
+
+   lc01b_Dev_t devs[2] = {LC01B_DEV_24LC64(0),LC01B_DEV_24LC64(1)};
+   uint8_t data[64], idx;
+   ee_Stats_t stats;
+   uint32_t twc;
+
+   sim_Reset();
+   sim_Eeps[0].present = 0;
+   for(idx=0; idx<2; idx++)
+      sim_Attach(idx,32,8192,2,0,1);
+   twc = sim_Eeps[1].twcUs * TICKS_PER_US;
+   init_I2C(I2C_BRG_400);
+   stats_Init();
+   lc01b_LazyPoll(1);
+   memset(data,0x3C,sizeof(data));
+   CHECK(stripe_Init(devs,2) == ERR_NONE);
+   CHECK(stripe_Write(0,sizeof(data),data) == ERR_NONE);                        //One page on each
+   CHECK(stripe_Sync() == ERR_NONE);
+
+   stats_Snapshot(&stats);
+   CHECK(stats.wcCount == 2);
+   CHECK(stats.wcMin >= twc && stats.wcMin < twc + twc/10);
+   CHECK(stats.wcMax >= stats.wcMin && stats.wcMax < 2*twc);
+   lc01b_LazyPoll(0);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Latency();
+   test_WriteCycle();
+   test_StripeCycles();
+   return SIM_TEST_END("test_stats");
+}
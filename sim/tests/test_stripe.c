@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * Page striping over three simulated 24LC64s: round-robin placement of
+ * a write spanning more pages than devices, read back, and stripe_Sync
+ * waiting out every lazy write cycle, past a device that never answers
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "eestripe.h"
+#include "sim.h"
+#include "simtest.h"
+
+#define TEST_DEVS  3
+#define TEST_PAGE  32
+#define TEST_START 16                                                           //Half way into logical page 0
+#define TEST_LEN   (7*TEST_PAGE)                                                //Eight logical pages, part first and last
+
+static lc01b_Dev_t test_Devs[TEST_DEVS] = {LC01B_DEV_24LC64(0),LC01B_DEV_24LC64(1),LC01B_DEV_24LC64(2)};
+static sim_Eep_t *test_pEeps[TEST_DEVS];                                        //Model of each chip select
+
+//Three blank 24LC64s with lazy polling
+static void test_Boot(void){
+
+   uint8_t idx;
+
+   sim_Reset();
+   sim_Eeps[0].present = 0;
+   for(idx=0; idx<TEST_DEVS; idx++)
+      test_pEeps[idx] = sim_Attach(idx,TEST_PAGE,8192,2,0,1);
+   init_I2C(I2C_BRG_400);
+   lc01b_LazyPoll(1);
+   for(idx=0; idx<TEST_DEVS; idx++)
+      test_Devs[idx].writeCycle = 0;
+   CHECK(stripe_Init(test_Devs,TEST_DEVS) == ERR_NONE);
+}
+
+//Back to the default device and blocking polls
+static void test_Done(void){
+
+   lc01b_LazyPoll(0);
+   lc01b_SetDevice(0);
+   CHECK(sim_Errors == 0);
+}
+
+//Logical page n lands on device n % 3 at device page n / 3
+static void test_Placement(void){
+
+   uint8_t data[TEST_LEN], back[TEST_LEN];
+   uint16_t idx, unit, devAddr;
+   sim_Eep_t *pEep;
+   uint8_t busy = 0;
+
+   test_Boot();
+   CHECK(stripe_Capacity() == TEST_DEVS * 8192UL);
+   for(idx=0; idx<TEST_LEN; idx++)
+      data[idx] = idx * 7 + 1;
+   CHECK(stripe_Write(TEST_START,TEST_LEN,data) == ERR_NONE);
+
+   for(idx=0; idx<TEST_LEN; idx++){
+      unit = (TEST_START + idx) / TEST_PAGE;
+      devAddr = (unit / TEST_DEVS) * TEST_PAGE + (TEST_START + idx) % TEST_PAGE;
+      CHECK(test_pEeps[unit % TEST_DEVS]->mem[devAddr] == data[idx]);
+   }
+   CHECK(test_pEeps[0]->mem[TEST_START-1] == 0xFF);
+   CHECK(test_pEeps[1]->mem[2*TEST_PAGE + TEST_START] == 0xFF);                 //Logical page 7 ends half way
+   CHECK(test_pEeps[0]->writeCycles == 3 && test_pEeps[1]->writeCycles == 3 && test_pEeps[2]->writeCycles == 2);
+
+   //Pages go out back to back; the last ones are still in their cycles
+   for(idx=0; idx<TEST_DEVS; idx++){
+      if(test_pEeps[idx]->busyUntil > sim_Now())
+         busy++;
+   }
+   CHECK(busy >= 2);
+
+   CHECK(stripe_Sync() == ERR_NONE);
+   for(idx=0; idx<TEST_DEVS; idx++){
+      pEep = test_pEeps[idx];
+      CHECK(pEep->busyUntil <= sim_Now() && test_Devs[idx].writeCycle == 0);
+   }
+
+   memset(back,0,sizeof(back));
+   CHECK(stripe_Read(TEST_START,TEST_LEN,back) == ERR_NONE);
+   CHECK(memcmp(back,data,TEST_LEN) == 0);
+   CHECK(stripe_Write(stripe_Capacity() - 4,8,data) == ERR_MEM_BOUNDS);
+   test_Done();
+}
+
+//A stuck part fails the sync, and the parts after it are still waited out
+static void test_SyncStuck(void){
+
+   uint8_t data[TEST_DEVS*TEST_PAGE];
+   uint8_t idx;
+
+   test_Boot();
+   memset(data,0x5A,sizeof(data));
+   test_pEeps[1]->stuck = 1;
+   CHECK(stripe_Write(0,sizeof(data),data) == ERR_NONE);                        //One page each
+   CHECK(test_pEeps[2]->busyUntil > sim_Now());
+   CHECK(stripe_Sync() == ERR_CNTL_NACK);
+   CHECK(test_Devs[1].writeCycle == 1);
+   CHECK(test_Devs[0].writeCycle == 0 && test_Devs[2].writeCycle == 0);
+   for(idx=0; idx<TEST_DEVS; idx++)
+      CHECK(test_pEeps[idx]->mem[0] == 0x5A);
+   test_Done();
+}
+
+int main(void){
+
+   test_Placement();
+   test_SyncStuck();
+   return SIM_TEST_END("test_stripe");
+}
@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * Tiered storage on the simulated 24LC01B and on-board EEPROM: promotion
+ * into the fast tier, a demotion that frees a slot for a hotter region,
+ * and failed home copies that leave regions promoted, checked against
+ * the NVM homes and the placement directory
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eetxn.h"
+#include "eemirror.h"
+#include "eetier.h"
+#include "sim.h"
+#include "simtest.h"
+
+#define TEST_LEN   48                                                           //Six pages; two regions fill the fast tier
+#define TEST_PAGES (TEST_LEN / LC01B_PAGE)
+
+static tier_Region_t test_Regions[3] = {
+   {"a",TEST_LEN,TIER_AUTO,0,0,0},
+   {"b",TEST_LEN,TIER_AUTO,0,0,0},
+   {"c",TEST_LEN,TIER_AUTO,0,0,0},
+};
+
+//Write a region through the tiers, fill, fill + 1, ...
+static void test_Fill(uint8_t region, uint8_t fill){
+
+   uint8_t data[TEST_LEN], idx;
+
+   for(idx=0; idx<TEST_LEN; idx++)
+      data[idx] = fill + idx;
+   CHECK(tier_Write(region*TEST_LEN,TEST_LEN,data) == ERR_NONE);
+}
+
+//Non-zero if the bytes hold fill, fill + 1, ...
+static uint8_t test_Holds(const uint8_t *pData, uint8_t fill){
+
+   uint8_t idx;
+
+   for(idx=0; idx<TEST_LEN; idx++){
+      if(pData[idx] != (uint8_t)(fill + idx))
+         return 0;
+   }
+   return 1;
+}
+
+//Region contents through the tiers
+static uint8_t test_Reads(uint8_t region, uint8_t fill){
+
+   uint8_t data[TEST_LEN];
+
+   return tier_Read(region*TEST_LEN,TEST_LEN,data) == ERR_NONE && test_Holds(data,fill);
+}
+
+//Region contents in its on-board EEPROM home
+static uint8_t test_Home(uint8_t region, uint8_t fill){
+
+   uint16_t words[TEST_LEN/WORD_LEN];
+
+   obee_ReadSeq(test_Regions[region].home,TEST_LEN,words);
+   return test_Holds((uint8_t *)words,fill);
+}
+
+//Slot byte of a region in the committed placement directory
+static uint8_t test_Dir(uint8_t region){
+
+   static uint16_t work[TIER_DIR_LEN/WORD_LEN];
+   txn_t dir;
+
+   dir.media = TXN_OBEE;
+   dir.base = TIER_BULK_BASE;
+   dir.len = TIER_MAX_REGIONS;
+   dir.pWork = (uint8_t *)work;
+   if(txn_Open(&dir) != ERR_NONE)
+      return TIER_COLD;
+   return dir.pWork[region];
+}
+
+//NVM cycles run so far
+static uint32_t test_NvmCycles(void){
+
+   uint32_t total = 0;
+   uint8_t kind;
+
+   for(kind=0; kind<SIM_NVM_KINDS; kind++)
+      total += sim_Nvm.cycles[kind];
+   return total;
+}
+
+//Blank parts, then a and b written hot and promoted into slots 0 and 6.
+//Their write counts are 2 after the rebalance
+static void test_Promote(void){
+
+   uint8_t idx;
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   obee_Init();
+   CHECK(tier_Init(test_Regions,3) == ERR_NONE);
+   for(idx=0; idx<3; idx++)
+      CHECK(test_Regions[idx].slot == TIER_COLD);
+   for(idx=0; idx<TIER_HOT_WRITES; idx++){
+      test_Fill(0,0x10);
+      test_Fill(1,0x20);
+   }
+   test_Fill(2,0x30);
+   CHECK(tier_Rebalance() == ERR_NONE);
+   CHECK(test_Regions[0].slot == 0 && test_Regions[1].slot == TEST_PAGES);
+   CHECK(test_Regions[2].slot == TIER_COLD);
+   CHECK(test_Dir(0) == 0 && test_Dir(1) == TEST_PAGES && test_Dir(2) == TIER_COLD);
+   CHECK(test_Holds(&sim_Eeps[0].mem[0],0x10) && test_Holds(&sim_Eeps[0].mem[TEST_LEN],0x20));
+}
+
+//c gets hot while b cools; b goes home with what was written to it in
+//the fast tier and c takes its slot
+static void test_Demote(void){
+
+   uint8_t idx;
+
+   test_Promote();
+   test_Fill(0,0x11);
+   test_Fill(1,0x21);
+   for(idx=0; idx<2*TIER_HOT_WRITES; idx++)
+      test_Fill(2,0x31);
+   CHECK(test_Home(1,0x20));                                                    //Stale while promoted
+
+   CHECK(tier_Rebalance() == ERR_NONE);
+   CHECK(test_Regions[0].slot == 0);
+   CHECK(test_Regions[1].slot == TIER_COLD && test_Regions[2].slot == TEST_PAGES);
+   CHECK(test_Home(1,0x21));
+   CHECK(test_Holds(&sim_Eeps[0].mem[TEST_LEN],0x31));
+   CHECK(test_Dir(0) == 0 && test_Dir(1) == TIER_COLD && test_Dir(2) == TEST_PAGES);
+
+   //The same placement after a reset
+   CHECK(tier_Init(test_Regions,3) == ERR_NONE);
+   CHECK(test_Regions[1].slot == TIER_COLD && test_Regions[2].slot == TEST_PAGES);
+   CHECK(test_Reads(0,0x11) && test_Reads(1,0x21) && test_Reads(2,0x31));
+   CHECK(sim_Errors == 0);
+}
+
+//The home copy of b fails, so b keeps its slot and c is not promoted
+static void test_CopyFail(void){
+
+   uint8_t idx;
+
+   test_Promote();
+   test_Fill(0,0x11);
+   test_Fill(1,0x21);
+   for(idx=0; idx<2*TIER_HOT_WRITES; idx++)
+      test_Fill(2,0x31);
+
+   sim_Fault.nvmFail = 1;
+   CHECK(tier_Rebalance() == ERR_NVM_WRITE);
+   CHECK(test_Regions[1].slot == TEST_PAGES && test_Regions[2].slot == TIER_COLD);
+   CHECK(test_Dir(1) == TEST_PAGES && test_Dir(2) == TIER_COLD);
+   CHECK(test_Reads(1,0x21) && test_Reads(2,0x31));
+
+   CHECK(tier_Init(test_Regions,3) == ERR_NONE);
+   CHECK(test_Regions[1].slot == TEST_PAGES);
+   CHECK(test_Reads(0,0x11) && test_Reads(1,0x21) && test_Reads(2,0x31));
+   CHECK(sim_Errors == 0);
+}
+
+//Both promoted regions cool off together. a goes home, b's copy fails;
+//the directory still records that a moved
+static void test_PartFail(void){
+
+   uint32_t cycles;
+
+   //Count the NVM cycles of a's home copy on its own
+   test_Promote();
+   test_Fill(0,0x11);
+   test_Fill(1,0x21);
+   CHECK(tier_Rebalance() == ERR_NONE);                                         //Counts of 3 hold, then halve to 1
+   cycles = test_NvmCycles();
+   CHECK(mirror_Lc01bToNvm(TIER_FAST_BASE,test_Regions[0].home,TEST_LEN) == ERR_NONE);
+   cycles = test_NvmCycles() - cycles;
+   CHECK(cycles > 0);
+
+   test_Promote();
+   test_Fill(0,0x11);
+   test_Fill(1,0x21);
+   CHECK(tier_Rebalance() == ERR_NONE);
+   sim_Fault.nvmFail = cycles + 1;
+   CHECK(tier_Rebalance() == ERR_NVM_WRITE);
+   CHECK(test_Regions[0].slot == TIER_COLD && test_Regions[1].slot == TEST_PAGES);
+   CHECK(test_Dir(0) == TIER_COLD && test_Dir(1) == TEST_PAGES);
+   CHECK(test_Home(0,0x11));
+
+   CHECK(tier_Init(test_Regions,3) == ERR_NONE);
+   CHECK(test_Regions[0].slot == TIER_COLD && test_Regions[1].slot == TEST_PAGES);
+   CHECK(test_Reads(0,0x11) && test_Reads(1,0x21));
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Demote();
+   test_CopyFail();
+   test_PartFail();
+   return SIM_TEST_END("test_tier");
+}
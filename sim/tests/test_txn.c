@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * A/B slot transactions on the simulated 24LC01B: commits alternate
+ * slots, a commit cut off at any transmitted byte leaves the previous
+ * commit in place, and slot pairs off a page boundary are refused
+ * *****************************************************************************/
+#include <string.h>
+#include <xc.h>
+#include "sys.h"
+#include "lc01b.h"
+#include "obeeprom.h"
+#include "eetxn.h"
+#include "sim.h"
+#include "simtest.h"
+
+#define TEST_LEN  12                                                            //Payload; two pages and a seal page a slot
+#define TEST_SLOT TXN_SLOT_LEN(LC01B_PAGE,TEST_LEN)
+
+static uint16_t test_Work[TXN_WORK_LEN(TXN_OBEE_PAGE,TEST_LEN) / WORD_LEN];
+
+static void test_Boot(txn_t *pTxn, uint8_t media, uint16_t base){
+
+   sim_Reset();
+   init_I2C(I2C_BRG_400);
+   obee_Init();
+   pTxn->media = media;
+   pTxn->base = base;
+   pTxn->len = TEST_LEN;
+   pTxn->pWork = (uint8_t *)test_Work;
+}
+
+//Stage a payload of fill, fill + 1, ... and commit it
+static ee_Errors_t test_Commit(txn_t *pTxn, uint8_t fill){
+
+   uint8_t payload[TEST_LEN], idx;
+
+   for(idx=0; idx<TEST_LEN; idx++)
+      payload[idx] = fill + idx;
+   txn_Stage(pTxn,0,TEST_LEN,payload);
+   return txn_Commit(pTxn);
+}
+
+//Commits one and two in slots A and B
+static void test_Two(txn_t *pTxn){
+
+   test_Boot(pTxn,TXN_LC01B,0x20);
+   CHECK(txn_Open(pTxn) == ERR_CRC && pTxn->active == TXN_NONE);
+   CHECK(test_Commit(pTxn,0x10) == ERR_NONE && pTxn->active == 0);
+   CHECK(test_Commit(pTxn,0x40) == ERR_NONE && pTxn->active == 1);
+}
+
+//Reopen and check which commit is staged
+static void test_Staged(txn_t *pTxn, uint8_t active, uint16_t seq, uint8_t fill){
+
+   uint8_t payload[TEST_LEN];
+
+   CHECK(txn_Open(pTxn) == ERR_NONE);
+   CHECK(pTxn->active == active && pTxn->seq == seq);
+   CHECK(txn_Get(pTxn,0,TEST_LEN,payload) == ERR_NONE);
+   CHECK(payload[0] == fill && payload[TEST_LEN-1] == (uint8_t)(fill + TEST_LEN - 1));
+}
+
+//Slots alternate and reopen to the newest
+static void test_Alternate(void){
+
+   txn_t txn;
+
+   test_Two(&txn);
+   CHECK(sim_Eeps[0].mem[0x20] == 0x10 && sim_Eeps[0].mem[0x20 + TEST_SLOT] == 0x40);
+   CHECK(sim_Eeps[0].mem[0x20 + TEST_SLOT - LC01B_PAGE] == TXN_MAGIC);
+   test_Staged(&txn,1,2,0x40);
+   CHECK(test_Commit(&txn,0x70) == ERR_NONE);
+   test_Staged(&txn,0,3,0x70);
+   CHECK(sim_Errors == 0);
+}
+
+//Cut the third commit off at every byte it sends. Until the seal page is
+//written the second commit must come back; at least one cut lands with
+//the payload written and the seal lost
+static void test_TornSeal(void){
+
+   uint8_t slotA[TEST_LEN], idx, torn = 0;
+   uint32_t bytes, nack;
+   ee_Errors_t errCode;
+   txn_t txn;
+
+   for(idx=0; idx<TEST_LEN; idx++)
+      slotA[idx] = 0x70 + idx;
+   test_Two(&txn);
+   sim_ClearCounts();
+   CHECK(test_Commit(&txn,0x70) == ERR_NONE);
+   bytes = sim_Bus.txBytes;
+
+   for(nack=1; nack<=bytes; nack++){
+      test_Two(&txn);
+      sim_Fault.nackByte = nack;
+      errCode = test_Commit(&txn,0x70);
+      sim_Fault.nackByte = 0;
+      if(errCode == ERR_NONE){
+         test_Staged(&txn,0,3,0x70);
+         continue;
+      }
+      if(memcmp(&sim_Eeps[0].mem[0x20],slotA,TEST_LEN) == 0)
+         torn++;
+      CHECK(txn.active == 1 && txn.seq == 2);                                   //Not advanced by the failed commit
+      test_Staged(&txn,1,2,0x40);
+   }
+   CHECK(torn > 0);
+}
+
+//Slot pairs start on a page of their media
+static void test_Align(void){
+
+   txn_t txn;
+
+   test_Boot(&txn,TXN_LC01B,0x24);
+   CHECK(txn_Open(&txn) == ERR_MEM_BOUNDS);
+   CHECK(test_Commit(&txn,0x10) == ERR_MEM_BOUNDS);
+   CHECK(sim_Eeps[0].writeCycles == 0);
+
+   test_Boot(&txn,TXN_OBEE,TXN_OBEE_PAGE/2);
+   CHECK(txn_Open(&txn) == ERR_MEM_BOUNDS);
+   CHECK(test_Commit(&txn,0x10) == ERR_MEM_BOUNDS);
+   CHECK(sim_Nvm.cycles[SIM_NVM_WRITE_ER] == 0);
+
+   test_Boot(&txn,TXN_OBEE,OFFSET_LAST + 1 - TXN_OBEE_PAGE);
+   CHECK(txn_Open(&txn) == ERR_MEM_BOUNDS);                                     //Aligned but runs off the end
+
+   test_Boot(&txn,TXN_OBEE,TXN_OBEE_PAGE);
+   CHECK(txn_Open(&txn) == ERR_CRC);
+   CHECK(test_Commit(&txn,0x10) == ERR_NONE);
+   CHECK(txn_Open(&txn) == ERR_NONE && txn.active == 0 && txn.seq == 1);
+   CHECK(sim_Errors == 0);
+}
+
+int main(void){
+
+   test_Alternate();
+   test_TornSeal();
+   test_Align();
+   return SIM_TEST_END("test_txn");
+}
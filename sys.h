@@ -20,7 +20,18 @@ typedef enum{
    ERR_MEM_BOUNDS = 0xE0,                                                       //Address above bounds limit
    ERR_CNTL_NACK,                                                               //NACK on control byte
    ERR_MEM_NACK,                                                                //NACK on memory address byte
-   ERR_PAGE_NACK                                                                //NACK on page write
+   ERR_PAGE_NACK,                                                               //NACK on page write
+   ERR_PAGE_BOUNDS,                                                             //Page write crosses a page boundary
+   ERR_NO_KEY,                                                                  //Key not found in the record store
+   ERR_KEYS_FULL,                                                               //No room in the record store index
+   ERR_BUS_TIMEOUT,                                                             //Bus event overran its time budget
+   ERR_BUS_COLLISION,                                                           //Bus collision or write collision
+   ERR_CRC,                                                                     //Protected object failed its CRC
+   ERR_BATCH_FULL,                                                              //No room left in a write batch
+   ERR_VERIFY,                                                                  //Memory does not match the expected pattern
+   ERR_NVM_WRITE,                                                               //On-board EEPROM cycle ended with WRERR set
+   ERR_ARG,                                                                     //Argument outside what the call accepts
+   ERR_ABORTED                                                                  //Queued transaction dropped by init_I2C
 }ee_Errors_t;
 
 